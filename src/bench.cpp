@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include <GL/glew.h>
+#include <stb/stb_image.h>
+
+#include <glm/glm.hpp>
+
+#include "common.hpp"
+#include "common/opengl.hpp"
+#include "gfx/opengl.hpp"
+#include "gfx/readback.hpp"
+#include "gfx/renderer.hpp"
+#include "platform/headless.hpp"
+#include "utils/settings.hpp"
+
+// Renders a scene offscreen for a fixed number of frames and reports how long they took, without
+// a window, swapchain or UI so it can run on machines without a display
+// The camera turns around once over the measured frames so every run sees the same views
+
+static constexpr usize FRAMES_IN_FLIGHT = 3; // like a swapchain, the CPU can't run further ahead
+
+struct BenchOptions {
+    const char* scene        = "assets/sponza/sponza.obj";
+    f32         scene_scale  = 0.01f;
+    const char* skybox       = "assets/tex/sky0";
+    u32         width        = 1920;
+    u32         height       = 1080;
+    u32         warmup       = 60; // frames rendered before measuring, while programs are linked
+    u32         frames       = 600;
+    const char* summary_path = nullptr;
+    const char* csv_path     = nullptr;
+};
+
+struct FrameTimes {
+    std::vector<f64> cpu_ms;
+    std::vector<f64> gpu_ms;
+};
+
+static void PrintUsage(const char* exe)
+{
+    fprintf(
+        stderr,
+        "Usage: %s [options]\n"
+        "  --scene <path>      model to render (assets/sponza/sponza.obj)\n"
+        "  --scale <factor>    scale of the model (0.01)\n"
+        "  --skybox <dir>      skybox to render, 'none' for none (assets/tex/sky0)\n"
+        "  --size <w> <h>      resolution (1920 1080)\n"
+        "  --warmup <n>        frames rendered before measuring (60)\n"
+        "  --frames <n>        frames measured (600)\n"
+        "  --msaa <n>          MSAA samples (4)\n"
+        "  --taa               TAA instead of MSAA\n"
+        "  --smaa              SMAA 1x after tonemapping\n"
+        "  --dynamic-res <ms>  dynamic resolution with a GPU frame budget\n"
+        "  --out <path>        write the summary to a file as well\n"
+        "  --csv <path>        write the time of every frame\n",
+        exe);
+}
+
+// returns false on malformed arguments, settings are applied directly as the renderer reads them
+static bool ParseArgs(int argc, char** argv, BenchOptions& opts)
+{
+    for (int ii = 1; ii < argc; ii++) {
+        const char* arg       = argv[ii];
+        int         remaining = argc - ii - 1;
+
+        auto next = [&]() { return argv[++ii]; };
+
+        if (strcmp(arg, "--scene") == 0 && remaining >= 1) {
+            opts.scene = next();
+        } else if (strcmp(arg, "--scale") == 0 && remaining >= 1) {
+            opts.scene_scale = strtof(next(), nullptr);
+        } else if (strcmp(arg, "--skybox") == 0 && remaining >= 1) {
+            opts.skybox = next();
+        } else if (strcmp(arg, "--size") == 0 && remaining >= 2) {
+            opts.width  = (u32)strtoul(next(), nullptr, 10);
+            opts.height = (u32)strtoul(next(), nullptr, 10);
+        } else if (strcmp(arg, "--warmup") == 0 && remaining >= 1) {
+            opts.warmup = (u32)strtoul(next(), nullptr, 10);
+        } else if (strcmp(arg, "--frames") == 0 && remaining >= 1) {
+            opts.frames = (u32)strtoul(next(), nullptr, 10);
+        } else if (strcmp(arg, "--msaa") == 0 && remaining >= 1) {
+            settings.msaa_samples = (int)strtol(next(), nullptr, 10);
+        } else if (strcmp(arg, "--taa") == 0) {
+            settings.temporal_aa = true;
+        } else if (strcmp(arg, "--smaa") == 0) {
+            settings.smaa = true;
+        } else if (strcmp(arg, "--dynamic-res") == 0 && remaining >= 1) {
+            settings.dynamic_resolution = true;
+            settings.frame_budget_ms    = strtof(next(), nullptr);
+        } else if (strcmp(arg, "--out") == 0 && remaining >= 1) {
+            opts.summary_path = next();
+        } else if (strcmp(arg, "--csv") == 0 && remaining >= 1) {
+            opts.csv_path = next();
+        } else {
+            return false;
+        }
+    }
+
+    return opts.width > 0 && opts.height > 0 && opts.frames > 0;
+}
+
+static f64 Percentile(std::vector<f64> times, f64 fraction)
+{
+    std::sort(times.begin(), times.end());
+
+    usize index = (usize)(fraction * (f64)(times.size() - 1) + 0.5);
+    return times[index];
+}
+
+static f64 Mean(const std::vector<f64>& times)
+{
+    f64 sum = 0.0;
+    for (f64 time : times) {
+        sum += time;
+    }
+
+    return sum / (f64)times.size();
+}
+
+static void WriteRow(FILE* file, const char* name, const std::vector<f64>& times)
+{
+    fprintf(
+        file,
+        "%-4s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+        name,
+        Mean(times),
+        Percentile(times, 0.5),
+        Percentile(times, 0.95),
+        Percentile(times, 0.99),
+        Percentile(times, 1.0));
+}
+
+static void WriteSummary(FILE* file, const BenchOptions& opts, const FrameTimes& times)
+{
+    fprintf(file, "renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+    fprintf(file, "scene: %s\n", opts.scene);
+    fprintf(file, "resolution: %ux%u\n", opts.width, opts.height);
+    fprintf(file, "frames: %u\n", opts.frames);
+    fprintf(file, "%-4s %10s %10s %10s %10s %10s\n", "ms", "mean", "median", "p95", "p99", "max");
+
+    WriteRow(file, "cpu", times.cpu_ms);
+    WriteRow(file, "gpu", times.gpu_ms);
+}
+
+static void WriteCSV(const char* path, const FrameTimes& times)
+{
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        LOG_WARNING("Failed to open %s", path);
+        return;
+    }
+
+    fprintf(file, "frame,cpu_ms,gpu_ms\n");
+    for (usize ii = 0; ii < times.cpu_ms.size(); ii++) {
+        fprintf(file, "%zu,%.4f,%.4f\n", ii, times.cpu_ms[ii], times.gpu_ms[ii]);
+    }
+
+    fclose(file);
+}
+
+static FrameTimes RunBenchmark(const BenchOptions& opts, const HeadlessContext& ctx)
+{
+    // synchronous debug output would be part of every measurement
+    Renderer rt = Renderer(false).ClearColor(0, 0, 0).FOV(90);
+    rt.Resolution(opts.width, opts.height);
+    rt.OutputTarget(ctx.fbo);
+
+    std::vector<Object> objs = {
+        Object(opts.scene).CastsShadows(true).Scale(opts.scene_scale),
+    };
+
+    std::optional<Skybox> sky;
+    if (strcmp(opts.skybox, "none") != 0) {
+        sky = Skybox(opts.skybox);
+    }
+
+    AmbientLight ambient_light = AmbientLight({1.0f, 1.0f, 1.0f}, 0.05f);
+    SunLight     sun_light
+        = SunLight().Direction({-1.0f, -1.0f, 0.0f}).Color(1.0f, 1.0f, 1.0f).Intensity(1.0f);
+
+    PlayerCamera cam = PlayerCamera{
+        .pos = glm::vec3(0.0f, 1.0f, 0.0f),
+        .up  = glm::vec3(0.0f, 1.0f, 0.0f),
+        .yaw = -90.0f,
+    };
+
+    // GPU times are read once the run is over, so measuring never waits on the GPU
+    u32                total = opts.warmup + opts.frames;
+    std::vector<Query> gpu_start(opts.frames);
+    std::vector<Query> gpu_end(opts.frames);
+    for (u32 ii = 0; ii < opts.frames; ii++) {
+        gpu_start[ii].Reserve();
+        gpu_end[ii].Reserve();
+    }
+
+    std::array<GLsync, FRAMES_IN_FLIGHT> fences = {};
+
+    FrameTimes times;
+    times.cpu_ms.reserve(opts.frames);
+
+    for (u32 frame = 0; frame < total; frame++) {
+        GLsync& fence = fences[frame % FRAMES_IN_FLIGHT];
+        if (fence != nullptr) {
+            GL(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED));
+            GL(glDeleteSync(fence));
+        }
+
+        bool is_measured = frame >= opts.warmup;
+        u32  index       = frame - opts.warmup;
+        auto cpu_start   = std::chrono::steady_clock::now();
+
+        if (is_measured) {
+            gpu_start[index].RecordTimestamp();
+        }
+
+        f32 progress = is_measured ? (f32)index / (f32)opts.frames : 0.0f;
+        cam.yaw      = -90.0f + 360.0f * progress;
+
+        rt.ViewPosition(cam.pos);
+        rt.ViewMatrix(cam.ViewMatrix());
+
+        rt.StartRender();
+        {
+            rt.RenderObjectLighting(ambient_light, objs);
+            rt.RenderObjectLighting(sun_light, objs);
+            if (sky.has_value()) {
+                rt.RenderSkybox(*sky);
+            }
+        }
+        rt.FinishGeometry();
+
+        rt.RenderBloom(0.005f, 0.04f);
+        rt.RenderTonemap(Renderer_PostFX::TONEMAP_ACES_APPROX);
+        rt.FinishRender(2.2f);
+
+        GL(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+        if (is_measured) {
+            gpu_end[index].RecordTimestamp();
+
+            auto cpu_end = std::chrono::steady_clock::now();
+            times.cpu_ms.push_back(
+                std::chrono::duration<f64, std::milli>(cpu_end - cpu_start).count());
+        }
+    }
+
+    GL(glFinish());
+    Readback.Flush();
+
+    times.gpu_ms.reserve(opts.frames);
+    for (u32 ii = 0; ii < opts.frames; ii++) {
+        u64 ns = gpu_end[ii].RetrieveValue() - gpu_start[ii].RetrieveValue();
+        times.gpu_ms.push_back((f64)ns / 1e6);
+
+        gpu_start[ii].Delete();
+        gpu_end[ii].Delete();
+    }
+
+    for (GLsync fence : fences) {
+        if (fence != nullptr) {
+            GL(glDeleteSync(fence));
+        }
+    }
+
+    return times;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    stbi_set_flip_vertically_on_load(true);
+
+    HeadlessContext ctx = HeadlessContext(opts.width, opts.height);
+
+    FrameTimes times = RunBenchmark(opts, ctx);
+
+    WriteSummary(stdout, opts, times);
+
+    if (opts.summary_path != nullptr) {
+        FILE* file = fopen(opts.summary_path, "w");
+        if (file != nullptr) {
+            WriteSummary(file, opts, times);
+            fclose(file);
+        } else {
+            LOG_WARNING("Failed to open %s", opts.summary_path);
+        }
+    }
+
+    if (opts.csv_path != nullptr) {
+        WriteCSV(opts.csv_path, times);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,5 +4,8 @@
 #define RENDER_CHECK_OPENGL_CALLS    true
 #define RENDER_ENABLE_OPENGL_LOGGING true
 #define RENDER_SHADER_LOG_SIZE       512
+#define RENDER_PROGRAM_CACHE_DIR     "cache/programs"
+#define RENDER_SHADER_CACHE_DIR      "cache/shaders"
+#define RENDER_CAPTURE_DIR           "captures"
 
 #define ENABLE_LOGGING true
@@ -3,17 +3,28 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <algorithm>
 #include <assimp/Importer.hpp>
 #include <numeric>
 #include <sstream>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#ifdef __AVX2__
+#    include <immintrin.h>
+#endif
+
 #include "gfx/cache.hpp"
 #include "math/math.hpp"
+#include "utils/profiling.hpp"
+#include "utils/settings.hpp"
 
 AssetCache<Texture2D> TexturePool(32);
+MaterialTable         MaterialPool;
+GeometryTable         GeometryPool;
+TransformTable        TransformPool;
 
 template<>
 struct std::hash<aiVector3D> {
@@ -251,35 +262,49 @@ Geometry::Geometry(const aiMesh& mesh)
     this->ebo_shadow.Reserve();
 
     this->vbo.LoadData(vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-    this->vbo.Bind();
-
-    this->vao_visual.SetAttribute(0, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, pos));
-    this->vao_visual.SetAttribute(1, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, norm));
-    this->vao_visual.SetAttribute(2, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tangent));
-    this->vao_visual.SetAttribute(3, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, bitangent));
-    this->vao_visual.SetAttribute(4, 2, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tex));
-
-    this->vao_shadow.SetAttribute(0, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, pos));
-    this->vao_shadow.SetAttribute(1, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, norm));
-    this->vao_shadow.SetAttribute(2, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tangent));
-    this->vao_shadow.SetAttribute(3, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, bitangent));
-    this->vao_shadow.SetAttribute(4, 2, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tex));
-
-    this->vao_visual.Bind();
     this->ebo_visual.LoadData(
         visual_indices.size() * sizeof(GLuint),
         visual_indices.data(),
         GL_STATIC_DRAW);
-
-    this->vao_shadow.Bind();
     this->ebo_shadow.LoadData(
         shadow_indices.size() * sizeof(GLuint),
         shadow_indices.data(),
         GL_STATIC_DRAW);
 
+    this->vao_visual.SetVertexBuffer(this->vbo, sizeof(Vertex));
+    this->vao_visual.SetElementBuffer(this->ebo_visual);
+    this->vao_visual.SetAttribute(0, 3, GL_FLOAT, offsetof(Vertex, pos));
+    this->vao_visual.SetAttribute(1, 3, GL_FLOAT, offsetof(Vertex, norm));
+    this->vao_visual.SetAttribute(2, 3, GL_FLOAT, offsetof(Vertex, tangent));
+    this->vao_visual.SetAttribute(3, 3, GL_FLOAT, offsetof(Vertex, bitangent));
+    this->vao_visual.SetAttribute(4, 2, GL_FLOAT, offsetof(Vertex, tex));
+
+    this->vao_shadow.SetVertexBuffer(this->vbo, sizeof(Vertex));
+    this->vao_shadow.SetElementBuffer(this->ebo_shadow);
+    this->vao_shadow.SetAttribute(0, 3, GL_FLOAT, offsetof(Vertex, pos));
+    this->vao_shadow.SetAttribute(1, 3, GL_FLOAT, offsetof(Vertex, norm));
+    this->vao_shadow.SetAttribute(2, 3, GL_FLOAT, offsetof(Vertex, tangent));
+    this->vao_shadow.SetAttribute(3, 3, GL_FLOAT, offsetof(Vertex, bitangent));
+    this->vao_shadow.SetAttribute(4, 2, GL_FLOAT, offsetof(Vertex, tex));
+
     this->len_visual = visual_indices.size();
     this->len_shadow = shadow_indices.size();
+
+    this->first_index = GeometryPool.Register(vertices, visual_indices, &this->base_vertex);
+
+    std::vector<glm::vec3> positions = {};
+    for (const auto& vert : vertices) {
+        positions.push_back(vert.pos);
+    }
+
+    this->silhouette = SilhouetteMesh(positions, shadow_indices);
+
+    this->aabb_min = positions.empty() ? glm::vec3(0.0f) : positions[0];
+    this->aabb_max = this->aabb_min;
+    for (const auto& pos : positions) {
+        this->aabb_min = glm::min(this->aabb_min, pos);
+        this->aabb_max = glm::max(this->aabb_max, pos);
+    }
 }
 
 void Geometry::DrawVisual(ShaderProgram& sp) const
@@ -290,8 +315,6 @@ void Geometry::DrawVisual(ShaderProgram& sp) const
 
     // TODO: this should probably be part of VAO
     GL(glDrawElements(GL_TRIANGLES, this->len_visual, GL_UNSIGNED_INT, 0));
-
-    this->vao_visual.Unbind();
 }
 
 void Geometry::DrawShadow(ShaderProgram& sp) const
@@ -301,8 +324,53 @@ void Geometry::DrawShadow(ShaderProgram& sp) const
     this->vao_shadow.Bind();
 
     GL(glDrawElements(GL_TRIANGLES_ADJACENCY, this->len_shadow, GL_UNSIGNED_INT, 0));
+}
+
+/* --- GeometryTable --- */
+u32 GeometryTable::Register(
+    const std::vector<Vertex>& geometry_vertices,
+    const std::vector<GLuint>& geometry_indices,
+    i32*                       base_vertex)
+{
+    u32 first_index = (u32)this->indices.size();
+    *base_vertex    = (i32)this->vertices.size();
 
-    this->vao_shadow.Unbind();
+    this->vertices.insert(this->vertices.end(), geometry_vertices.begin(), geometry_vertices.end());
+    this->indices.insert(this->indices.end(), geometry_indices.begin(), geometry_indices.end());
+    this->is_dirty = true;
+
+    return first_index;
+}
+
+void GeometryTable::Upload()
+{
+    if (!this->is_dirty) {
+        return;
+    }
+
+    PROFILE_FUNCTION();
+
+    if (this->vao.handle == 0) {
+        this->vao.Reserve();
+        this->vbo.Reserve();
+        this->ebo.Reserve();
+
+        this->vao.SetVertexBuffer(this->vbo, sizeof(Vertex));
+        this->vao.SetElementBuffer(this->ebo);
+        this->vao.SetAttribute(0, 3, GL_FLOAT, offsetof(Vertex, pos));
+        this->vao.SetAttribute(1, 3, GL_FLOAT, offsetof(Vertex, norm));
+        this->vao.SetAttribute(2, 3, GL_FLOAT, offsetof(Vertex, tangent));
+        this->vao.SetAttribute(3, 3, GL_FLOAT, offsetof(Vertex, bitangent));
+        this->vao.SetAttribute(4, 2, GL_FLOAT, offsetof(Vertex, tex));
+    }
+
+    this->vbo.LoadData(
+        this->vertices.size() * sizeof(Vertex),
+        this->vertices.data(),
+        GL_STATIC_DRAW);
+    this->ebo.LoadData(this->indices.size() * sizeof(GLuint), this->indices.data(), GL_STATIC_DRAW);
+
+    this->is_dirty = false;
 }
 
 // Material
@@ -312,6 +380,7 @@ Material::Material()
     this->specular = TexturePool.Load(DefaultTexture_Specular);
     this->normal   = TexturePool.Load(DefaultTexture_Normal);
     this->gloss    = 1.0f;
+    this->id       = MaterialPool.Register(*this);
 }
 
 Material::Material(const aiMaterial& material, std::string_view directory)
@@ -356,15 +425,577 @@ Material::Material(const aiMaterial& material, std::string_view directory)
     // set the gloss
     material.Get(AI_MATKEY_SHININESS, this->gloss);
     this->gloss = glm::min(this->gloss, 1.0f);
+
+    this->id = MaterialPool.Register(*this);
 }
 
 void Material::Use(ShaderProgram& sp) const
 {
-    this->diffuse->Bind(GL_TEXTURE0);
-    this->specular->Bind(GL_TEXTURE1);
-    this->normal->Bind(GL_TEXTURE2);
+    sp.SetUniform("g_material_id", this->id);
+}
+
+/* --- MaterialTable --- */
+bool MaterialTable::IsBindless()
+{
+    static const bool is_bindless = settings.bindless_textures && GLEW_ARB_bindless_texture;
+    return is_bindless;
+}
+
+u32 MaterialTable::Register(const Material& material)
+{
+    for (usize ii = 0; ii < this->materials.size(); ii++) {
+        const Material& other = this->materials[ii];
+        if (other.diffuse == material.diffuse && other.specular == material.specular
+            && other.normal == material.normal && other.gloss == material.gloss)
+        {
+            return (u32)ii;
+        }
+    }
+
+    this->materials.push_back(material);
+    this->materials.back().id = (u32)(this->materials.size() - 1);
+    this->is_dirty            = true;
+
+    return this->materials.back().id;
+}
+
+void MaterialTable::Upload()
+{
+    if (!this->is_dirty) {
+        return;
+    }
+
+    PROFILE_FUNCTION();
+
+    if (IsBindless()) {
+        this->MakeTexturesResident();
+    } else {
+        this->BuildTextureArrays();
+    }
+
+    std::vector<GPU_Material> gpu_materials = {};
+    for (const auto& material : this->materials) {
+        gpu_materials.push_back({
+            .diffuse  = this->texture_refs.at(material.diffuse),
+            .specular = this->texture_refs.at(material.specular),
+            .normal   = this->texture_refs.at(material.normal),
+            .gloss    = material.gloss,
+            .padding  = 0.0f,
+        });
+    }
+
+    if (this->ssbo.handle == 0) {
+        this->ssbo.Reserve();
+    }
+
+    this->ssbo.LoadData(
+        gpu_materials.size() * sizeof(GPU_Material),
+        gpu_materials.data(),
+        GL_STATIC_DRAW);
+
+    this->is_dirty = false;
+}
+
+void MaterialTable::Use() const
+{
+    this->ssbo.BindSlot(SSBO_SLOT);
+
+    for (usize ii = 0; ii < this->arrays.size(); ii++) {
+        this->arrays[ii].Bind(GL_TEXTURE0 + TEXTURE_SLOT + ii);
+    }
+}
+
+void MaterialTable::MakeTexturesResident()
+{
+    for (const auto& material : this->materials) {
+        for (Texture2D* tex : {material.diffuse, material.specular, material.normal}) {
+            if (this->texture_refs.contains(tex)) {
+                continue;
+            }
+
+            // NOTE: the texture's parameters can't be changed once it has a handle
+            GLuint64 handle;
+            GL(handle = glGetTextureHandleARB(tex->handle));
+            GL(glMakeTextureHandleResidentARB(handle));
+
+            this->texture_refs[tex] = glm::uvec2((u32)handle, (u32)(handle >> 32));
+        }
+    }
+}
+
+static glm::ivec2 TextureSize(const Texture2D& tex)
+{
+    glm::ivec2 size;
+    GL(glGetTextureLevelParameteriv(tex.handle, 0, GL_TEXTURE_WIDTH, &size.x));
+    GL(glGetTextureLevelParameteriv(tex.handle, 0, GL_TEXTURE_HEIGHT, &size.y));
+
+    return size;
+}
+
+// NOTE: rebuilds every array, this only happens when materials are registered (i.e. while loading)
+void MaterialTable::BuildTextureArrays()
+{
+    // gather the textures into buckets of the same size and color space
+    std::vector<Bucket> buckets = {};
+
+    this->texture_refs.clear();
+    for (const auto& material : this->materials) {
+        for (Texture2D* tex : {material.diffuse, material.specular, material.normal}) {
+            if (this->texture_refs.contains(tex)) {
+                continue;
+            }
+
+            this->texture_refs[tex] = glm::uvec2(0, 0);
+
+            GLint format;
+            GL(glGetTextureLevelParameteriv(tex->handle, 0, GL_TEXTURE_INTERNAL_FORMAT, &format));
+
+            glm::ivec2 size    = TextureSize(*tex);
+            bool       is_srgb = format == GL_SRGB8 || format == GL_SRGB8_ALPHA8;
+
+            auto bucket = std::find_if(buckets.begin(), buckets.end(), [&](const Bucket& other) {
+                return other.width == size.x && other.height == size.y && other.is_srgb == is_srgb;
+            });
+
+            if (bucket == buckets.end()) {
+                buckets.push_back({size.x, size.y, is_srgb, {}});
+                bucket = buckets.end() - 1;
+            }
+
+            bucket->textures.push_back(tex);
+        }
+    }
+
+    // the most used sizes get their own array, the rest are scaled to the largest array with the
+    // same color space
+    std::sort(buckets.begin(), buckets.end(), [](const Bucket& lhs, const Bucket& rhs) {
+        return lhs.textures.size() > rhs.textures.size();
+    });
+
+    for (usize ii = MAX_TEXTURE_ARRAYS; ii < buckets.size(); ii++) {
+        const Bucket& overflow = buckets[ii];
+
+        Bucket* fit = &buckets[0];
+        for (usize jj = 0; jj < MAX_TEXTURE_ARRAYS; jj++) {
+            const Bucket& candidate = buckets[jj];
+            if (candidate.is_srgb != overflow.is_srgb) {
+                continue;
+            }
+
+            if (fit->is_srgb != overflow.is_srgb
+                || candidate.width * candidate.height > fit->width * fit->height)
+            {
+                fit = &buckets[jj];
+            }
+        }
+
+        if (fit->is_srgb != overflow.is_srgb) {
+            LOG_WARNING("No texture array with a matching color space, colors will be off");
+        }
+
+        fit->textures.insert(
+            fit->textures.end(),
+            overflow.textures.begin(),
+            overflow.textures.end());
+    }
+
+    buckets.resize(glm::min(buckets.size(), MAX_TEXTURE_ARRAYS));
+
+    // copy the textures into the arrays
+    for (auto& array : this->arrays) {
+        array.Delete();
+    }
+    this->arrays.clear();
+
+    if (this->fbo_src.handle == 0) {
+        this->fbo_src.Reserve();
+        this->fbo_dst.Reserve();
+    }
+
+    for (usize ii = 0; ii < buckets.size(); ii++) {
+        const Bucket& bucket = buckets[ii];
+
+        TextureArray2D array;
+        array.Reserve();
+        array.Setup(
+            bucket.is_srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8,
+            bucket.width,
+            bucket.height,
+            (GLsizei)bucket.textures.size());
+
+        for (usize layer = 0; layer < bucket.textures.size(); layer++) {
+            Texture2D* tex  = bucket.textures[layer];
+            glm::ivec2 size = TextureSize(*tex);
+
+            this->fbo_src.Attach(*tex, GL_COLOR_ATTACHMENT0);
+            this->fbo_dst.Attach(array, GL_COLOR_ATTACHMENT0, (GLint)layer);
+            GL(glBlitNamedFramebuffer(
+                this->fbo_src.handle,
+                this->fbo_dst.handle,
+                0,
+                0,
+                size.x,
+                size.y,
+                0,
+                0,
+                bucket.width,
+                bucket.height,
+                GL_COLOR_BUFFER_BIT,
+                GL_LINEAR));
+
+            this->texture_refs[tex] = glm::uvec2((u32)ii, (u32)layer);
+        }
+
+        array.GenerateMipmaps();
+        this->arrays.push_back(array);
+    }
+}
+
+/* --- TransformTable --- */
+u32 TransformTable::Allocate()
+{
+    if (this->free_ids.empty()) {
+        // grow by a whole batch of identity transforms, the unused ones go on the free list
+        usize base = this->pos_x.size();
+
+        for (auto* vec : {
+                 &this->pos_x,
+                 &this->pos_y,
+                 &this->pos_z,
+                 &this->rot_x,
+                 &this->rot_y,
+                 &this->rot_z,
+             })
+        {
+            vec->resize(base + LANES, 0.0f);
+        }
+
+        for (auto* vec : {&this->rot_w, &this->scale_x, &this->scale_y, &this->scale_z}) {
+            vec->resize(base + LANES, 1.0f);
+        }
+
+        this->world.resize(base + LANES, glm::mat4(1.0f));
+        this->normal.resize(base + LANES, glm::mat3(1.0f));
+        this->wvp.resize(base + LANES, this->mtx_vp);
+        this->is_dirty.push_back(false);
+
+        for (usize ii = base + LANES; ii > base; ii--) {
+            this->free_ids.push_back((u32)(ii - 1));
+        }
+    }
+
+    u32 id = this->free_ids.back();
+    this->free_ids.pop_back();
+
+    return id;
+}
+
+void TransformTable::Release(u32 id)
+{
+    // reset to identity so the slot is ready to be handed out again
+    this->pos_x[id]   = 0.0f;
+    this->pos_y[id]   = 0.0f;
+    this->pos_z[id]   = 0.0f;
+    this->rot_x[id]   = 0.0f;
+    this->rot_y[id]   = 0.0f;
+    this->rot_z[id]   = 0.0f;
+    this->rot_w[id]   = 1.0f;
+    this->scale_x[id] = 1.0f;
+    this->scale_y[id] = 1.0f;
+    this->scale_z[id] = 1.0f;
+
+    this->world[id]  = glm::mat4(1.0f);
+    this->normal[id] = glm::mat3(1.0f);
+    this->wvp[id]    = this->mtx_vp;
+
+    this->free_ids.push_back(id);
+}
+
+void TransformTable::Copy(u32 dst, u32 src)
+{
+    this->pos_x[dst]   = this->pos_x[src];
+    this->pos_y[dst]   = this->pos_y[src];
+    this->pos_z[dst]   = this->pos_z[src];
+    this->rot_x[dst]   = this->rot_x[src];
+    this->rot_y[dst]   = this->rot_y[src];
+    this->rot_z[dst]   = this->rot_z[src];
+    this->rot_w[dst]   = this->rot_w[src];
+    this->scale_x[dst] = this->scale_x[src];
+    this->scale_y[dst] = this->scale_y[src];
+    this->scale_z[dst] = this->scale_z[src];
+
+    // the matrices are copied as well, so they stay valid until the next update
+    this->world[dst]  = this->world[src];
+    this->normal[dst] = this->normal[src];
+    this->wvp[dst]    = this->wvp[src];
+
+    // the source might still be waiting on an update
+    this->is_dirty[dst / LANES] |= this->is_dirty[src / LANES];
+}
+
+void TransformTable::MarkDirty(u32 id)
+{
+    this->is_dirty[id / LANES] = true;
+}
+
+void TransformTable::Update(const glm::mat4& new_mtx_vp)
+{
+    PROFILE_FUNCTION();
+
+    bool is_vp_changed = new_mtx_vp != this->mtx_vp;
+    this->mtx_vp       = new_mtx_vp;
+
+    for (usize batch = 0; batch < this->is_dirty.size(); batch++) {
+        if (!this->is_dirty[batch] && !is_vp_changed) {
+            continue;
+        }
+
+        this->UpdateBatch(batch * LANES, this->is_dirty[batch]);
+        this->is_dirty[batch] = false;
+    }
+}
+
+#ifdef __AVX2__
+// transposes the SoA elements of LANES column major matrices into the matrices
+template<typename Mat>
+static void StoreLanes(const __m256* elems, Mat* dst)
+{
+    constexpr usize ELEMS = sizeof(Mat) / sizeof(f32);
+
+    alignas(32) f32 lanes[ELEMS][TransformTable::LANES];
+    for (usize ee = 0; ee < ELEMS; ee++) {
+        _mm256_store_ps(lanes[ee], elems[ee]);
+    }
+
+    for (usize lane = 0; lane < TransformTable::LANES; lane++) {
+        f32* mtx = glm::value_ptr(dst[lane]);
+        for (usize ee = 0; ee < ELEMS; ee++) {
+            mtx[ee] = lanes[ee][lane];
+        }
+    }
+}
+
+void TransformTable::UpdateBatch(usize base, bool is_world_dirty)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one  = _mm256_set1_ps(1.0f);
+    const __m256 two  = _mm256_set1_ps(2.0f);
+
+    __m256 qx = _mm256_loadu_ps(&this->rot_x[base]);
+    __m256 qy = _mm256_loadu_ps(&this->rot_y[base]);
+    __m256 qz = _mm256_loadu_ps(&this->rot_z[base]);
+    __m256 qw = _mm256_loadu_ps(&this->rot_w[base]);
+
+    __m256 xx = _mm256_mul_ps(qx, qx);
+    __m256 yy = _mm256_mul_ps(qy, qy);
+    __m256 zz = _mm256_mul_ps(qz, qz);
+    __m256 xy = _mm256_mul_ps(qx, qy);
+    __m256 xz = _mm256_mul_ps(qx, qz);
+    __m256 yz = _mm256_mul_ps(qy, qz);
+    __m256 wx = _mm256_mul_ps(qw, qx);
+    __m256 wy = _mm256_mul_ps(qw, qy);
+    __m256 wz = _mm256_mul_ps(qw, qz);
+
+    // rotation matrix of the quaternion, same as glm::mat3_cast
+    __m256 rot[3][3];
+    rot[0][0] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz)));
+    rot[0][1] = _mm256_mul_ps(two, _mm256_add_ps(xy, wz));
+    rot[0][2] = _mm256_mul_ps(two, _mm256_sub_ps(xz, wy));
+    rot[1][0] = _mm256_mul_ps(two, _mm256_sub_ps(xy, wz));
+    rot[1][1] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz)));
+    rot[1][2] = _mm256_mul_ps(two, _mm256_add_ps(yz, wx));
+    rot[2][0] = _mm256_mul_ps(two, _mm256_add_ps(xz, wy));
+    rot[2][1] = _mm256_mul_ps(two, _mm256_sub_ps(yz, wx));
+    rot[2][2] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)));
+
+    __m256 scale[3] = {
+        _mm256_loadu_ps(&this->scale_x[base]),
+        _mm256_loadu_ps(&this->scale_y[base]),
+        _mm256_loadu_ps(&this->scale_z[base]),
+    };
+
+    // world matrix is T * R * S, elements are column major
+    __m256 world[16];
+    for (usize col = 0; col < 3; col++) {
+        for (usize row = 0; row < 3; row++) {
+            world[col * 4 + row] = _mm256_mul_ps(rot[col][row], scale[col]);
+        }
+        world[col * 4 + 3] = zero;
+    }
+    world[12] = _mm256_loadu_ps(&this->pos_x[base]);
+    world[13] = _mm256_loadu_ps(&this->pos_y[base]);
+    world[14] = _mm256_loadu_ps(&this->pos_z[base]);
+    world[15] = one;
+
+    if (is_world_dirty) {
+        // the inverse transpose of R * S is R * S^-1, no general inverse needed
+        __m256 normal[9];
+        for (usize col = 0; col < 3; col++) {
+            __m256 inv_scale = _mm256_div_ps(one, scale[col]);
+            for (usize row = 0; row < 3; row++) {
+                normal[col * 3 + row] = _mm256_mul_ps(rot[col][row], inv_scale);
+            }
+        }
+
+        StoreLanes(world, &this->world[base]);
+        StoreLanes(normal, &this->normal[base]);
+    }
+
+    __m256 wvp[16];
+    for (usize col = 0; col < 4; col++) {
+        for (usize row = 0; row < 4; row++) {
+            __m256 sum = zero;
+            for (usize kk = 0; kk < 4; kk++) {
+                __m256 vp = _mm256_set1_ps(this->mtx_vp[kk][row]);
+                sum       = _mm256_add_ps(sum, _mm256_mul_ps(vp, world[col * 4 + kk]));
+            }
+            wvp[col * 4 + row] = sum;
+        }
+    }
+
+    StoreLanes(wvp, &this->wvp[base]);
+}
+#else
+void TransformTable::UpdateBatch(usize base, bool is_world_dirty)
+{
+    for (usize ii = base; ii < base + LANES; ii++) {
+        if (is_world_dirty) {
+            glm::quat q
+                = glm::quat(this->rot_w[ii], this->rot_x[ii], this->rot_y[ii], this->rot_z[ii]);
+            glm::mat3 rot   = glm::mat3_cast(q);
+            glm::vec3 pos   = glm::vec3(this->pos_x[ii], this->pos_y[ii], this->pos_z[ii]);
+            glm::vec3 scale = glm::vec3(this->scale_x[ii], this->scale_y[ii], this->scale_z[ii]);
+
+            // world matrix is T * R * S, the inverse transpose of R * S is R * S^-1
+            this->world[ii] = glm::mat4(
+                glm::vec4(rot[0] * scale.x, 0.0f),
+                glm::vec4(rot[1] * scale.y, 0.0f),
+                glm::vec4(rot[2] * scale.z, 0.0f),
+                glm::vec4(pos, 1.0f));
+            this->normal[ii] = glm::mat3(rot[0] / scale.x, rot[1] / scale.y, rot[2] / scale.z);
+        }
+
+        this->wvp[ii] = this->mtx_vp * this->world[ii];
+    }
+}
+#endif
+
+/* --- Transform --- */
+Transform::Transform()
+{
+    this->id = TransformPool.Allocate();
+}
+
+Transform::Transform(const Transform& other)
+{
+    this->id = TransformPool.Allocate();
+    TransformPool.Copy(this->id, other.id);
+}
+
+Transform::Transform(Transform&& other) noexcept
+{
+    this->id = other.id;
+    other.id = INVALID_ID;
+}
+
+Transform::~Transform()
+{
+    if (this->id != INVALID_ID) {
+        TransformPool.Release(this->id);
+    }
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+    if (this->id == INVALID_ID) {
+        this->id = TransformPool.Allocate();
+    }
+
+    if (this->id != other.id) {
+        TransformPool.Copy(this->id, other.id);
+    }
 
-    sp.SetUniform("material.gloss", this->gloss);
+    return *this;
+}
+
+Transform& Transform::operator=(Transform&& other) noexcept
+{
+    std::swap(this->id, other.id);
+
+    return *this;
+}
+
+glm::vec3 Transform::Position() const
+{
+    return glm::vec3(
+        TransformPool.pos_x[this->id],
+        TransformPool.pos_y[this->id],
+        TransformPool.pos_z[this->id]);
+}
+
+Transform& Transform::Position(const glm::vec3& pos)
+{
+    TransformPool.pos_x[this->id] = pos.x;
+    TransformPool.pos_y[this->id] = pos.y;
+    TransformPool.pos_z[this->id] = pos.z;
+    TransformPool.MarkDirty(this->id);
+
+    return *this;
+}
+
+glm::quat Transform::Rotation() const
+{
+    return glm::quat(
+        TransformPool.rot_w[this->id],
+        TransformPool.rot_x[this->id],
+        TransformPool.rot_y[this->id],
+        TransformPool.rot_z[this->id]);
+}
+
+Transform& Transform::Rotation(const glm::quat& rot)
+{
+    glm::quat unit = glm::normalize(rot);
+
+    TransformPool.rot_x[this->id] = unit.x;
+    TransformPool.rot_y[this->id] = unit.y;
+    TransformPool.rot_z[this->id] = unit.z;
+    TransformPool.rot_w[this->id] = unit.w;
+    TransformPool.MarkDirty(this->id);
+
+    return *this;
+}
+
+glm::vec3 Transform::Scale() const
+{
+    return glm::vec3(
+        TransformPool.scale_x[this->id],
+        TransformPool.scale_y[this->id],
+        TransformPool.scale_z[this->id]);
+}
+
+Transform& Transform::Scale(const glm::vec3& scale)
+{
+    TransformPool.scale_x[this->id] = scale.x;
+    TransformPool.scale_y[this->id] = scale.y;
+    TransformPool.scale_z[this->id] = scale.z;
+    TransformPool.MarkDirty(this->id);
+
+    return *this;
+}
+
+const glm::mat4& Transform::WorldMatrix() const
+{
+    return TransformPool.world[this->id];
+}
+
+const glm::mat3& Transform::NormalMatrix() const
+{
+    return TransformPool.normal[this->id];
+}
+
+const glm::mat4& Transform::WVPMatrix() const
+{
+    return TransformPool.wvp[this->id];
 }
 
 /* --- Model --- */
@@ -462,31 +1093,43 @@ void Object::DrawShadow(ShaderProgram& sp) const
 
 glm::vec3 Object::Position() const
 {
-    return this->pos;
+    return this->transform.Position();
 }
 
 Object& Object::Position(const glm::vec3& new_pos)
 {
-    this->pos = new_pos;
+    this->transform.Position(new_pos);
 
     return *this;
 }
 
 glm::vec3 Object::Scale() const
 {
-    return this->scale;
+    return this->transform.Scale();
 }
 
 Object& Object::Scale(const glm::vec3& new_scale)
 {
-    this->scale = new_scale;
+    this->transform.Scale(new_scale);
 
     return *this;
 }
 
 Object& Object::Scale(f32 new_scale)
 {
-    this->scale = glm::vec3(new_scale);
+    this->transform.Scale(glm::vec3(new_scale));
+
+    return *this;
+}
+
+glm::quat Object::Rotation() const
+{
+    return this->transform.Rotation();
+}
+
+Object& Object::Rotation(const glm::quat& new_rot)
+{
+    this->transform.Rotation(new_rot);
 
     return *this;
 }
@@ -503,23 +1146,19 @@ Object& Object::CastsShadows(bool obj_casts_shadows)
     return *this;
 }
 
-glm::mat4 Object::WorldMatrix() const
+const glm::mat4& Object::WorldMatrix() const
 {
-    glm::mat4 mtx = glm::mat4(1.0f);
-    mtx           = glm::translate(mtx, this->pos);
-    mtx           = glm::scale(mtx, this->scale);
-
-    return mtx;
+    return this->transform.WorldMatrix();
 }
 
-// TODO: having to recompute the world matrix is annoying, but probably gets optimized away if both
-// are called adjacent
-glm::mat3 Object::NormalMatrix() const
+const glm::mat3& Object::NormalMatrix() const
 {
-    glm::mat4 world_mtx  = this->WorldMatrix();
-    glm::mat4 normal_mtx = glm::mat3(glm::transpose(glm::inverse(world_mtx)));
+    return this->transform.NormalMatrix();
+}
 
-    return normal_mtx;
+const glm::mat4& Object::WVPMatrix() const
+{
+    return this->transform.WVPMatrix();
 }
 
 /* --- Sprite3D --- */
@@ -550,10 +1189,10 @@ Sprite3D::Sprite3D(std::string_view tex_path)
 
     this->vbo.LoadData(sizeof(sprite_quad), &sprite_quad, GL_STATIC_DRAW);
 
-    this->vbo.Bind();
-    this->vao.SetAttribute(0, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, pos));
-    this->vao.SetAttribute(1, 3, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, norm));
-    this->vao.SetAttribute(2, 2, GL_FLOAT, sizeof(Vertex), offsetof(Vertex, tex));
+    this->vao.SetVertexBuffer(this->vbo, sizeof(Vertex));
+    this->vao.SetAttribute(0, 3, GL_FLOAT, offsetof(Vertex, pos));
+    this->vao.SetAttribute(1, 3, GL_FLOAT, offsetof(Vertex, norm));
+    this->vao.SetAttribute(2, 2, GL_FLOAT, offsetof(Vertex, tex));
 
     this->is_vao_initialized = true;
 }
@@ -628,5 +1267,4 @@ void Sprite3D::Draw(ShaderProgram& sp) const
 
     this->vao.Bind();
     GL(glDrawArrays(GL_TRIANGLES, 0, lengthof(sprite_quad)));
-    this->vao.Unbind();
 }
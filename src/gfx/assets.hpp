@@ -4,6 +4,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <optional>
 #include <unordered_map>
@@ -12,6 +13,7 @@
 #include "common.hpp"
 #include "gfx/cache.hpp"
 #include "gfx/opengl.hpp"
+#include "gfx/silhouette.hpp"
 
 constexpr const char* DefaultTexture_Diffuse  = ".NO_DIFFUSE";
 constexpr const char* DefaultTexture_Specular = ".NO_SPECULAR";
@@ -27,6 +29,7 @@ struct Material {
     Texture2D* specular;
     Texture2D* normal;
     f32        gloss;
+    u32        id; // index into MaterialPool
 
     Material();
     Material(const aiMaterial& material, std::string_view directory);
@@ -34,6 +37,57 @@ struct Material {
     void Use(ShaderProgram& sp) const;
 };
 
+// Every material in a single SSBO indexed by material ID, so that changing materials between draws
+// only changes an integer uniform
+// Textures are referenced by ARB_bindless_texture handles when available, otherwise they're copied
+// into texture arrays bucketed by size and referenced by (array, layer)
+struct MaterialTable {
+    static constexpr usize MAX_TEXTURE_ARRAYS = 8;
+
+    // NOTE: must match the bindings in Lighting_FS
+    static constexpr GLuint SSBO_SLOT    = 4;
+    static constexpr GLuint TEXTURE_SLOT = 5; // first of MAX_TEXTURE_ARRAYS consecutive slots
+
+    // NOTE: must match the layout of Material in Lighting_FS
+    struct GPU_Material {
+        glm::uvec2 diffuse;
+        glm::uvec2 specular;
+        glm::uvec2 normal;
+        f32        gloss;
+        f32        padding;
+    };
+
+    struct Bucket {
+        GLint                   width, height;
+        bool                    is_srgb;
+        std::vector<Texture2D*> textures;
+    };
+
+    std::vector<Material> materials;
+    bool                  is_dirty = false;
+
+    // bindless handle or (array, layer) of every texture used by a material
+    std::unordered_map<const Texture2D*, glm::uvec2> texture_refs;
+
+    std::vector<TextureArray2D> arrays;
+    FBO                         fbo_src, fbo_dst;
+    SSBO                        ssbo;
+
+    static bool IsBindless();
+
+    // returns the ID of the material, materials with the same textures and gloss share an ID
+    u32 Register(const Material& material);
+
+    // uploads the table if materials were registered since the last call
+    void Upload();
+    void Use() const;
+
+    void BuildTextureArrays();
+    void MakeTexturesResident();
+};
+
+extern MaterialTable MaterialPool;
+
 struct Vertex {
     glm::vec3 pos       = {0.0f, 0.0f, 0.0f};
     glm::vec3 norm      = {0.0f, 0.0f, 0.0f};
@@ -46,18 +100,51 @@ struct Geometry {
     usize len_visual;
     usize len_shadow;
 
+    // where the visual vertices and indices live in GeometryPool
+    u32 first_index;
+    i32 base_vertex;
+
     VAO vao_visual;
     VAO vao_shadow;
     VBO vbo;
     EBO ebo_visual;
     EBO ebo_shadow;
 
+    SilhouetteMesh silhouette;
+
+    // local space bounds
+    glm::vec3 aabb_min;
+    glm::vec3 aabb_max;
+
     Geometry(const aiMesh& mesh);
 
     void DrawVisual(ShaderProgram& sp) const;
     void DrawShadow(ShaderProgram& sp) const;
 };
 
+// Vertices and visual indices of every Geometry in one pair of buffers, so that any set of models
+// can be drawn by a single multi draw call
+struct GeometryTable {
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    bool                is_dirty = false;
+
+    VAO vao;
+    VBO vbo;
+    EBO ebo;
+
+    // returns the offset of the geometry's first index, its vertices start at base_vertex
+    u32 Register(
+        const std::vector<Vertex>& geometry_vertices,
+        const std::vector<GLuint>& geometry_indices,
+        i32*                       base_vertex);
+
+    // uploads the buffers if geometry was registered since the last call
+    void Upload();
+};
+
+extern GeometryTable GeometryPool;
+
 // TODO: Model cache
 struct Model {
     Geometry geometry;
@@ -69,15 +156,74 @@ struct Model {
     void DrawShadow(ShaderProgram& sp) const;
 };
 
+// Position, rotation and scale of every object in SoA arrays padded to a multiple of LANES, the
+// matrices derived from them are rebuilt a batch of LANES transforms at a time by Update
+struct TransformTable {
+    static constexpr usize LANES = 8;
+
+    std::vector<f32> pos_x, pos_y, pos_z;
+    std::vector<f32> rot_x, rot_y, rot_z, rot_w; // unit quaternion
+    std::vector<f32> scale_x, scale_y, scale_z;
+
+    std::vector<u8>  is_dirty; // per batch, set when any transform of the batch changed
+    std::vector<u32> free_ids;
+
+    // world and normal are only rebuilt for dirty batches, wvp for every batch when the VP changes
+    std::vector<glm::mat4> world;
+    std::vector<glm::mat3> normal;
+    std::vector<glm::mat4> wvp;
+
+    glm::mat4 mtx_vp = glm::mat4(1.0f); // VP the wvp matrices were built with
+
+    // returns the ID of a new identity transform
+    u32  Allocate();
+    void Release(u32 id);
+    void Copy(u32 dst, u32 src);
+    void MarkDirty(u32 id);
+
+    // rebuilds the matrices that are out of date, called once per frame before any pass runs
+    void Update(const glm::mat4& new_mtx_vp);
+    void UpdateBatch(usize base, bool is_world_dirty);
+};
+
+extern TransformTable TransformPool;
+
+// Owning reference to a transform in TransformPool, copies get a transform of their own
+// NOTE: the matrices are the ones built by the last TransformPool.Update, changes made after it
+// show up in the next frame
+struct Transform {
+    static constexpr u32 INVALID_ID = UINT32_MAX; // left behind by a move
+
+    u32 id;
+
+    Transform();
+    Transform(const Transform& other);
+    Transform(Transform&& other) noexcept;
+    ~Transform();
+
+    Transform& operator=(const Transform& other);
+    Transform& operator=(Transform&& other) noexcept;
+
+    glm::vec3  Position() const;
+    Transform& Position(const glm::vec3& pos);
+
+    glm::quat  Rotation() const;
+    Transform& Rotation(const glm::quat& rot);
+
+    glm::vec3  Scale() const;
+    Transform& Scale(const glm::vec3& scale);
+
+    const glm::mat4& WorldMatrix() const;
+    const glm::mat3& NormalMatrix() const;
+    const glm::mat4& WVPMatrix() const;
+};
+
 // TODO: I don't like that we have to separately expose draw shadows and draw visual
 // but the way shaders work doesn't facilitate a better interface in the current arch
-// TODO: we could avoid having to recompute the matrices if we cached the world/normal matrices
 struct Object {
     std::vector<Model> models;
 
-    glm::vec3 scale = {1.0f, 1.0f, 1.0f};
-    glm::vec3 pos   = {0.0f, 0.0f, 0.0f};
-    // TODO: rotation
+    Transform transform;
 
     bool casts_shadows = false;
 
@@ -93,11 +239,15 @@ struct Object {
     Object&   Scale(const glm::vec3& new_scale);
     Object&   Scale(f32 new_scale);
 
+    glm::quat Rotation() const;
+    Object&   Rotation(const glm::quat& new_rot);
+
     bool    CastsShadows() const;
     Object& CastsShadows(bool casts_shadows);
 
-    glm::mat4 WorldMatrix() const;
-    glm::mat3 NormalMatrix() const;
+    const glm::mat4& WorldMatrix() const;
+    const glm::mat3& NormalMatrix() const;
+    const glm::mat4& WVPMatrix() const;
 };
 
 // TODO: maybe we should have two subtypes: EmissiveSprite3D and DiffuseSprite3D
@@ -0,0 +1,313 @@
+#include "capture.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <utility>
+
+#include <stb/stb_image_write.h>
+
+#include "common/config.hpp"
+#include "gfx/readback.hpp"
+#include "utils/profiling.hpp"
+
+/* --- Encoding --- */
+struct RGBA8 {
+    u8 r, g, b, a;
+
+    bool operator==(const RGBA8&) const = default;
+};
+
+static void PushU32BE(std::vector<u8>& out, u32 value)
+{
+    out.push_back((u8)(value >> 24));
+    out.push_back((u8)(value >> 16));
+    out.push_back((u8)(value >> 8));
+    out.push_back((u8)(value >> 0));
+}
+
+// see the QOI specification, https://qoiformat.org/qoi-specification.pdf
+static std::vector<u8> EncodeQOI(const u8* pixels, i32 width, i32 height)
+{
+    constexpr u8 OP_INDEX = 0x00;
+    constexpr u8 OP_DIFF  = 0x40;
+    constexpr u8 OP_LUMA  = 0x80;
+    constexpr u8 OP_RUN   = 0xc0;
+    constexpr u8 OP_RGB   = 0xfe;
+    constexpr u8 OP_RGBA  = 0xff;
+
+    constexpr i32 MAX_RUN = 62;
+
+    usize           num_pixels = (usize)width * (usize)height;
+    std::vector<u8> out;
+    out.reserve(num_pixels * 2);
+
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    PushU32BE(out, (u32)width);
+    PushU32BE(out, (u32)height);
+    out.push_back(4); // channels
+    out.push_back(0); // sRGB with linear alpha
+
+    RGBA8 seen[64] = {};
+    RGBA8 prev     = {0, 0, 0, 255};
+    i32   run      = 0;
+
+    for (usize ii = 0; ii < num_pixels; ii++) {
+        RGBA8 px;
+        memcpy(&px, &pixels[ii * 4], sizeof(px));
+
+        if (px == prev) {
+            run += 1;
+            if (run == MAX_RUN) {
+                out.push_back(OP_RUN | (u8)(run - 1));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            out.push_back(OP_RUN | (u8)(run - 1));
+            run = 0;
+        }
+
+        u32 hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+
+        if (seen[hash] == px) {
+            out.push_back(OP_INDEX | (u8)hash);
+        } else if (px.a != prev.a) {
+            out.insert(out.end(), {OP_RGBA, px.r, px.g, px.b, px.a});
+        } else {
+            // differences wrap around, as the decoder adds them modulo 256
+            i8 dr    = (i8)(px.r - prev.r);
+            i8 dg    = (i8)(px.g - prev.g);
+            i8 db    = (i8)(px.b - prev.b);
+            i8 dr_dg = (i8)(dr - dg);
+            i8 db_dg = (i8)(db - dg);
+
+            bool is_small = dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1;
+            bool is_luma  = dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8
+                            && db_dg <= 7;
+
+            if (is_small) {
+                out.push_back(OP_DIFF | (u8)((dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (is_luma) {
+                out.push_back(OP_LUMA | (u8)(dg + 32));
+                out.push_back((u8)((dr_dg + 8) << 4 | (db_dg + 8)));
+            } else {
+                out.insert(out.end(), {OP_RGB, px.r, px.g, px.b});
+            }
+        }
+
+        seen[hash] = px;
+        prev       = px;
+    }
+
+    if (run > 0) {
+        out.push_back(OP_RUN | (u8)(run - 1));
+    }
+
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    return out;
+}
+
+static bool WriteQOI(const char* path, const u8* pixels, i32 width, i32 height)
+{
+    std::vector<u8> encoded = EncodeQOI(pixels, width, height);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    usize written = fwrite(encoded.data(), 1, encoded.size(), file);
+    fclose(file);
+
+    return written == encoded.size();
+}
+
+static bool WritePNG(const char* path, const u8* pixels, i32 width, i32 height)
+{
+    return stbi_write_png(path, width, height, 4, pixels, width * 4) != 0;
+}
+
+// OpenGL reads the bottom row first and the backbuffer's alpha isn't meaningful
+static void PrepareImage(std::vector<u8>& pixels, i32 width, i32 height)
+{
+    usize pitch = (usize)width * 4;
+
+    for (i32 yy = 0; yy < height / 2; yy++) {
+        u8* top    = &pixels[yy * pitch];
+        u8* bottom = &pixels[(height - 1 - yy) * pitch];
+        std::swap_ranges(top, top + pitch, bottom);
+    }
+
+    for (usize ii = 3; ii < pixels.size(); ii += 4) {
+        pixels[ii] = 255;
+    }
+}
+
+static std::string Timestamp()
+{
+    auto now = std::chrono::system_clock::now();
+    auto ms  = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
+
+    time_t time = std::chrono::system_clock::to_time_t(now);
+    char   date[32];
+    strftime(date, sizeof(date), "%Y%m%d_%H%M%S", localtime(&time));
+
+    char stamp[48];
+    snprintf(stamp, sizeof(stamp), "%s_%03d", date, (int)(ms.count() % 1000));
+    return stamp;
+}
+
+static const char* Extension(ImageFormat format)
+{
+    return format == ImageFormat::PNG ? "png" : "qoi";
+}
+
+/* --- FrameCapture --- */
+FrameCapture::FrameCapture(usize num_workers)
+{
+    for (usize ii = 0; ii < num_workers; ii++) {
+        this->workers.emplace_back(&FrameCapture::WorkerLoop, this);
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    {
+        std::lock_guard lock(this->mutex);
+        this->is_stopping = true;
+    }
+    this->cv_jobs.notify_all();
+
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+void FrameCapture::WorkerLoop()
+{
+    while (true) {
+        std::unique_lock lock(this->mutex);
+        this->cv_jobs.wait(lock, [&]() { return this->is_stopping || !this->jobs.empty(); });
+
+        // queued jobs are still finished when stopping
+        if (this->jobs.empty()) {
+            return;
+        }
+
+        Job job = std::move(this->jobs.front());
+        this->jobs.pop_front();
+        lock.unlock();
+
+        PrepareImage(job.pixels, job.width, job.height);
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(job.path).parent_path(), error);
+
+        auto write      = job.format == ImageFormat::PNG ? WritePNG : WriteQOI;
+        bool is_written = write(job.path.c_str(), job.pixels.data(), job.width, job.height);
+
+        if (!is_written) {
+            LOG_WARNING("Failed to write capture to %s", job.path.c_str());
+        }
+    }
+}
+
+void FrameCapture::Enqueue(Job job)
+{
+    {
+        std::lock_guard lock(this->mutex);
+        if (this->jobs.size() >= MAX_QUEUED_JOBS) {
+            LOG_WARNING("Encoding is falling behind, dropped capture %s", job.path.c_str());
+            return;
+        }
+
+        this->jobs.push_back(std::move(job));
+    }
+    this->cv_jobs.notify_one();
+}
+
+void FrameCapture::ReadBackbuffer(std::string path, ImageFormat format, i32 width, i32 height)
+{
+    PROFILE_FUNCTION();
+
+    auto on_read = [this, path, format, width, height](const u8* data, usize size) {
+        this->Enqueue({
+            .path   = path,
+            .format = format,
+            .width  = width,
+            .height = height,
+            .pixels = std::vector<u8>(data, data + size),
+        });
+    };
+
+    bool is_queued = Readback.ReadFramebuffer(
+        FBO(0),
+        GL_BACK,
+        0,
+        0,
+        width,
+        height,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        on_read);
+
+    if (!is_queued) {
+        LOG_WARNING("Readbacks are falling behind, dropped capture %s", path.c_str());
+    }
+}
+
+void FrameCapture::Screenshot(ImageFormat format, i32 width, i32 height)
+{
+    std::string path
+        = std::string(RENDER_CAPTURE_DIR) + "/screenshot_" + Timestamp() + "." + Extension(format);
+
+    LOG_INFO("Saving screenshot to %s", path.c_str());
+    this->ReadBackbuffer(std::move(path), format, width, height);
+}
+
+void FrameCapture::StartSequence(ImageFormat format)
+{
+    this->sequence_dir    = std::string(RENDER_CAPTURE_DIR) + "/sequence_" + Timestamp();
+    this->sequence_format = format;
+    this->sequence_frame  = 0;
+    this->is_recording    = true;
+
+    LOG_INFO("Recording frames to %s", this->sequence_dir.c_str());
+}
+
+void FrameCapture::StopSequence()
+{
+    this->is_recording = false;
+
+    LOG_INFO("Recorded %" PRIu64 " frames", this->sequence_frame);
+}
+
+bool FrameCapture::IsRecording() const
+{
+    return this->is_recording;
+}
+
+void FrameCapture::CaptureFrame(i32 width, i32 height)
+{
+    if (!this->is_recording) {
+        return;
+    }
+
+    char name[32];
+    snprintf(
+        name,
+        sizeof(name),
+        "/frame_%06" PRIu64 ".%s",
+        this->sequence_frame,
+        Extension(this->sequence_format));
+
+    this->ReadBackbuffer(this->sequence_dir + name, this->sequence_format, width, height);
+    this->sequence_frame += 1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+enum class ImageFormat {
+    PNG,
+    QOI, // much faster to encode than PNG, which keeps up better with sequences
+};
+
+// Screenshots and frame sequences of the backbuffer, read back through Readback and encoded on
+// threads of its own so neither the render thread nor WorkerThreads() wait on encoding or the disk
+// Files go to RENDER_CAPTURE_DIR, named after the time the capture started
+struct FrameCapture {
+    // encoded frames waiting beyond this are dropped rather than piling up in memory
+    static constexpr usize MAX_QUEUED_JOBS = 32;
+
+    struct Job {
+        std::string     path;
+        ImageFormat     format;
+        i32             width;
+        i32             height;
+        std::vector<u8> pixels; // RGBA8, bottom row first as OpenGL reads them
+    };
+
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable cv_jobs;
+    std::deque<Job>         jobs;
+    bool                    is_stopping = false;
+
+    std::string sequence_dir;
+    ImageFormat sequence_format = ImageFormat::QOI;
+    u64         sequence_frame  = 0;
+    bool        is_recording    = false;
+
+    FrameCapture(usize num_workers = 2);
+    // finishes encoding whatever was queued, Readback has to be flushed before then
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&)            = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // both read the backbuffer as it is when called, so call them after the frame was rendered
+    void Screenshot(ImageFormat format, i32 width, i32 height);
+    void CaptureFrame(i32 width, i32 height); // adds a frame to the sequence, if one is recording
+
+    void StartSequence(ImageFormat format);
+    void StopSequence();
+    bool IsRecording() const;
+
+    void ReadBackbuffer(std::string path, ImageFormat format, i32 width, i32 height);
+    void Enqueue(Job job);
+    void WorkerLoop();
+};
@@ -0,0 +1,251 @@
+#include "framegraph.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "utils/profiling.hpp"
+
+void FrameGraph::Reset()
+{
+    this->resources.clear();
+    this->passes.clear();
+    this->order.clear();
+}
+
+u32 FrameGraph::Create(const char* name, const TextureDesc& desc)
+{
+    this->resources.push_back({
+        .name                = name,
+        .desc                = desc,
+        .discard_attachments = {GL_COLOR_ATTACHMENT0},
+    });
+
+    return (u32)(this->resources.size() - 1);
+}
+
+u32 FrameGraph::Import(
+    const char*         name,
+    const TextureDesc&  desc,
+    TextureRT           tex,
+    FBO                 fbo,
+    std::vector<GLenum> discard_attachments)
+{
+    this->resources.push_back({
+        .name                = name,
+        .desc                = desc,
+        .imported_tex        = tex,
+        .imported_fbo        = fbo,
+        .is_imported         = true,
+        .discard_attachments = std::move(discard_attachments),
+    });
+
+    return (u32)(this->resources.size() - 1);
+}
+
+void FrameGraph::Output(u32 resource)
+{
+    this->resources[resource].is_output = true;
+    this->resources[resource].discard_attachments.clear();
+}
+
+u32 FrameGraph::AddPass(
+    const char*                            name,
+    std::vector<u32>                       reads,
+    std::vector<u32>                       writes,
+    std::function<void(const FrameGraph&)> execute)
+{
+    u32 pass = (u32)this->passes.size();
+
+    for (u32 res : writes) {
+        ASSERT(this->resources[res].writer == NONE);
+        this->resources[res].writer = pass;
+    }
+
+    this->passes.push_back({
+        .name    = name,
+        .reads   = std::move(reads),
+        .writes  = std::move(writes),
+        .execute = std::move(execute),
+    });
+
+    return pass;
+}
+
+// appends the pass after every pass it depends on
+void FrameGraph::Visit(u32 pass)
+{
+    Pass& node = this->passes[pass];
+    if (node.mark == Mark::Visited) {
+        return;
+    }
+
+    // a pass reading something that depends on its own output
+    ASSERT(node.mark != Mark::Visiting);
+    node.mark = Mark::Visiting;
+
+    for (u32 res : node.reads) {
+        const Resource& resource = this->resources[res];
+
+        // transient resources have to be written by a pass before they can be read
+        ASSERT(resource.is_imported || resource.writer != NONE);
+        if (resource.writer != NONE) {
+            this->Visit(resource.writer);
+        }
+    }
+
+    node.mark = Mark::Visited;
+    this->order.push_back(pass);
+}
+
+// finds a pooled texture that isn't in use by then, or adds one to the pool
+u32 FrameGraph::Acquire(const TextureDesc& desc, u32 first_use, u32 last_use)
+{
+    for (u32 ii = 0; ii < this->pool.size(); ii++) {
+        PooledTexture& pooled = this->pool[ii];
+        if (pooled.desc != desc) {
+            continue;
+        }
+
+        if (!pooled.is_used || pooled.busy_until < first_use) {
+            pooled.is_used    = true;
+            pooled.busy_until = last_use;
+            return ii;
+        }
+    }
+
+    PooledTexture pooled = {
+        .desc       = desc,
+        .is_used    = true,
+        .busy_until = last_use,
+    };
+
+    pooled.tex.Reserve();
+    pooled.tex.Setup(desc.format, desc.width, desc.height, desc.levels);
+
+    pooled.fbo.Reserve();
+    pooled.fbo.Attach(pooled.tex, GL_COLOR_ATTACHMENT0);
+    pooled.fbo.CheckComplete();
+
+    this->pool.push_back(pooled);
+    return (u32)(this->pool.size() - 1);
+}
+
+void FrameGraph::Compile()
+{
+    PROFILE_FUNCTION();
+
+    this->order.clear();
+
+    // passes that can't be reached from an output don't contribute to the frame and are culled
+    for (const auto& resource : this->resources) {
+        if (resource.is_output && resource.writer != NONE) {
+            this->Visit(resource.writer);
+        }
+    }
+
+    for (u32 pos = 0; pos < this->order.size(); pos++) {
+        const Pass& pass = this->passes[this->order[pos]];
+
+        for (const auto* list : {&pass.reads, &pass.writes}) {
+            for (u32 res : *list) {
+                Resource& resource = this->resources[res];
+                // positions only increase, so the last one seen is the last use
+                resource.first_use = std::min(resource.first_use, pos);
+                resource.last_use  = pos;
+            }
+        }
+    }
+
+    // textures the last frame didn't use are dropped, this is also how resizes free the old sizes
+    std::erase_if(this->pool, [](PooledTexture& pooled) {
+        if (!pooled.is_used) {
+            pooled.fbo.Delete();
+            pooled.tex.Delete();
+        }
+
+        return !pooled.is_used;
+    });
+
+    for (auto& pooled : this->pool) {
+        pooled.is_used    = false;
+        pooled.busy_until = NONE;
+    }
+
+    // resources are backed in the order they come alive, a texture is handed to the next resource
+    // once the last pass using its current one has run
+    for (u32 pos = 0; pos < this->order.size(); pos++) {
+        const Pass& pass = this->passes[this->order[pos]];
+
+        for (u32 res : pass.writes) {
+            Resource& resource = this->resources[res];
+            if (!resource.is_imported && resource.first_use == pos) {
+                resource.pooled = this->Acquire(resource.desc, pos, resource.last_use);
+            }
+        }
+    }
+}
+
+void FrameGraph::Execute()
+{
+    PROFILE_FUNCTION();
+
+    for (u32 pos = 0; pos < this->order.size(); pos++) {
+        Pass& pass = this->passes[this->order[pos]];
+
+        {
+            PROFILE_SCOPE(pass.name);
+            pass.execute(*this);
+        }
+
+        // the contents of dead resources don't have to be kept, which lets tiled GPUs skip the
+        // store and the driver skip any resolve or decompression
+        for (const auto* list : {&pass.reads, &pass.writes}) {
+            for (u32 res : *list) {
+                Resource& resource = this->resources[res];
+                if (resource.last_use != pos || resource.discard_attachments.empty()) {
+                    continue;
+                }
+
+                GL(glInvalidateNamedFramebufferData(
+                    this->Target(res).handle,
+                    (GLsizei)resource.discard_attachments.size(),
+                    resource.discard_attachments.data()));
+
+                // a resource read and written by the same pass is only invalidated once
+                resource.discard_attachments.clear();
+            }
+        }
+    }
+}
+
+const FrameGraph::TextureDesc& FrameGraph::Desc(u32 resource) const
+{
+    return this->resources[resource].desc;
+}
+
+const TextureRT& FrameGraph::Texture(u32 resource) const
+{
+    const Resource& res = this->resources[resource];
+    if (res.is_imported) {
+        return res.imported_tex;
+    }
+
+    ASSERT(res.pooled != NONE);
+    return this->pool[res.pooled].tex;
+}
+
+const FBO& FrameGraph::Target(u32 resource) const
+{
+    const Resource& res = this->resources[resource];
+    if (res.is_imported) {
+        return res.imported_fbo;
+    }
+
+    ASSERT(res.pooled != NONE);
+    return this->pool[res.pooled].fbo;
+}
+
+usize FrameGraph::CulledPasses() const
+{
+    return this->passes.size() - this->order.size();
+}
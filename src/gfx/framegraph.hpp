@@ -0,0 +1,103 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "common.hpp"
+#include "gfx/opengl.hpp"
+
+// Passes of a frame declared with the textures they read and write, the graph orders them by their
+// dependencies, culls the ones that don't contribute to an output, and backs transient textures
+// with a pool shared by every resource that is never alive at the same time as another
+// NOTE: the graph is rebuilt every frame, resource and pass IDs are only valid until the next Reset
+struct FrameGraph {
+    static constexpr u32 NONE = UINT32_MAX;
+
+    struct TextureDesc {
+        GLenum  format;
+        GLsizei width, height;
+        GLsizei levels = 1; // the FBO only attaches the first
+
+        bool operator==(const TextureDesc& other) const = default;
+    };
+
+    struct Resource {
+        const char* name;
+        TextureDesc desc;
+
+        // transient resources are backed by a pooled texture, imported ones by a texture and FBO
+        // owned outside of the graph
+        u32       pooled       = NONE;
+        TextureRT imported_tex = {};
+        FBO       imported_fbo = {};
+        bool      is_imported  = false;
+        bool      is_output    = false;
+
+        // invalidated after the last pass that uses the resource, empty if the contents have to
+        // outlive the frame
+        std::vector<GLenum> discard_attachments;
+
+        u32 writer    = NONE; // every resource is written by at most one pass
+        u32 first_use = NONE; // position in the execution order
+        u32 last_use  = NONE;
+    };
+
+    enum class Mark {
+        Unvisited,
+        Visiting,
+        Visited,
+    };
+
+    struct Pass {
+        const char*                            name;
+        std::vector<u32>                       reads;
+        std::vector<u32>                       writes;
+        std::function<void(const FrameGraph&)> execute;
+
+        Mark mark = Mark::Unvisited;
+    };
+
+    struct PooledTexture {
+        TextureDesc desc;
+        TextureRT   tex = {};
+        FBO         fbo = {}; // tex as the only color attachment
+
+        bool is_used    = false; // by a resource of the current frame
+        u32  busy_until = NONE;  // last use of the resource it currently backs
+    };
+
+    std::vector<Resource>      resources;
+    std::vector<Pass>          passes;
+    std::vector<u32>           order; // passes that weren't culled, in execution order
+    std::vector<PooledTexture> pool;  // kept across frames, dropped once a frame goes unused
+
+    void Reset();
+
+    u32 Create(const char* name, const TextureDesc& desc);
+    u32 Import(
+        const char*         name,
+        const TextureDesc&  desc,
+        TextureRT           tex,
+        FBO                 fbo,
+        std::vector<GLenum> discard_attachments = {});
+    // marks a resource as a result of the frame, the passes it depends on are never culled
+    void Output(u32 resource);
+
+    u32 AddPass(
+        const char*                            name,
+        std::vector<u32>                       reads,
+        std::vector<u32>                       writes,
+        std::function<void(const FrameGraph&)> execute);
+
+    void Compile();
+    void Execute();
+
+    const TextureDesc& Desc(u32 resource) const;
+    const TextureRT&   Texture(u32 resource) const;
+    const FBO&         Target(u32 resource) const;
+
+    usize CulledPasses() const;
+
+    void Visit(u32 pass);
+    u32  Acquire(const TextureDesc& desc, u32 first_use, u32 last_use);
+};
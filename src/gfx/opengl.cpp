@@ -3,69 +3,509 @@
 #include <GL/glew.h>
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <string>
 
 #include "common.hpp"
 #include "utils/settings.hpp"
 
 // TODO: Texture binds should take the active texture as an argument
 
-Shader CompileShader(GLenum shader_type, GLsizei count, const GLchar** src, const GLint* len)
+/* --- Shaders --- */
+ShaderCache ShaderPool;
+
+// FNV-1a, stable across runs since program binaries are stored under these hashes
+static u64 HashBytes(u64 hash, const void* data, usize len)
+{
+    const u8* bytes = (const u8*)data;
+    for (usize ii = 0; ii < len; ii++) {
+        hash = (hash ^ bytes[ii]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static constexpr u64 HASH_BASIS = 0xcbf29ce484222325ull;
+
+/* --- SPIR-V modules --- */
+// what glslangValidator infers the stage from
+static const char* ShaderStageExtension(GLenum shader_type)
+{
+    switch (shader_type) {
+        case GL_VERTEX_SHADER:
+            return "vert";
+        case GL_FRAGMENT_SHADER:
+            return "frag";
+        case GL_GEOMETRY_SHADER:
+            return "geom";
+        case GL_COMPUTE_SHADER:
+            return "comp";
+        default:
+            ABORT("Unsupported shader stage 0x%x", shader_type);
+    }
+}
+
+static std::string ShaderCachePath(u64 hash, const char* extension)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016" PRIx64 ".%s", hash, extension);
+    return std::string(RENDER_SHADER_CACHE_DIR) + name;
+}
+
+static bool IsSpirvEnabled()
+{
+    static const bool is_enabled = settings.spirv_shaders && GLEW_ARB_gl_spirv;
+    return is_enabled && !ShaderPool.is_spirv_disabled;
+}
+
+// the source `make spirv` compiles into the module LoadSpirv looks for under the same hash
+static void ExportShaderSource(GLenum shader_type, u64 hash, const std::string& source)
+{
+    std::error_code error;
+    std::filesystem::create_directories(RENDER_SHADER_CACHE_DIR, error);
+
+    std::string path = ShaderCachePath(hash, ShaderStageExtension(shader_type));
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_WARNING("Failed to export shader source '%s'", path.c_str());
+        return;
+    }
+
+    fwrite(source.data(), 1, source.size(), file);
+    fclose(file);
+}
+
+// name is only used to report a module the driver rejects
+static bool SpecializeSpirv(GLuint shader, const void* module, usize len, const char* name)
+{
+    GL(glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module, (GLsizei)len));
+    GL(glSpecializeShader(shader, "main", 0, nullptr, nullptr));
+
+    // specializing is where the driver validates the module, a module it rejects (stale, or
+    // built by a glslang it disagrees with) is replaced by the source
+    GLint success;
+    GL(glGetShaderiv(shader, GL_COMPILE_STATUS, &success));
+    if (!success) {
+        char info_log[RENDER_SHADER_LOG_SIZE];
+        GL(glGetShaderInfoLog(shader, sizeof(info_log), nullptr, info_log));
+        LOG_WARNING("Failed to specialize '%s', compiling from source: %s", name, info_log);
+    }
+
+    return success;
+}
+
+static bool LoadSpirv(GLuint shader, u64 hash)
+{
+    std::string path = ShaderCachePath(hash, "spv");
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::vector<u8> module;
+    u8              chunk[4096];
+    usize           chunk_len;
+    while ((chunk_len = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        module.insert(module.end(), chunk, chunk + chunk_len);
+    }
+
+    fclose(file);
+
+    return SpecializeSpirv(shader, module.data(), module.size(), path.c_str());
+}
+
+Shader ShaderCache::Get(
+    GLenum            shader_type,
+    GLsizei           count,
+    const GLchar**    src,
+    const GLint*      len,
+    const ShaderFile* spirv)
 {
     ASSERT(count > 0);
 
+    std::string source;
+    for (GLsizei ii = 0; ii < count; ii++) {
+        source.append(src[ii], len[ii]);
+    }
+
+    u64 hash = HashBytes(HASH_BASIS, &shader_type, sizeof(shader_type));
+    hash     = HashBytes(hash, source.data(), source.size());
+
+    auto iter = this->entries.find(hash);
+    if (iter != this->entries.end()) {
+        ASSERT(iter->second.type == shader_type && iter->second.source == source);
+        return iter->second.shader;
+    }
+
+    if (settings.export_shader_sources) {
+        ExportShaderSource(shader_type, hash, source);
+    }
+
     GLuint shader;
     GL(shader = glCreateShader(shader_type));
-    GL(glShaderSource(shader, count, src, len));
-    GL(glCompileShader(shader));
 
-    // check vertex shader compile status
-    if constexpr (RENDER_CHECK_SHADER_COMPILE) {
-        GLint success;
-        char  info_log[RENDER_SHADER_LOG_SIZE];
-        GL(glGetShaderiv(shader, GL_COMPILE_STATUS, &success));
+    this->entries.emplace(
+        hash,
+        Entry{
+            .shader = Shader(shader),
+            .type   = shader_type,
+            .source = std::move(source),
+            .spirv  = spirv,
+        });
+    this->hashes.emplace(shader, hash);
 
-        if (!success) {
-            GL(glGetShaderInfoLog(shader, sizeof(info_log), nullptr, info_log));
-            ABORT(
-                "Compilation of shader failed:\n"
-                "Reason: %s\n",
-                info_log);
-        }
+    return Shader(shader);
+}
+
+bool ShaderCache::CompileSpirv(Shader shader)
+{
+    u64    hash  = this->Hash(shader);
+    Entry& entry = this->entries.at(hash);
+    if (entry.is_compiled && entry.is_spirv) {
+        return true;
     }
 
-    return Shader(shader);
+    if (!IsSpirvEnabled() || entry.is_spirv_missing) {
+        return false;
+    }
+
+    // modules exported to the disk cache are only the fallback for shaders without an embedded one
+    bool is_specialized;
+    if (entry.spirv != nullptr) {
+        char name[48];
+        snprintf(name, sizeof(name), "embedded module %016" PRIx64, hash);
+        is_specialized = SpecializeSpirv(shader.handle, entry.spirv->src, entry.spirv->len, name);
+    } else {
+        is_specialized = LoadSpirv(shader.handle, hash);
+    }
+
+    if (!is_specialized) {
+        // a rejected module replaced whatever the shader was compiled from before
+        entry.is_compiled      = false;
+        entry.is_spirv_missing = true;
+        return false;
+    }
+
+    entry.is_compiled = true;
+    entry.is_spirv    = true;
+    return true;
+}
+
+void ShaderCache::CompileSource(Shader shader)
+{
+    Entry& entry = this->entries.at(this->Hash(shader));
+    if (entry.is_compiled && !entry.is_spirv) {
+        return;
+    }
+
+    // setting the source also drops a SPIR-V module the shader was specialized from
+    const GLchar* src_gl = entry.source.data();
+    const GLint   len_gl = (GLint)entry.source.size();
+    GL(glShaderSource(shader.handle, 1, &src_gl, &len_gl));
+    GL(glCompileShader(shader.handle));
+
+    // the compile status is only checked if the program fails to link, querying it here would
+    // wait for the compiler
+    entry.is_compiled = true;
+    entry.is_spirv    = false;
+}
+
+u64 ShaderCache::Hash(Shader shader) const
+{
+    return this->hashes.at(shader.handle);
 }
 
-Shader CompileShader(GLenum shader_type, const char* src, i32 len)
+Shader CompileShader(GLenum shader_type, GLsizei count, const GLchar** src, const GLint* len)
+{
+    return ShaderPool.Get(shader_type, count, src, len);
+}
+
+Shader CompileShader(GLenum shader_type, const char* src, i32 len, const ShaderFile* spirv)
 {
     const GLchar* src_gl = src;
     const GLint   len_gl = len;
-    return CompileShader(shader_type, 1, &src_gl, &len_gl);
+    return ShaderPool.Get(shader_type, 1, &src_gl, &len_gl, spirv);
 }
 
-/* --- Texture2D --- */
-Texture2D::Texture2D(const std::string& path)
+/* --- Shader preprocessor --- */
+static void AppendShaderSource(
+    std::string*                   out,
+    std::string_view               src,
+    u32                            source_id,
+    std::span<const ShaderInclude> includes,
+    std::vector<bool>*             is_included)
 {
-    // TODO: some of these should be methods like tex.SetParameter, tex.GenerateMipmap, etc. (I
-    // think, maybe they can't be changed after loading)
-    this->Reserve();
-    this->Bind(GL_TEXTURE0);
+    char  directive[64];
+    usize line_num = 1;
+
+    while (!src.empty()) {
+        usize            len  = std::min(src.find('\n'), src.size() - 1) + 1;
+        std::string_view line = src.substr(0, len);
+        src.remove_prefix(len);
+        line_num += 1;
+
+        std::string_view text = line.substr(std::min(line.find_first_not_of(" \t"), line.size()));
+        if (!text.starts_with("#include")) {
+            out->append(line);
+            continue;
+        }
 
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        usize open  = text.find('"');
+        usize close = text.find('"', open + 1);
+        if (open == std::string_view::npos || close == std::string_view::npos) {
+            ABORT("Malformed shader include: %.*s", (int)text.size(), text.data());
+        }
 
-    // TODO: this should be a configureable setting, also we shouldn't grab the value every time we
-    // load a texture
-    GLfloat max_anistropy;
-    GL(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anistropy));
-    GLfloat anistropy = glm::clamp((f32)settings.af_samples, 1.0f, max_anistropy);
-    GL(glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anistropy));
+        std::string_view name = text.substr(open + 1, close - open - 1);
+
+        usize index = 0;
+        while (index < includes.size() && name != includes[index].name) {
+            index += 1;
+        }
+
+        if (index == includes.size()) {
+            ABORT("Unknown shader include '%.*s'", (int)name.size(), name.data());
+        }
+
+        // includes act as if they had include guards, the directive is kept as an empty line so
+        // the line numbers after it don't shift
+        if ((*is_included)[index]) {
+            out->push_back('\n');
+            continue;
+        }
+        (*is_included)[index] = true;
+
+        snprintf(directive, sizeof(directive), "#line 1 %u\n", (u32)index + 1);
+        out->append(directive);
+
+        const ShaderFile& file = includes[index].file;
+        AppendShaderSource(out, {file.src, file.len}, (u32)index + 1, includes, is_included);
+        if (out->back() != '\n') {
+            out->push_back('\n');
+        }
+
+        snprintf(directive, sizeof(directive), "#line %zu %u\n", line_num, source_id);
+        out->append(directive);
+    }
+}
+
+std::string PreprocessShader(
+    const char*                    version,
+    std::span<const ShaderDefine>  defines,
+    const ShaderFile&              file,
+    std::span<const ShaderInclude> includes)
+{
+    char define[128];
+
+    std::string source = version;
+    for (const auto& def : defines) {
+        snprintf(define, sizeof(define), "#define %s %d\n", def.name, def.value);
+        source.append(define);
+    }
+    source.append("#line 1 0\n");
+
+    std::vector<bool> is_included(includes.size(), false);
+    AppendShaderSource(&source, {file.src, file.len}, 0, includes, &is_included);
+
+    return source;
+}
+
+/* --- Program binary cache --- */
+// NOTE: bump PROGRAM_BINARY_VERSION when the layout changes
+static constexpr u32 PROGRAM_BINARY_MAGIC   = 0x42505247; // "GRPB"
+static constexpr u32 PROGRAM_BINARY_VERSION = 1;
+
+struct ProgramBinaryHeader {
+    u32 magic;
+    u32 version;
+    u64 driver_hash; // binaries are only valid for the driver that produced them
+    u64 key;
+    u32 format;
+    u32 length;
+};
+
+static bool IsProgramBinaryCacheEnabled()
+{
+    static const bool is_enabled = [] {
+        GLint format_count = 0;
+        GL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count));
+        return settings.program_binary_cache && format_count > 0;
+    }();
+    return is_enabled;
+}
+
+static u64 DriverHash()
+{
+    static const u64 driver_hash = [] {
+        u64 hash = HASH_BASIS;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char* str;
+            GL(str = (const char*)glGetString(name));
+            hash = HashBytes(hash, str, strlen(str));
+        }
+        return hash;
+    }();
+    return driver_hash;
+}
+
+static std::string ProgramBinaryPath(u64 key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016" PRIx64 ".bin", key);
+    return std::string(RENDER_PROGRAM_CACHE_DIR) + name;
+}
+
+static bool LoadProgramBinary(GLuint program, u64 key)
+{
+    FILE* file = fopen(ProgramBinaryPath(key).c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    ProgramBinaryHeader header;
+    std::vector<u8>     binary;
+
+    bool is_valid = fread(&header, sizeof(header), 1, file) == 1
+                    && header.magic == PROGRAM_BINARY_MAGIC
+                    && header.version == PROGRAM_BINARY_VERSION
+                    && header.driver_hash == DriverHash() && header.key == key;
+    if (is_valid) {
+        binary.resize(header.length);
+        is_valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+
+    fclose(file);
+
+    if (!is_valid) {
+        return false;
+    }
+
+    GL(glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size()));
+
+    // the driver is free to reject binaries, e.g. after an update that kept the version string
+    GLint success;
+    GL(glGetProgramiv(program, GL_LINK_STATUS, &success));
+    return success;
+}
+
+static void StoreProgramBinary(GLuint program, u64 key)
+{
+    GLint length;
+    GL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<u8> binary(length);
+    GLenum          format;
+    GL(glGetProgramBinary(program, length, nullptr, &format, binary.data()));
+
+    ProgramBinaryHeader header = {
+        .magic       = PROGRAM_BINARY_MAGIC,
+        .version     = PROGRAM_BINARY_VERSION,
+        .driver_hash = DriverHash(),
+        .key         = key,
+        .format      = format,
+        .length      = (u32)length,
+    };
+
+    std::error_code error;
+    std::filesystem::create_directories(RENDER_PROGRAM_CACHE_DIR, error);
+
+    FILE* file = fopen(ProgramBinaryPath(key).c_str(), "wb");
+    if (file == nullptr) {
+        LOG_WARNING("Failed to write program binary '%s'", ProgramBinaryPath(key).c_str());
+        return;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary.data(), 1, binary.size(), file);
+    fclose(file);
+}
+
+// lets the driver compile and link on its own threads, programs are then only waited on when
+// they're first used
+static void EnableParallelShaderCompile()
+{
+    static bool is_enabled = false;
+    if (is_enabled) {
+        return;
+    }
+
+    // 0xFFFFFFFF lets the driver pick the number of threads
+    if (GLEW_KHR_parallel_shader_compile) {
+        GL(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        GL(glMaxShaderCompilerThreadsARB(0xFFFFFFFF));
+    }
+
+    is_enabled = true;
+}
+
+ShaderProgram LinkProgram(const Shader* shaders, usize count)
+{
+    EnableParallelShaderCompile();
+
+    // create program
+    GLuint shader_program;
+    GL(shader_program = glCreateProgram());
+
+    ShaderProgram program = ShaderProgram(shader_program);
 
+    // the key covers the source of every stage, in the order they're attached
+    u64 key = HASH_BASIS;
+    for (usize ii = 0; ii < count; ii++) {
+        u64 shader_hash = ShaderPool.Hash(shaders[ii]);
+        key             = HashBytes(key, &shader_hash, sizeof(shader_hash));
+    }
+
+    bool use_binary_cache = IsProgramBinaryCacheEnabled();
+    if (use_binary_cache && LoadProgramBinary(shader_program, key)) {
+        program.Reflect();
+        return program;
+    }
+
+    // SPIR-V and GLSL stages can't be linked into one program, so SPIR-V is only used if every
+    // stage has a module the driver accepts
+    bool is_spirv = true;
+    for (usize ii = 0; ii < count && is_spirv; ii++) {
+        is_spirv = ShaderPool.CompileSpirv(shaders[ii]);
+    }
+
+    // attach shaders to the program, compiling the ones no other program has needed yet
+    for (usize ii = 0; ii < count; ii++) {
+        if (!is_spirv) {
+            ShaderPool.CompileSource(shaders[ii]);
+        }
+        GL(glAttachShader(shader_program, shaders[ii].handle));
+    }
+
+    program.is_spirv = is_spirv;
+
+    if (use_binary_cache) {
+        GL(glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        program.binary_key = key;
+    }
+
+    // link shaders, the result is checked by Finish
+    GL(glLinkProgram(shader_program));
+    program.is_pending = true;
+
+    return program;
+}
+
+/* --- Texture2D --- */
+Texture2D::Texture2D(const std::string& path)
+{
     int width, height, num_channels;
     u8* image_data = stbi_load(path.c_str(), &width, &height, &num_channels, 0);
     if (!image_data) {
@@ -84,244 +524,750 @@ Texture2D::Texture2D(const std::string& path)
         internal_fmt = (num_channels == 3) ? GL_RGB8 : GL_RGBA8;
     }
 
-    GL(glTexImage2D(
-        GL_TEXTURE_2D,
+    GLsizei levels = (GLsizei)std::bit_width((u32)glm::max(width, height));
+
+    this->Reserve();
+    GL(glTextureStorage2D(this->handle, levels, internal_fmt, width, height));
+    GL(glTextureSubImage2D(
+        this->handle,
+        0,
+        0,
         0,
-        internal_fmt,
         width,
         height,
-        0,
         color_fmt,
         GL_UNSIGNED_BYTE,
         image_data));
-    GL(glGenerateMipmap(GL_TEXTURE_2D));
+    GL(glGenerateTextureMipmap(this->handle));
 
     stbi_image_free(image_data);
 
-    this->Unbind(GL_TEXTURE0);
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_REPEAT));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+    // TODO: this should be a configureable setting, also we shouldn't grab the value every time we
+    // load a texture
+    GLfloat max_anistropy;
+    GL(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anistropy));
+    GLfloat anistropy = glm::clamp((f32)settings.af_samples, 1.0f, max_anistropy);
+    GL(glTextureParameterf(this->handle, GL_TEXTURE_MAX_ANISOTROPY_EXT, anistropy));
+}
+
+Texture2D::Texture2D(const glm::vec4& color)
+{
+    this->Reserve();
+
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_REPEAT));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+    const u8 buf[4]
+        = {(u8)(color.r * 255.0f),
+           (u8)(color.g * 255.0f),
+           (u8)(color.b * 255.0f),
+           (u8)(color.a * 255.0f)};
+
+    GL(glTextureStorage2D(this->handle, 1, GL_RGBA8, 1, 1));
+    GL(glTextureSubImage2D(this->handle, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, buf));
+}
+
+void Texture2D::Bind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, this->handle);
+}
+
+void Texture2D::Unbind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, 0);
+}
+
+void Texture2D::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 1, &this->handle));
+}
+
+void Texture2D::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetTexture(this->handle);
+    GL(glDeleteTextures(1, &this->handle));
+    this->handle = 0;
+}
+
+/* --- TextureRT --- */
+void TextureRT::Bind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, this->handle);
+}
+
+void TextureRT::Unbind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, 0);
+}
+
+void TextureRT::BindImage(GLuint image_slot, GLint level, GLenum access, GLenum format) const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glBindImageTexture(image_slot, this->handle, level, GL_FALSE, 0, access, format));
+}
+
+void TextureRT::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateTextures(GL_TEXTURE_2D, 1, &this->handle));
+}
+
+void TextureRT::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetTexture(this->handle);
+    GL(glDeleteTextures(1, &this->handle));
+    this->handle = 0;
+}
+
+// NOTE: the storage is immutable, resizing means deleting and reserving the texture again
+void TextureRT::Setup(GLenum format, GLsizei width, GLsizei height, GLsizei levels)
+{
+    ASSERT(this->handle != 0);
+
+    GLenum min_filter = levels > 1 ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR;
+
+    GL(glTextureStorage2D(this->handle, levels, format, width, height));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, min_filter));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+}
+
+/* --- TextureCubemap --- */
+TextureCubemap::TextureCubemap(const std::array<std::string, 6>& faces)
+{
+    this->Reserve();
+
+    stbi_set_flip_vertically_on_load(false);
+    for (usize ii = 0; ii < faces.size(); ii++) {
+        const char* path = faces[ii].c_str();
+
+        int width, height, num_channels;
+        u8* tex_data = stbi_load(path, &width, &height, &num_channels, 3);
+        if (!tex_data) {
+            ABORT("Failed to load cubemap texture from '%s'", path);
+        }
+
+        // NOTE: we assume cubemaps are always in sRGB space, and that every face has the same size
+        if (ii == 0) {
+            GL(glTextureStorage2D(this->handle, 1, GL_SRGB8, width, height));
+        }
+
+        GL(glTextureSubImage3D(
+            this->handle,
+            0,
+            0,
+            0,
+            (GLint)ii,
+            width,
+            height,
+            1,
+            GL_RGB,
+            GL_UNSIGNED_BYTE,
+            tex_data));
+
+        stbi_image_free(tex_data);
+    }
+    stbi_set_flip_vertically_on_load(true);
+
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+}
+
+void TextureCubemap::Bind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, this->handle);
+}
+
+void TextureCubemap::Unbind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, 0);
+}
+
+void TextureCubemap::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &this->handle));
+}
+
+void TextureCubemap::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetTexture(this->handle);
+    GL(glDeleteTextures(1, &this->handle));
+    this->handle = 0;
+}
+
+/* --- TextureShadowArray --- */
+void TextureShadowArray::Bind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, this->handle);
+}
+
+void TextureShadowArray::Unbind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, 0);
+}
+
+void TextureShadowArray::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->handle));
+}
+
+void TextureShadowArray::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetTexture(this->handle);
+    GL(glDeleteTextures(1, &this->handle));
+    this->handle = 0;
+}
+
+void TextureShadowArray::Setup(GLsizei width, GLsizei height, GLsizei layers)
+{
+    ASSERT(this->handle != 0);
+
+    // samples outside of the map compare against the far plane, i.e. they're never shadowed
+    constexpr f32 border_color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    GL(glTextureStorage3D(this->handle, 1, GL_DEPTH_COMPONENT32F, width, height, layers));
+
+    // linear filtering with a compare mode gives 2x2 PCF for free
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER));
+    GL(glTextureParameterfv(this->handle, GL_TEXTURE_BORDER_COLOR, border_color));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL));
+}
+
+/* --- TextureShadowCubeArray --- */
+void TextureShadowCubeArray::Bind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, this->handle);
+}
+
+void TextureShadowCubeArray::Unbind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, 0);
+}
+
+void TextureShadowCubeArray::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, &this->handle));
+}
+
+void TextureShadowCubeArray::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetTexture(this->handle);
+    GL(glDeleteTextures(1, &this->handle));
+    this->handle = 0;
+}
+
+void TextureShadowCubeArray::Setup(GLsizei resolution, GLsizei cube_count)
+{
+    ASSERT(this->handle != 0);
+
+    GL(glTextureStorage3D(
+        this->handle,
+        1,
+        GL_DEPTH_COMPONENT32F,
+        resolution,
+        resolution,
+        cube_count * 6));
+
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL));
+}
+
+/* --- TextureArray2D --- */
+void TextureArray2D::Bind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, this->handle);
+}
+
+void TextureArray2D::Unbind(GLenum texture_slot) const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindTexture(texture_slot - GL_TEXTURE0, 0);
+}
+
+void TextureArray2D::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->handle));
+}
+
+void TextureArray2D::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetTexture(this->handle);
+    GL(glDeleteTextures(1, &this->handle));
+    this->handle = 0;
+}
+
+void TextureArray2D::Setup(GLenum format, GLsizei width, GLsizei height, GLsizei layers)
+{
+    ASSERT(this->handle != 0);
+
+    GLsizei levels = (GLsizei)std::bit_width((u32)glm::max(width, height));
+
+    GL(glTextureStorage3D(this->handle, levels, format, width, height, layers));
+
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_WRAP_T, GL_REPEAT));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GL(glTextureParameteri(this->handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+    GLfloat max_anistropy;
+    GL(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anistropy));
+    GLfloat anistropy = glm::clamp((f32)settings.af_samples, 1.0f, max_anistropy);
+    GL(glTextureParameterf(this->handle, GL_TEXTURE_MAX_ANISOTROPY_EXT, anistropy));
+}
+
+void TextureArray2D::GenerateMipmaps() const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glGenerateTextureMipmap(this->handle));
+}
+
+// ShaderProgram
+void ShaderProgram::UseProgram()
+{
+    this->Finish();
+    GLState.UseProgram(this->handle);
+}
+
+// this waits for the driver if it's still compiling
+static void CheckLinkStatus(GLuint program)
+{
+    if constexpr (RENDER_CHECK_SHADER_COMPILE) {
+        GLint success;
+        char  info_log[RENDER_SHADER_LOG_SIZE];
+        GL(glGetProgramiv(program, GL_LINK_STATUS, &success));
+
+        if (!success) {
+            // report the shader that failed to compile, if any
+            GLuint  shaders[8];
+            GLsizei shader_count;
+            GL(glGetAttachedShaders(program, lengthof(shaders), &shader_count, shaders));
+
+            for (GLsizei ii = 0; ii < shader_count; ii++) {
+                GL(glGetShaderiv(shaders[ii], GL_COMPILE_STATUS, &success));
+                if (!success) {
+                    GL(glGetShaderInfoLog(shaders[ii], sizeof(info_log), nullptr, info_log));
+                    ABORT(
+                        "Compilation of shader failed:\n"
+                        "Reason: %s\n",
+                        info_log);
+                }
+            }
+
+            GL(glGetProgramInfoLog(program, sizeof(info_log), nullptr, info_log));
+            ABORT(
+                "Linking of shader program failed:\n"
+                "Reason: %s\n",
+                info_log);
+        }
+    }
+}
+
+// ARB_gl_spirv doesn't require drivers to keep the names of SPIR-V uniforms, which every uniform
+// is set by
+static bool HasUniformNames(GLuint program)
+{
+    GLint uniform_count;
+    GL(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count));
+
+    for (GLint ii = 0; ii < uniform_count; ii++) {
+        GLuint index = (GLuint)ii;
+        GLint  name_len;
+        GL(glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_NAME_LENGTH, &name_len));
+        if (name_len <= 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ShaderProgram::Finish()
+{
+    if (!this->is_pending) {
+        return;
+    }
+
+    this->is_pending = false;
+
+    CheckLinkStatus(this->handle);
+
+    if (this->is_spirv && !HasUniformNames(this->handle)) {
+        LOG_WARNING(
+            "Driver dropped the uniform names of program %u, relinking from source",
+            GLuint(*this));
+
+        // every shader compiled from here on skips its module
+        ShaderPool.is_spirv_disabled = true;
+
+        GLuint  shaders[8];
+        GLsizei shader_count;
+        GL(glGetAttachedShaders(this->handle, lengthof(shaders), &shader_count, shaders));
+        for (GLsizei ii = 0; ii < shader_count; ii++) {
+            ShaderPool.CompileSource(Shader(shaders[ii]));
+        }
+
+        GL(glLinkProgram(this->handle));
+        CheckLinkStatus(this->handle);
+
+        this->is_spirv = false;
+    }
+
+    if (this->binary_key != 0) {
+        StoreProgramBinary(this->handle, this->binary_key);
+    }
+
+    this->Reflect();
+
+    for (const auto& set_uniform : this->deferred_uniforms) {
+        set_uniform(*this);
+    }
+    this->deferred_uniforms.clear();
+}
+
+static void AddUniform(ShaderProgram* program, const std::string& name, GLint location)
+{
+    auto [iter, inserted] = program->uniforms.emplace(HashUniformName(name), location);
+    ASSERT(inserted || iter->second == location);
+}
+
+// Builds the name -> location table from the program's active uniforms, arrays get an entry for
+// every element as well as for their bare name, members of uniform blocks have no location
+void ShaderProgram::Reflect()
+{
+    ASSERT(this->handle != 0);
+
+    GLint uniform_count, max_name_len;
+    GL(glGetProgramiv(this->handle, GL_ACTIVE_UNIFORMS, &uniform_count));
+    GL(glGetProgramiv(this->handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_len));
+
+    std::vector<char> name_buf(glm::max(max_name_len, 1));
+
+    this->uniforms.clear();
+    this->uniforms.reserve(uniform_count);
+
+    for (GLint ii = 0; ii < uniform_count; ii++) {
+        GLsizei name_len;
+        GLint   array_size;
+        GLenum  type;
+        GL(glGetActiveUniform(
+            this->handle,
+            (GLuint)ii,
+            (GLsizei)name_buf.size(),
+            &name_len,
+            &array_size,
+            &type,
+            name_buf.data()));
+
+        std::string name = std::string(name_buf.data(), name_len);
+
+        GLint location;
+        GL(location = glGetUniformLocation(this->handle, name.c_str()));
+        if (location < 0) {
+            continue;
+        }
+
+        if (!name.ends_with("[0]")) {
+            AddUniform(this, name, location);
+            continue;
+        }
+
+        std::string base = name.substr(0, name.size() - 3);
+        AddUniform(this, base, location);
+
+        for (GLint elem = 0; elem < array_size; elem++) {
+            std::string elem_name = base + "[" + std::to_string(elem) + "]";
+
+            GL(location = glGetUniformLocation(this->handle, elem_name.c_str()));
+            if (location >= 0) {
+                AddUniform(this, elem_name, location);
+            }
+        }
+    }
+}
+
+// VAO
+void VAO::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateVertexArrays(1, &this->handle));
+}
+
+void VAO::Delete()
+{
+    ASSERT(this->handle != 0);
+
+    GLState.ForgetVAO(this->handle);
+    GL(glDeleteVertexArrays(1, &this->handle));
+    this->handle = 0;
+}
+
+void VAO::Bind() const
+{
+    ASSERT(this->handle != 0);
+
+    GLState.BindVAO(this->handle);
 }
 
-Texture2D::Texture2D(const glm::vec4& color)
+void VAO::Unbind() const
 {
-    this->Reserve();
-    this->Bind(GL_TEXTURE0);
-
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    ASSERT(this->handle != 0);
 
-    const u8 buf[4]
-        = {(u8)(color.r * 255.0f),
-           (u8)(color.g * 255.0f),
-           (u8)(color.b * 255.0f),
-           (u8)(color.a * 255.0f)};
+    GLState.BindVAO(0);
+}
 
-    GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf));
+void VAO::SetVertexBuffer(VBO vbo, GLsizei stride)
+{
+    ASSERT(this->handle != 0);
+    ASSERT(vbo.handle != 0);
 
-    this->Unbind(GL_TEXTURE0);
+    GL(glVertexArrayVertexBuffer(this->handle, 0, vbo.handle, 0, stride));
 }
 
-void Texture2D::Bind(GLenum texture_slot) const
+void VAO::SetElementBuffer(EBO ebo)
 {
     ASSERT(this->handle != 0);
+    ASSERT(ebo.handle != 0);
 
-    GL(glActiveTexture(texture_slot));
-    GL(glBindTexture(GL_TEXTURE_2D, this->handle));
+    GL(glVertexArrayElementBuffer(this->handle, ebo.handle));
 }
 
-void Texture2D::Unbind(GLenum texture_slot) const
+// TODO: could be templated to infer the appropriate enum type
+// TODO: do we need access to the normalization argument?
+void VAO::SetAttribute(GLuint index, GLint components, GLenum type, uintptr_t offset)
 {
     ASSERT(this->handle != 0);
+    ASSERT(1 <= components && components <= 4);
 
-    GL(glActiveTexture(texture_slot));
-    GL(glBindTexture(GL_TEXTURE_2D, 0));
+    GL(glVertexArrayAttribFormat(this->handle, index, components, type, GL_FALSE, (GLuint)offset));
+    GL(glVertexArrayAttribBinding(this->handle, index, 0));
+    GL(glEnableVertexArrayAttrib(this->handle, index));
 }
 
-void Texture2D::Reserve()
+// VBO
+void VBO::Reserve()
 {
     ASSERT(this->handle == 0);
 
-    GL(glGenTextures(1, &this->handle));
+    GL(glCreateBuffers(1, &this->handle));
 }
 
-void Texture2D::Delete()
+void VBO::Delete()
 {
     ASSERT(this->handle != 0);
 
-    GL(glDeleteTextures(1, &this->handle));
+    GL(glDeleteBuffers(1, &this->handle));
     this->handle = 0;
 }
 
-/* --- TextureRT --- */
-void TextureRT::Bind(GLenum texture_slot) const
+void VBO::Bind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glActiveTexture(texture_slot));
-    GL(glBindTexture(GL_TEXTURE_2D, this->handle));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, this->handle));
 }
 
-void TextureRT::Unbind(GLenum texture_slot) const
+void VBO::Unbind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glActiveTexture(texture_slot));
-    GL(glBindTexture(GL_TEXTURE_2D, 0));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
-void TextureRT::Reserve()
+void VBO::LoadData(size_t size, const void* data, GLenum usage) const
 {
-    ASSERT(this->handle == 0);
+    ASSERT(this->handle != 0);
 
-    GL(glGenTextures(1, &this->handle));
+    GL(glNamedBufferData(this->handle, size, data, usage));
 }
 
-void TextureRT::Delete()
+void VBO::BindSlot(GLuint index) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glDeleteTextures(1, &this->handle));
-    this->handle = 0;
+    GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, this->handle));
+}
+
+// EBO
+void EBO::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateBuffers(1, &this->handle));
 }
 
-void TextureRT::Setup(GLenum format, GLsizei width, GLsizei height)
+void EBO::Delete()
 {
     ASSERT(this->handle != 0);
 
-    this->Bind(GL_TEXTURE0);
-    GL(glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGB, GL_FLOAT, nullptr));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL(glDeleteBuffers(1, &this->handle));
+    this->handle = 0;
 }
 
-/* --- TextureCubemap --- */
-TextureCubemap::TextureCubemap(const std::array<std::string, 6>& faces)
+void EBO::Bind() const
 {
-    this->Reserve();
-    this->Bind();
+    ASSERT(this->handle != 0);
 
-    stbi_set_flip_vertically_on_load(false);
-    for (usize ii = 0; ii < faces.size(); ii++) {
-        const char* path = faces[ii].c_str();
+    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->handle));
+}
 
-        int width, height, num_channels;
-        u8* tex_data = stbi_load(path, &width, &height, &num_channels, 3);
-        if (!tex_data) {
-            ABORT("Failed to load cubemap texture from '%s'", path);
-        }
+void EBO::Unbind() const
+{
+    ASSERT(this->handle != 0);
 
-        // NOTE: we assume cubemaps are always in sRGB space
-        GL(glTexImage2D(
-            GL_TEXTURE_CUBE_MAP_POSITIVE_X + ii,
-            0,
-            GL_SRGB8,
-            width,
-            height,
-            0,
-            GL_RGB,
-            GL_UNSIGNED_BYTE,
-            tex_data));
+    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
 
-        stbi_image_free(tex_data);
-    }
-    stbi_set_flip_vertically_on_load(true);
+void EBO::LoadData(size_t size, const void* data, GLenum usage) const
+{
+    ASSERT(this->handle != 0);
 
-    GL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    GL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+    GL(glNamedBufferData(this->handle, size, data, usage));
 }
 
-void TextureCubemap::Bind() const
+void EBO::BindSlot(GLuint index) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindTexture(GL_TEXTURE_CUBE_MAP, this->handle));
+    GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, this->handle));
 }
 
-void TextureCubemap::Reserve()
+/* --- UBO --- */
+void UBO::Reserve(size_t size)
 {
     ASSERT(this->handle == 0);
 
-    GL(glGenTextures(1, &this->handle));
+    GL(glCreateBuffers(1, &this->handle));
+    GL(glNamedBufferData(this->handle, size, NULL, GL_STATIC_DRAW));
 }
 
-void TextureCubemap::Delete()
+void UBO::Delete()
 {
     ASSERT(this->handle != 0);
 
-    GL(glDeleteTextures(1, &this->handle));
+    GL(glDeleteBuffers(1, &this->handle));
     this->handle = 0;
 }
 
-// Uniform
-Uniform::Uniform(const char* name, GLint location)
+void UBO::Bind() const
 {
-    this->name   = name;
-    this->handle = location;
+    ASSERT(this->handle != 0);
+
+    GL(glBindBuffer(GL_UNIFORM_BUFFER, this->handle));
 }
 
-// VAO
-void VAO::Reserve()
+void UBO::Unbind() const
 {
-    ASSERT(this->handle == 0);
+    ASSERT(this->handle != 0);
 
-    GL(glGenVertexArrays(1, &this->handle));
+    GL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
 }
 
-void VAO::Delete()
+void UBO::LoadData(size_t size, const void* data, GLenum usage) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glDeleteVertexArrays(1, &this->handle));
-    this->handle = 0;
+    GL(glNamedBufferData(this->handle, size, data, usage));
 }
 
-void VAO::Bind() const
+void UBO::SubData(size_t offset, size_t size, const void* data) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindVertexArray(this->handle));
+    GL(glNamedBufferSubData(this->handle, offset, size, data));
 }
 
-void VAO::Unbind() const
+void UBO::BindSlot(GLuint index) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindVertexArray(0));
+    GL(glBindBufferBase(GL_UNIFORM_BUFFER, index, this->handle));
 }
 
-// TODO: could be templated to infer the appropriate enum type
-// TODO: maybe there's a better way to wrap this in general
-// TODO: do we need access to the normalization argument?
-void VAO::SetAttribute(
-    GLuint    index,
-    GLint     components,
-    GLenum    type,
-    GLsizei   stride,
-    uintptr_t offset)
+void UBO::BindRange(GLuint index, size_t offset, size_t size) const
 {
-    ASSERT(1 <= components && components <= 4);
+    ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glVertexAttribPointer(index, components, type, GL_FALSE, stride, (void*)offset));
-    GL(glEnableVertexAttribArray(index));
-    this->Unbind();
+    GL(glBindBufferRange(GL_UNIFORM_BUFFER, index, this->handle, offset, size));
 }
 
-// VBO
-void VBO::Reserve()
+/* --- SSBO --- */
+void SSBO::Reserve()
 {
     ASSERT(this->handle == 0);
 
-    GL(glGenBuffers(1, &this->handle));
+    GL(glCreateBuffers(1, &this->handle));
 }
 
-void VBO::Delete()
+void SSBO::Delete()
 {
     ASSERT(this->handle != 0);
 
@@ -329,37 +1275,51 @@ void VBO::Delete()
     this->handle = 0;
 }
 
-void VBO::Bind() const
+void SSBO::Bind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBuffer(GL_ARRAY_BUFFER, this->handle));
+    GL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->handle));
 }
 
-void VBO::Unbind() const
+void SSBO::Unbind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
 }
 
-void VBO::LoadData(size_t size, const void* data, GLenum usage) const
+void SSBO::LoadData(size_t size, const void* data, GLenum usage) const
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glBufferData(GL_ARRAY_BUFFER, size, data, usage));
+    GL(glNamedBufferData(this->handle, size, data, usage));
 }
 
-// EBO
-void EBO::Reserve()
+void SSBO::CopyData(const SSBO& src, size_t size) const
+{
+    ASSERT(this->handle != 0);
+    ASSERT(src.handle != 0);
+
+    GL(glCopyNamedBufferSubData(src.handle, this->handle, 0, 0, size));
+}
+
+void SSBO::BindSlot(GLuint index) const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, this->handle));
+}
+
+/* --- DIB --- */
+void DIB::Reserve()
 {
     ASSERT(this->handle == 0);
 
-    GL(glGenBuffers(1, &this->handle));
+    GL(glCreateBuffers(1, &this->handle));
 }
 
-void EBO::Delete()
+void DIB::Delete()
 {
     ASSERT(this->handle != 0);
 
@@ -367,75 +1327,92 @@ void EBO::Delete()
     this->handle = 0;
 }
 
-void EBO::Bind() const
+void DIB::Bind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->handle));
+    GL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->handle));
 }
 
-void EBO::Unbind() const
+void DIB::Unbind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    GL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
 }
 
-void EBO::LoadData(size_t size, const void* data, GLenum usage) const
+void DIB::LoadData(size_t size, const void* data, GLenum usage) const
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage));
+    GL(glNamedBufferData(this->handle, size, data, usage));
 }
 
-/* --- UBO --- */
-void UBO::Reserve(size_t size)
+void DIB::SubData(size_t offset, size_t size, const void* data) const
 {
-    ASSERT(this->handle == 0);
+    ASSERT(this->handle != 0);
 
-    GL(glGenBuffers(1, &this->handle));
-    this->Bind();
-    GL(glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STATIC_DRAW));
-    this->Unbind();
+    GL(glNamedBufferSubData(this->handle, offset, size, data));
 }
 
-void UBO::Delete()
+void DIB::GetSubData(size_t offset, size_t size, void* data) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glDeleteBuffers(1, &this->handle));
-    this->handle = 0;
+    GL(glGetNamedBufferSubData(this->handle, offset, size, data));
 }
 
-void UBO::Bind() const
+void DIB::BindSlot(GLuint index) const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBuffer(GL_UNIFORM_BUFFER, this->handle));
+    GL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, this->handle));
 }
 
-void UBO::Unbind() const
+/* --- PBO --- */
+void PBO::Reserve()
+{
+    ASSERT(this->handle == 0);
+
+    GL(glCreateBuffers(1, &this->handle));
+}
+
+void PBO::Delete()
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+    GL(glDeleteBuffers(1, &this->handle));
+    this->handle = 0;
 }
 
-void UBO::SubData(size_t offset, size_t size, const void* data) const
+void PBO::Bind() const
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data));
-    this->Unbind();
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, this->handle));
 }
 
-void UBO::BindSlot(GLuint index) const
+void PBO::Unbind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindBufferBase(GL_UNIFORM_BUFFER, index, this->handle));
+    GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+
+const u8* PBO::CreateStorage(size_t size) const
+{
+    ASSERT(this->handle != 0);
+
+    // not coherent, readers issue a GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT barrier before their fence
+    constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT;
+
+    GL(glNamedBufferStorage(this->handle, size, nullptr, flags | GL_CLIENT_STORAGE_BIT));
+
+    void* mapped;
+    GL(mapped = glMapNamedBufferRange(this->handle, 0, size, flags));
+    ASSERT(mapped != nullptr);
+
+    return (const u8*)mapped;
 }
 
 /* --- RBO --- */
@@ -443,7 +1420,7 @@ void RBO::Reserve()
 {
     ASSERT(this->handle == 0);
 
-    GL(glGenRenderbuffers(1, &this->handle));
+    GL(glCreateRenderbuffers(1, &this->handle));
 }
 
 void RBO::Delete()
@@ -472,8 +1449,12 @@ void RBO::CreateStorage(GLenum internal_format, GLsizei samples, GLsizei width,
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internal_format, width, height));
+    GL(glNamedRenderbufferStorageMultisample(
+        this->handle,
+        samples,
+        internal_format,
+        width,
+        height));
 }
 
 /* --- FBO --- */
@@ -481,13 +1462,14 @@ void FBO::Reserve()
 {
     ASSERT(this->handle == 0);
 
-    GL(glGenFramebuffers(1, &this->handle));
+    GL(glCreateFramebuffers(1, &this->handle));
 }
 
 void FBO::Delete()
 {
     ASSERT(this->handle != 0);
 
+    GLState.ForgetFramebuffer(this->handle);
     GL(glDeleteFramebuffers(1, &this->handle));
     this->handle = 0;
 }
@@ -496,38 +1478,65 @@ void FBO::Bind() const
 {
     // NOTE: the default FBO (handle = 0) is actually the default FBO object
     // ASSERT(this->handle != 0);
-    GL(glBindFramebuffer(GL_FRAMEBUFFER, this->handle));
+    GLState.BindFramebuffer(this->handle);
 }
 
 void FBO::Unbind() const
 {
     ASSERT(this->handle != 0);
 
-    GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    GLState.BindFramebuffer(0);
 }
 
 void FBO::Attach(RBO rbo, GLenum attachment) const
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, rbo.handle));
+    GL(glNamedFramebufferRenderbuffer(this->handle, attachment, GL_RENDERBUFFER, rbo.handle));
 }
 
 void FBO::Attach(TextureRT tex_rt, GLenum attachment) const
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    GL(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, tex_rt.handle, 0));
+    GL(glNamedFramebufferTexture(this->handle, attachment, tex_rt.handle, 0));
+}
+
+void FBO::Attach(Texture2D tex, GLenum attachment) const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glNamedFramebufferTexture(this->handle, attachment, tex.handle, 0));
+}
+
+void FBO::Attach(TextureArray2D tex_array, GLenum attachment, GLint layer) const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glNamedFramebufferTextureLayer(this->handle, attachment, tex_array.handle, 0, layer));
+}
+
+void FBO::Attach(TextureShadowArray tex_array, GLenum attachment, GLint layer) const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glNamedFramebufferTextureLayer(this->handle, attachment, tex_array.handle, 0, layer));
+}
+
+void FBO::Attach(TextureShadowCubeArray tex_array, GLenum attachment, GLint layer) const
+{
+    ASSERT(this->handle != 0);
+
+    GL(glNamedFramebufferTextureLayer(this->handle, attachment, tex_array.handle, 0, layer));
 }
 
 void FBO::CheckComplete() const
 {
     ASSERT(this->handle != 0);
 
-    this->Bind();
-    ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    GLenum status;
+    GL(status = glCheckNamedFramebufferStatus(this->handle, GL_FRAMEBUFFER));
+    ASSERT(status == GL_FRAMEBUFFER_COMPLETE);
 }
 
 void Query::Reserve()
@@ -553,6 +1562,16 @@ void Query::RecordTimestamp()
     GL(glQueryCounter(this->handle, GL_TIMESTAMP));
 }
 
+bool Query::IsAvailable() const
+{
+    ASSERT(this->handle != 0);
+
+    GLuint is_available;
+    GL(glGetQueryObjectuiv(this->handle, GL_QUERY_RESULT_AVAILABLE, &is_available));
+
+    return is_available == GL_TRUE;
+}
+
 u64 Query::RetrieveValue() const
 {
     ASSERT(this->handle != 0);
@@ -562,3 +1581,186 @@ u64 Query::RetrieveValue() const
 
     return (u64)value;
 }
+
+/* --- StateCache --- */
+StateCache GLState;
+
+StateCache::StateCache()
+{
+    this->Invalidate();
+}
+
+static void SetCapability(GLenum cap, bool enable)
+{
+    if (enable) {
+        GL(glEnable(cap));
+    } else {
+        GL(glDisable(cap));
+    }
+}
+
+void StateCache::Apply(const PipelineState& state)
+{
+    const PipelineState& cur      = this->pipeline;
+    bool                 is_known = this->is_pipeline_known;
+
+    // issues the call if any of the fields it sets changed, otherwise counts it as elided
+    auto update = [&](bool is_changed, auto&& call) {
+        if (is_known && !is_changed) {
+            this->elided_calls += 1;
+            return;
+        }
+
+        call();
+        this->issued_calls += 1;
+    };
+
+    // depth
+    update(state.depth_test != cur.depth_test, [&] {
+        SetCapability(GL_DEPTH_TEST, state.depth_test);
+    });
+    update(state.depth_clamp != cur.depth_clamp, [&] {
+        SetCapability(GL_DEPTH_CLAMP, state.depth_clamp);
+    });
+    update(state.depth_write != cur.depth_write, [&] {
+        GL(glDepthMask(state.depth_write ? GL_TRUE : GL_FALSE));
+    });
+    update(state.depth_func != cur.depth_func, [&] { GL(glDepthFunc(state.depth_func)); });
+
+    // culling
+    update(state.cull_face != cur.cull_face, [&] {
+        SetCapability(GL_CULL_FACE, state.cull_face);
+    });
+    update(state.cull_mode != cur.cull_mode, [&] { GL(glCullFace(state.cull_mode)); });
+    update(state.front_face != cur.front_face, [&] { GL(glFrontFace(state.front_face)); });
+
+    // pixel buffer
+    update(state.blend != cur.blend, [&] { SetCapability(GL_BLEND, state.blend); });
+    update(state.blend_eq != cur.blend_eq, [&] { GL(glBlendEquation(state.blend_eq)); });
+    update(state.blend_src != cur.blend_src || state.blend_dst != cur.blend_dst, [&] {
+        GL(glBlendFunc(state.blend_src, state.blend_dst));
+    });
+    update(state.color_write != cur.color_write || state.alpha_write != cur.alpha_write, [&] {
+        GLboolean rgb = state.color_write ? GL_TRUE : GL_FALSE;
+        GL(glColorMask(rgb, rgb, rgb, state.alpha_write ? GL_TRUE : GL_FALSE));
+    });
+
+    // stencil buffer
+    update(state.stencil_test != cur.stencil_test, [&] {
+        SetCapability(GL_STENCIL_TEST, state.stencil_test);
+    });
+    update(
+        state.stencil_func != cur.stencil_func || state.stencil_ref != cur.stencil_ref
+            || state.stencil_mask != cur.stencil_mask,
+        [&] { GL(glStencilFunc(state.stencil_func, state.stencil_ref, state.stencil_mask)); });
+    update(state.stencil_front != cur.stencil_front, [&] {
+        const StencilOps& ops = state.stencil_front;
+        GL(glStencilOpSeparate(GL_FRONT, ops.stencil_fail, ops.depth_fail, ops.depth_pass));
+    });
+    update(state.stencil_back != cur.stencil_back, [&] {
+        const StencilOps& ops = state.stencil_back;
+        GL(glStencilOpSeparate(GL_BACK, ops.stencil_fail, ops.depth_fail, ops.depth_pass));
+    });
+
+    // polygon offset
+    update(state.polygon_offset != cur.polygon_offset, [&] {
+        SetCapability(GL_POLYGON_OFFSET_FILL, state.polygon_offset);
+    });
+    update(
+        state.offset_factor != cur.offset_factor || state.offset_units != cur.offset_units,
+        [&] { GL(glPolygonOffset(state.offset_factor, state.offset_units)); });
+
+    this->pipeline          = state;
+    this->is_pipeline_known = true;
+}
+
+void StateCache::UseProgram(GLuint program)
+{
+    if (this->program == program) {
+        this->elided_calls += 1;
+        return;
+    }
+
+    GL(glUseProgram(program));
+    this->program = program;
+    this->issued_calls += 1;
+}
+
+void StateCache::BindVAO(GLuint vao)
+{
+    if (this->vao == vao) {
+        this->elided_calls += 1;
+        return;
+    }
+
+    GL(glBindVertexArray(vao));
+    this->vao = vao;
+    this->issued_calls += 1;
+}
+
+void StateCache::BindFramebuffer(GLuint fbo)
+{
+    if (this->fbo == fbo) {
+        this->elided_calls += 1;
+        return;
+    }
+
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    this->fbo = fbo;
+    this->issued_calls += 1;
+}
+
+void StateCache::BindTexture(GLuint unit, GLuint texture)
+{
+    ASSERT(unit < MAX_TEXTURE_UNITS);
+
+    if (this->textures[unit] == texture) {
+        this->elided_calls += 1;
+        return;
+    }
+
+    GL(glBindTextureUnit(unit, texture));
+    this->textures[unit] = texture;
+    this->issued_calls += 1;
+}
+
+void StateCache::ForgetTexture(GLuint texture)
+{
+    for (auto& bound : this->textures) {
+        if (bound == texture) {
+            bound = 0;
+        }
+    }
+}
+
+void StateCache::ForgetVAO(GLuint vao)
+{
+    if (this->vao == vao) {
+        this->vao = 0;
+    }
+}
+
+void StateCache::ForgetFramebuffer(GLuint fbo)
+{
+    if (this->fbo == fbo) {
+        this->fbo = 0;
+    }
+}
+
+void StateCache::Invalidate()
+{
+    this->is_pipeline_known = false;
+
+    this->program = UNKNOWN;
+    this->vao     = UNKNOWN;
+    this->fbo     = UNKNOWN;
+    for (auto& bound : this->textures) {
+        bound = UNKNOWN;
+    }
+}
+
+void StateCache::ResetCounters()
+{
+    this->issued_calls = 0;
+    this->elided_calls = 0;
+}
@@ -3,10 +3,14 @@
 #include <GL/glew.h>
 
 #include <array>
+#include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "common.hpp"
@@ -34,12 +38,21 @@ struct Handle {
     }
 };
 
-struct Uniform : Handle<GLint> {
-    using Handle<GLint>::Handle;
-    std::string
-        name; // TODO: could just use a fixed size char arrays, uniform names should be short
+// FNV-1a, uniform names are hashed at compile time and looked up by hash
+constexpr u64 HashUniformName(std::string_view name)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    for (char ch : name) {
+        hash = (hash ^ (u8)ch) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+struct UniformName {
+    u64         hash;
+    const char* str; // only kept for logging
 
-    Uniform(const char* name, GLint location);
+    consteval UniformName(const char* name) : hash(HashUniformName(name)), str(name) {}
 };
 
 struct Texture2D : Handle<GLuint> {
@@ -59,10 +72,12 @@ struct TextureRT : Handle<GLuint> {
 
     void Bind(GLenum texture_slot) const;
     void Unbind(GLenum texture_slot) const;
+    void BindImage(GLuint image_slot, GLint level, GLenum access, GLenum format) const;
     void Reserve();
     void Delete();
 
-    void Setup(GLenum format, GLsizei width, GLsizei height);
+    // levels > 1 are sampled with textureLod, each one bilinearly
+    void Setup(GLenum format, GLsizei width, GLsizei height, GLsizei levels = 1);
 };
 
 struct TextureCubemap : Handle<GLuint> {
@@ -70,75 +85,191 @@ struct TextureCubemap : Handle<GLuint> {
 
     TextureCubemap(const std::array<std::string, 6>& faces);
 
-    void Bind() const;
-    void Unbind() const;
+    void Bind(GLenum texture_slot) const;
+    void Unbind(GLenum texture_slot) const;
+    void Reserve();
+    void Delete();
+};
+
+// Depth texture array sampled with depth comparison (sampler2DArrayShadow)
+struct TextureShadowArray : Handle<GLuint> {
+    using Handle<GLuint>::Handle;
+
+    void Bind(GLenum texture_slot) const;
+    void Unbind(GLenum texture_slot) const;
     void Reserve();
     void Delete();
+
+    void Setup(GLsizei width, GLsizei height, GLsizei layers);
+};
+
+// Depth cube map array sampled with depth comparison (samplerCubeArrayShadow), layer N * 6 + F is
+// face F of cube map N
+struct TextureShadowCubeArray : Handle<GLuint> {
+    using Handle<GLuint>::Handle;
+
+    void Bind(GLenum texture_slot) const;
+    void Unbind(GLenum texture_slot) const;
+    void Reserve();
+    void Delete();
+
+    void Setup(GLsizei resolution, GLsizei cube_count);
+};
+
+// Color texture array with a full mip chain (sampler2DArray), every layer has the same size
+struct TextureArray2D : Handle<GLuint> {
+    using Handle<GLuint>::Handle;
+
+    void Bind(GLenum texture_slot) const;
+    void Unbind(GLenum texture_slot) const;
+    void Reserve();
+    void Delete();
+
+    void Setup(GLenum format, GLsizei width, GLsizei height, GLsizei layers);
+    void GenerateMipmaps() const;
 };
 
 struct Shader : Handle<GLuint> {
     using Handle<GLuint>::Handle;
 };
 
+// Shaders keyed by a hash of their stage and preprocessed source, so identical
+// shaders share one shader object. Compiling is deferred until a program is linked from source,
+// programs loaded from the program binary cache never compile their shaders
+// Shaders with a SPIR-V module, embedded in the executable or compiled offline under the same hash,
+// are specialized from it instead of compiled (ARB_gl_spirv), see settings.spirv_shaders
+struct ShaderCache {
+    struct Entry {
+        Shader            shader;
+        GLenum            type;
+        std::string       source;
+        const ShaderFile* spirv            = nullptr; // embedded module of the same source
+        bool              is_compiled      = false;
+        bool              is_spirv         = false; // specialized from a SPIR-V module
+        bool              is_spirv_missing = false; // none was found, or the driver rejected it
+    };
+
+    std::unordered_map<u64, Entry>  entries; // source hash -> entry
+    std::unordered_map<GLuint, u64> hashes;  // shader -> source hash
+
+    // set once the driver turns out to drop the uniform names of SPIR-V programs
+    bool is_spirv_disabled = false;
+
+    Shader Get(
+        GLenum            shader_type,
+        GLsizei           count,
+        const GLchar**    src,
+        const GLint*      len,
+        const ShaderFile* spirv = nullptr);
+    bool   CompileSpirv(Shader shader);  // false if the shader has no module the driver accepts
+    void   CompileSource(Shader shader); // also replaces a SPIR-V module that was loaded
+    u64    Hash(Shader shader) const;
+};
+
+extern ShaderCache ShaderPool;
+
 Shader CompileShader(GLenum shader_type, GLsizei count, const GLchar** src, const GLint* len);
-Shader CompileShader(GLenum shader_type, const char* src, i32 len);
+// spirv is the embedded SPIR-V module compiled from the same source, if there is one
+Shader CompileShader(
+    GLenum            shader_type,
+    const char*       src,
+    i32               len,
+    const ShaderFile* spirv = nullptr);
+
+struct ShaderDefine {
+    const char* name;
+    i32         value;
+};
+
+struct ShaderInclude {
+    const char* name; // as written in the #include directive
+    ShaderFile  file;
+};
+
+// Source of a shader variant: the version, the defines, then the file with every #include "name"
+// directive replaced by the named include. An include is pasted at most once per shader and is
+// numbered by its position in includes + 1 in #line directives, so compile logs point into it
+std::string PreprocessShader(
+    const char*                    version,
+    std::span<const ShaderDefine>  defines,
+    const ShaderFile&              file,
+    std::span<const ShaderInclude> includes);
 
 struct ShaderProgram : Handle<GLuint> {
     using Handle<GLuint>::Handle;
 
-    std::vector<Uniform> uniforms;
+    // name hash -> location, filled from GL_ACTIVE_UNIFORMS when linking, -1 for names that were
+    // looked up but aren't active so they're only reported once
+    std::unordered_map<u64, GLint> uniforms;
 
-    void UseProgram() const
-    {
-        GL(glUseProgram(GLuint(*this)));
-    }
+    // set while the driver may still be compiling and linking the program, the link status is
+    // only checked by Finish, which the first UseProgram calls
+    bool is_pending = false;
+    bool is_spirv   = false; // every stage was specialized from a SPIR-V module
+    u64  binary_key = 0;     // stored to the program binary cache once linked, 0 if not cached
+
+    // uniforms set while pending, their locations aren't known until the program is linked
+    std::vector<std::function<void(ShaderProgram&)>> deferred_uniforms;
 
+    void UseProgram();
+    void Reflect();
+    void Finish();
+
+    // NOTE: doesn't bind the program, uses glProgramUniform*
     template<typename T>
-    void SetUniform(const char* name, const T& value)
+    void SetUniform(UniformName name, const T& value)
     {
-        bool  location_known = false;
+        if (this->is_pending) {
+            this->deferred_uniforms.push_back(
+                [name, value](ShaderProgram& program) { program.SetUniform(name, value); });
+            return;
+        }
+
         GLint location;
 
-        // see if it's in the vector of known uniforms
-        for (const auto& iter : this->uniforms) {
-            if (iter.name == name) {
-                location       = iter.handle;
-                location_known = true;
-                break;
-            }
+        auto iter = this->uniforms.find(name.hash);
+        if (iter != this->uniforms.end()) {
+            location = iter->second;
+        } else {
+            LOG_DEBUG("Uniform '%s' is not active in program %u", name.str, GLuint(*this));
+            location = -1;
+            this->uniforms.emplace(name.hash, location);
         }
 
-        // if the location is unknown add the mapping to the vector
-        if (!location_known) {
-            GL(location = glGetUniformLocation(GLuint(*this), name));
-            if (location < 0) {
-                // TODO: this seems to happen even for valid uniforms, might need to look into this
-                return;
-            }
-
-            this->uniforms.emplace_back(Uniform(name, location));
+        if (location < 0) {
+            return;
         }
 
-        this->UseProgram();
+        GLuint program = GLuint(*this);
 
         if constexpr (std::is_same_v<T, bool>) {
-            GL(glUniform1i(location, (GLint)value));
+            GL(glProgramUniform1i(program, location, (GLint)value));
         } else if constexpr (std::is_same_v<T, GLint>) {
-            GL(glUniform1i(location, value));
+            GL(glProgramUniform1i(program, location, value));
         } else if constexpr (std::is_same_v<T, GLuint>) {
-            GL(glUniform1ui(location, value));
+            GL(glProgramUniform1ui(program, location, value));
         } else if constexpr (std::is_same_v<T, f32>) {
-            GL(glUniform1f(location, value));
+            GL(glProgramUniform1f(program, location, value));
         } else if constexpr (std::is_same_v<T, glm::vec2>) {
-            GL(glUniform2f(location, value.x, value.y));
+            GL(glProgramUniform2f(program, location, value.x, value.y));
         } else if constexpr (std::is_same_v<T, glm::vec3>) {
-            GL(glUniform3f(location, value.x, value.y, value.z));
+            GL(glProgramUniform3f(program, location, value.x, value.y, value.z));
         } else if constexpr (std::is_same_v<T, glm::vec4>) {
-            GL(glUniform4f(location, value.x, value.y, value.z, value.w));
+            GL(glProgramUniform4f(program, location, value.x, value.y, value.z, value.w));
         } else if constexpr (std::is_same_v<T, glm::mat3>) {
-            GL(glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)));
+            GL(glProgramUniformMatrix3fv(
+                program,
+                location,
+                1,
+                GL_FALSE,
+                glm::value_ptr(value)));
         } else if constexpr (std::is_same_v<T, glm::mat4>) {
-            GL(glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)));
+            GL(glProgramUniformMatrix4fv(
+                program,
+                location,
+                1,
+                GL_FALSE,
+                glm::value_ptr(value)));
         } else {
             // TODO: is there a better way to do this?
             static_assert(
@@ -148,8 +279,8 @@ struct ShaderProgram : Handle<GLuint> {
     }
 };
 
-// Vertex Array Object
-struct VAO : Handle<GLuint> {
+// Vertex Buffer Object
+struct VBO : Handle<GLuint> {
     using Handle<GLuint>::Handle;
 
     void Reserve();
@@ -157,12 +288,12 @@ struct VAO : Handle<GLuint> {
     void Bind() const;
     void Unbind() const;
 
-    void
-    SetAttribute(GLuint index, GLint components, GLenum type, GLsizei stride, uintptr_t offset);
+    void LoadData(size_t size, const void* data, GLenum usage) const;
+    void BindSlot(GLuint index) const; // binds as a shader storage buffer
 };
 
-// Vertex Buffer Object
-struct VBO : Handle<GLuint> {
+// Element Buffer Object
+struct EBO : Handle<GLuint> {
     using Handle<GLuint>::Handle;
 
     void Reserve();
@@ -171,10 +302,11 @@ struct VBO : Handle<GLuint> {
     void Unbind() const;
 
     void LoadData(size_t size, const void* data, GLenum usage) const;
+    void BindSlot(GLuint index) const; // binds as a shader storage buffer
 };
 
-// Element Buffer Object
-struct EBO : Handle<GLuint> {
+// Vertex Array Object
+struct VAO : Handle<GLuint> {
     using Handle<GLuint>::Handle;
 
     void Reserve();
@@ -182,7 +314,10 @@ struct EBO : Handle<GLuint> {
     void Bind() const;
     void Unbind() const;
 
-    void LoadData(size_t size, const void* data, GLenum usage) const;
+    // attributes are all sourced from the vertex buffer at binding 0
+    void SetVertexBuffer(VBO vbo, GLsizei stride);
+    void SetElementBuffer(EBO ebo);
+    void SetAttribute(GLuint index, GLint components, GLenum type, uintptr_t offset);
 };
 
 // Uniform Buffer Object
@@ -194,8 +329,53 @@ struct UBO : Handle<GLuint> {
     void Bind() const;
     void Unbind() const;
 
+    void LoadData(size_t size, const void* data, GLenum usage) const;
     void SubData(size_t offset, size_t size, const void* data) const;
     void BindSlot(GLuint index) const;
+    void BindRange(GLuint index, size_t offset, size_t size) const;
+};
+
+// Shader Storage Buffer Object
+struct SSBO : Handle<GLuint> {
+    using Handle<GLuint>::Handle;
+
+    void Reserve();
+    void Delete();
+    void Bind() const;
+    void Unbind() const;
+
+    void LoadData(size_t size, const void* data, GLenum usage) const;
+    void CopyData(const SSBO& src, size_t size) const;
+    void BindSlot(GLuint index) const;
+};
+
+// Draw Indirect Buffer
+struct DIB : Handle<GLuint> {
+    using Handle<GLuint>::Handle;
+
+    void Reserve();
+    void Delete();
+    void Bind() const;
+    void Unbind() const;
+
+    void LoadData(size_t size, const void* data, GLenum usage) const;
+    void SubData(size_t offset, size_t size, const void* data) const;
+    void GetSubData(size_t offset, size_t size, void* data) const; // NOTE: stalls the pipeline
+    void BindSlot(GLuint index) const; // binds as a shader storage buffer
+};
+
+// Pixel Buffer Object, used as the destination of readbacks, the storage is immutable and stays
+// mapped so the data can be read straight out of it once the GPU is done writing
+struct PBO : Handle<GLuint> {
+    using Handle<GLuint>::Handle;
+
+    void Reserve();
+    void Delete();
+    void Bind() const; // as the pixel pack buffer
+    void Unbind() const;
+
+    // returns the persistent mapping, can only be called once per reservation
+    const u8* CreateStorage(size_t size) const;
 };
 
 // Render Buffer Object
@@ -223,6 +403,10 @@ struct FBO : Handle<GLuint> {
     // GL_FRAMEBUFFER)
     void Attach(RBO rbo, GLenum attachment) const;
     void Attach(TextureRT tex_rt, GLenum attachment) const;
+    void Attach(Texture2D tex, GLenum attachment) const;
+    void Attach(TextureArray2D tex_array, GLenum attachment, GLint layer) const;
+    void Attach(TextureShadowArray tex_array, GLenum attachment, GLint layer) const;
+    void Attach(TextureShadowCubeArray tex_array, GLenum attachment, GLint layer) const;
     void CheckComplete() const;
 };
 
@@ -233,45 +417,101 @@ struct Query : Handle<GLuint> {
     void Delete();
 
     void RecordTimestamp();
+    // whether RetrieveValue would return without waiting on the GPU
+    bool IsAvailable() const;
     u64  RetrieveValue() const;
 };
 
-template<class... Ts, class = std::enable_if_t<std::conjunction_v<std::is_same<Shader, Ts>...>>>
-void AttachShaders(ShaderProgram program, Shader shader, Ts... shaders)
-{
-    GL(glAttachShader((GLuint)program, (GLuint)shader));
-    if constexpr (sizeof...(shaders) > 0) {
-        AttachShaders(program, shaders...);
-    }
-}
+// Stencil operations for one face, see glStencilOpSeparate
+struct StencilOps {
+    GLenum stencil_fail = GL_KEEP;
+    GLenum depth_fail   = GL_KEEP;
+    GLenum depth_pass   = GL_KEEP;
+
+    bool operator==(const StencilOps&) const = default;
+};
+
+// Fixed function state of a pass, applied as a whole with StateCache::Apply, fields default to
+// OpenGL's initial state
+struct PipelineState {
+    // depth
+    bool   depth_test  = false;
+    bool   depth_clamp = false;
+    bool   depth_write = true;
+    GLenum depth_func  = GL_LESS;
+
+    // culling
+    bool   cull_face  = false;
+    GLenum cull_mode  = GL_BACK;
+    GLenum front_face = GL_CCW;
+
+    // pixel buffer
+    bool   blend       = false;
+    GLenum blend_eq    = GL_FUNC_ADD;
+    GLenum blend_src   = GL_ONE;
+    GLenum blend_dst   = GL_ZERO;
+    bool   color_write = true; // RGB
+    bool   alpha_write = true;
+
+    // stencil buffer
+    bool       stencil_test  = false;
+    GLenum     stencil_func  = GL_ALWAYS;
+    GLint      stencil_ref   = 0;
+    GLuint     stencil_mask  = 0xFF;
+    StencilOps stencil_front = {};
+    StencilOps stencil_back  = {};
+
+    // polygon offset
+    bool polygon_offset = false;
+    f32  offset_factor  = 0.0f;
+    f32  offset_units   = 0.0f;
+};
+
+// Shadow copy of the OpenGL state the renderer sets, changes that match the current state are
+// dropped instead of being issued
+// NOTE: anything that changes this state behind the cache's back has to call Invalidate
+struct StateCache {
+    static constexpr usize  MAX_TEXTURE_UNITS = 16;
+    static constexpr GLuint UNKNOWN           = UINT32_MAX;
+
+    PipelineState pipeline;
+    bool          is_pipeline_known = false;
+
+    GLuint program                     = UNKNOWN;
+    GLuint vao                         = UNKNOWN;
+    GLuint fbo                         = UNKNOWN;
+    GLuint textures[MAX_TEXTURE_UNITS] = {};
+
+    // since the last ResetCounters
+    u64 issued_calls = 0;
+    u64 elided_calls = 0;
+
+    StateCache();
+
+    void Apply(const PipelineState& state);
+    void UseProgram(GLuint program);
+    void BindVAO(GLuint vao);
+    void BindFramebuffer(GLuint fbo);
+    void BindTexture(GLuint unit, GLuint texture);
+
+    // OpenGL unbinds deleted objects, and their names can be reused by new objects
+    void ForgetTexture(GLuint texture);
+    void ForgetVAO(GLuint vao);
+    void ForgetFramebuffer(GLuint fbo);
+
+    void Invalidate();
+    void ResetCounters();
+};
+
+extern StateCache GLState;
+
+// loads the program from the program binary cache when it has a binary for the same shaders and
+// driver, otherwise compiles the shaders, links them, and stores the binary
+ShaderProgram LinkProgram(const Shader* shaders, usize count);
 
 template<class... Ts, class = std::enable_if_t<std::conjunction_v<std::is_same<Shader, Ts>...>>>
 ShaderProgram LinkShaders(Shader shader, Ts... shaders)
 {
-    // create program
-    GLuint shader_program;
-    GL(shader_program = glCreateProgram());
-
-    // attach shaders to the program
-    AttachShaders(shader_program, shader, shaders...);
-
-    // link shaders
-    GL(glLinkProgram(shader_program));
-
-    // check linker result
-    if constexpr (RENDER_CHECK_SHADER_COMPILE) {
-        GLint success;
-        char  info_log[RENDER_SHADER_LOG_SIZE];
-        GL(glGetProgramiv(shader_program, GL_LINK_STATUS, &success));
-
-        if (!success) {
-            GL(glGetProgramInfoLog(shader_program, sizeof(info_log), nullptr, info_log));
-            ABORT(
-                "Linking of shader program failed:\n"
-                "Reason: %s\n",
-                info_log);
-        }
-    }
-
-    return ShaderProgram(shader_program);
+    const Shader stages[] = {shader, shaders...};
+    return LinkProgram(stages, lengthof(stages));
 }
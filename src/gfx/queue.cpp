@@ -0,0 +1,220 @@
+#include "queue.hpp"
+
+#include <cstring>
+#include <utility>
+
+#include "utils/profiling.hpp"
+#include "utils/settings.hpp"
+
+static constexpr u64 FieldMask(u32 bits)
+{
+    return (1ull << bits) - 1;
+}
+
+static_assert(
+    RenderQueue::PASS_BITS + RenderQueue::PROGRAM_BITS + RenderQueue::MATERIAL_BITS
+        + RenderQueue::VAO_BITS + RenderQueue::DEPTH_BITS
+    == 64);
+
+u64 RenderQueue::Key(u32 pass, GLuint program, u32 material_id, GLuint vao, f32 depth)
+{
+    u64 depth_id = (u64)(glm::clamp(depth, 0.0f, 1.0f) * (f32)FieldMask(DEPTH_BITS));
+
+    u64 key = pass & FieldMask(PASS_BITS);
+    key     = (key << PROGRAM_BITS) | (program & FieldMask(PROGRAM_BITS));
+    key     = (key << MATERIAL_BITS) | (material_id & FieldMask(MATERIAL_BITS));
+    key     = (key << VAO_BITS) | (vao & FieldMask(VAO_BITS));
+    key     = (key << DEPTH_BITS) | depth_id;
+
+    return key;
+}
+
+void RenderQueue::Clear()
+{
+    this->items.clear();
+}
+
+void RenderQueue::Push(u64 key, const Object& obj, const Model& model)
+{
+    this->items.push_back({key, &obj, &model});
+}
+
+// LSD radix sort, stable so draws with equal keys keep their submission order
+void RenderQueue::Sort()
+{
+    PROFILE_FUNCTION();
+
+    constexpr usize RADIX_SIZE = 1ull << RADIX_BITS;
+
+    usize count = this->items.size();
+    if (count < 2) {
+        return;
+    }
+
+    this->scratch.resize(count);
+
+    DrawItem* src = this->items.data();
+    DrawItem* dst = this->scratch.data();
+
+    for (u32 shift = 0; shift < 64; shift += RADIX_BITS) {
+        usize offsets[RADIX_SIZE] = {};
+        for (usize ii = 0; ii < count; ii++) {
+            offsets[(src[ii].key >> shift) & FieldMask(RADIX_BITS)] += 1;
+        }
+
+        // every key has the same digit, the pass wouldn't move anything
+        if (offsets[(src[0].key >> shift) & FieldMask(RADIX_BITS)] == count) {
+            continue;
+        }
+
+        usize sum = 0;
+        for (usize digit = 0; digit < RADIX_SIZE; digit++) {
+            usize digit_count = offsets[digit];
+            offsets[digit]    = sum;
+            sum += digit_count;
+        }
+
+        for (usize ii = 0; ii < count; ii++) {
+            dst[offsets[(src[ii].key >> shift) & FieldMask(RADIX_BITS)]++] = src[ii];
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != this->items.data()) {
+        std::swap(this->items, this->scratch);
+    }
+}
+
+/* --- MultiDrawBatch --- */
+bool MultiDrawBatch::IsSupported()
+{
+    static const bool is_supported
+        = settings.multi_draw_indirect && GLEW_ARB_shader_draw_parameters;
+    return is_supported;
+}
+
+void MultiDrawBatch::Clear()
+{
+    this->commands.clear();
+    this->draws.clear();
+}
+
+void MultiDrawBatch::Push(
+    const glm::mat4& mtx_world,
+    const glm::mat3& mtx_normal,
+    const Model&     model)
+{
+    const Geometry& geometry = model.geometry;
+
+    this->commands.push_back({
+        .count          = (u32)geometry.len_visual,
+        .instance_count = 1,
+        .first_index    = geometry.first_index,
+        .base_vertex    = geometry.base_vertex,
+        .base_instance  = 0,
+    });
+
+    this->draws.push_back({
+        .mtx_world   = mtx_world,
+        .mtx_normal  = glm::mat4(mtx_normal),
+        .material_id = model.material.id,
+        .padding     = {0, 0, 0},
+    });
+}
+
+void MultiDrawBatch::Upload()
+{
+    if (this->dib.handle == 0) {
+        this->dib.Reserve();
+        this->ssbo.Reserve();
+    }
+
+    this->dib.LoadData(
+        this->commands.size() * sizeof(DrawElementsIndirectCommand),
+        this->commands.data(),
+        GL_STREAM_DRAW);
+    this->ssbo.LoadData(this->draws.size() * sizeof(GPU_Draw), this->draws.data(), GL_STREAM_DRAW);
+}
+
+void MultiDrawBatch::Draw() const
+{
+    if (this->commands.empty()) {
+        return;
+    }
+
+    this->ssbo.BindSlot(SSBO_SLOT);
+    this->dib.Bind();
+    GeometryPool.vao.Bind();
+
+    GL(glMultiDrawElementsIndirect(
+        GL_TRIANGLES,
+        GL_UNSIGNED_INT,
+        nullptr,
+        (GLsizei)this->commands.size(),
+        0));
+
+    this->dib.Unbind();
+}
+
+/* --- ObjectUniformRing --- */
+bool ObjectUniformRing::IsEnabled()
+{
+    static const bool is_enabled = settings.object_uniform_ring && !MultiDrawBatch::IsSupported();
+    return is_enabled;
+}
+
+void ObjectUniformRing::Clear()
+{
+    if (this->stride == 0) {
+        GLint alignment;
+        GL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+        this->stride = (sizeof(GPU_Object) + alignment - 1) / alignment * alignment;
+    }
+
+    this->staging.clear();
+}
+
+void ObjectUniformRing::Push(
+    const glm::mat4& mtx_world,
+    const glm::mat4& mtx_wvp,
+    const glm::mat3& mtx_normal)
+{
+    GPU_Object object = {
+        .mtx_world  = mtx_world,
+        .mtx_wvp    = mtx_wvp,
+        .mtx_normal = glm::mat4(mtx_normal),
+    };
+
+    usize offset = this->staging.size();
+    this->staging.resize(offset + this->stride);
+    std::memcpy(&this->staging[offset], &object, sizeof(object));
+}
+
+void ObjectUniformRing::Upload()
+{
+    usize count = this->staging.size() / this->stride;
+    if (count == 0) {
+        return;
+    }
+
+    if (this->ubo.handle == 0) {
+        this->capacity = glm::max(MIN_CAPACITY, count);
+        this->ubo.Reserve(this->capacity * this->stride);
+        this->head = 0;
+    } else if (this->head + count > this->capacity) {
+        // wrap around on fresh storage rather than wait on draws still reading the old ranges
+        this->capacity = glm::max(this->capacity, count);
+        this->ubo.LoadData(this->capacity * this->stride, nullptr, GL_STREAM_DRAW);
+        this->head = 0;
+    }
+
+    this->ubo.SubData(this->head * this->stride, this->staging.size(), this->staging.data());
+    this->base = this->head;
+    this->head += count;
+}
+
+void ObjectUniformRing::Bind(usize index) const
+{
+    this->ubo.BindRange(UBO_SLOT, (this->base + index) * this->stride, sizeof(GPU_Object));
+}
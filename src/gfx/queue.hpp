@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "gfx/assets.hpp"
+#include "gfx/opengl.hpp"
+
+// One model of an object to be drawn, ordered by its packed sort key
+struct DrawItem {
+    u64           key;
+    const Object* obj;
+    const Model*  model;
+};
+
+// Draws of a pass sorted so that draws sharing state end up adjacent and draws sharing all their
+// state go front to back
+struct RenderQueue {
+    // key layout from the most significant bit down: pass, program, material, vao, depth
+    // fields are truncated to their width, a collision only costs a redundant bind
+    static constexpr u32 PASS_BITS     = 4;
+    static constexpr u32 PROGRAM_BITS  = 10;
+    static constexpr u32 MATERIAL_BITS = 16;
+    static constexpr u32 VAO_BITS      = 10;
+    static constexpr u32 DEPTH_BITS    = 24;
+
+    static constexpr u32 RADIX_BITS = 8;
+
+    std::vector<DrawItem> items;
+    std::vector<DrawItem> scratch; // ping pong buffer for the radix sort
+
+    // depth is normalized to [0, 1], closer draws sort first
+    static u64 Key(u32 pass, GLuint program, u32 material_id, GLuint vao, f32 depth);
+
+    void Clear();
+    void Push(u64 key, const Object& obj, const Model& model);
+    void Sort();
+};
+
+// Draws of many models as a single glMultiDrawElementsIndirect out of GeometryPool, the vertex
+// shaders read each draw's transform and material from an SSBO indexed by gl_DrawIDARB
+struct MultiDrawBatch {
+    // NOTE: must match the binding in the vertex shaders
+    static constexpr GLuint SSBO_SLOT = 5;
+
+    // NOTE: layout is defined by OpenGL
+    struct DrawElementsIndirectCommand {
+        u32 count;
+        u32 instance_count;
+        u32 first_index;
+        i32 base_vertex;
+        u32 base_instance;
+    };
+
+    // NOTE: must match the layout of DrawData in the vertex shaders
+    struct GPU_Draw {
+        glm::mat4 mtx_world;
+        glm::mat4 mtx_normal; // mat3 padded to a mat4
+        u32       material_id;
+        u32       padding[3];
+    };
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GPU_Draw>                    draws;
+
+    DIB  dib;
+    SSBO ssbo;
+
+    // what the batch was last built from, lets a pass reuse it for every light in a frame
+    const void* source = nullptr;
+    u64         frame  = 0;
+
+    static bool IsSupported();
+
+    void Clear();
+    void Push(const glm::mat4& mtx_world, const glm::mat3& mtx_normal, const Model& model);
+    void Upload();
+    void Draw() const;
+};
+
+// Per object matrices for passes drawn one model at a time, staged for the whole pass and written
+// with a single upload, each draw then binds its object's range instead of setting uniforms
+struct ObjectUniformRing {
+    // NOTE: must match the binding in Lighting_VS
+    static constexpr GLuint UBO_SLOT     = 1;
+    static constexpr usize  MIN_CAPACITY = 1024; // in objects
+
+    // NOTE: must match the layout of the Object block in Lighting_VS (std140)
+    struct GPU_Object {
+        glm::mat4 mtx_world;
+        glm::mat4 mtx_wvp;
+        glm::mat4 mtx_normal; // mat3 padded to a mat4, std140 pads each column to a vec4
+    };
+
+    UBO             ubo;
+    std::vector<u8> staging;
+
+    usize stride   = 0; // sizeof(GPU_Object) rounded up to the uniform buffer offset alignment
+    usize capacity = 0; // in objects
+    usize head     = 0; // first object in the ring that isn't written yet
+    usize base     = 0; // first object of the last upload
+
+    static bool IsEnabled();
+
+    void Clear();
+    void Push(const glm::mat4& mtx_world, const glm::mat4& mtx_wvp, const glm::mat3& mtx_normal);
+    void Upload();
+    void Bind(usize index) const;
+};
@@ -0,0 +1,247 @@
+#include "readback.hpp"
+
+#include <utility>
+
+#include "common/opengl.hpp"
+#include "utils/profiling.hpp"
+
+ReadbackService Readback;
+
+// bytes per pixel of the formats and types readbacks are made with
+static usize PixelSize(GLenum format, GLenum type)
+{
+    usize components;
+    switch (format) {
+        case GL_RED:
+        case GL_RED_INTEGER:
+        case GL_DEPTH_COMPONENT:
+        case GL_STENCIL_INDEX:
+            components = 1;
+            break;
+
+        case GL_RG:
+        case GL_RG_INTEGER:
+            components = 2;
+            break;
+
+        case GL_RGB:
+        case GL_BGR:
+        case GL_RGB_INTEGER:
+            components = 3;
+            break;
+
+        case GL_RGBA:
+        case GL_BGRA:
+        case GL_RGBA_INTEGER:
+            components = 4;
+            break;
+
+        default:
+            ABORT("Unsupported readback format 0x%x", format);
+    }
+
+    switch (type) {
+        case GL_UNSIGNED_BYTE:
+        case GL_BYTE:
+            return components;
+
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT:
+            return components * 2;
+
+        case GL_UNSIGNED_INT:
+        case GL_INT:
+        case GL_FLOAT:
+            return components * 4;
+
+        default:
+            ABORT("Unsupported readback type 0x%x", type);
+    }
+}
+
+// rows are read without padding so size matches PixelSize, returns the alignment to restore
+static GLint PackTightly()
+{
+    GLint alignment;
+    GL(glGetIntegerv(GL_PACK_ALIGNMENT, &alignment));
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+
+    return alignment;
+}
+
+bool ReadbackService::IsFull() const
+{
+    return this->pending == RING_SIZE;
+}
+
+ReadbackService::Slot& ReadbackService::Acquire(usize size)
+{
+    ASSERT(!this->IsFull());
+
+    Slot& slot = this->slots[(this->head + this->pending) % RING_SIZE];
+
+    // the storage is immutable, so growing means replacing the buffer
+    if (slot.capacity < size) {
+        if (slot.pbo.handle != 0) {
+            slot.pbo.Delete();
+        }
+
+        slot.pbo.Reserve();
+        slot.mapped   = slot.pbo.CreateStorage(size);
+        slot.capacity = size;
+    }
+
+    slot.pbo.Bind();
+    return slot;
+}
+
+void ReadbackService::Submit(Slot& slot, usize size, Callback callback)
+{
+    slot.pbo.Unbind();
+
+    // makes the copy visible through the mapping once the fence signals
+    GL(glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT));
+    GL(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    slot.size     = size;
+    slot.callback = std::move(callback);
+
+    this->pending += 1;
+}
+
+bool ReadbackService::ReadTexture(
+    GLuint   tex,
+    GLint    level,
+    GLenum   format,
+    GLenum   type,
+    i32      width,
+    i32      height,
+    Callback callback)
+{
+    PROFILE_FUNCTION();
+
+    if (this->IsFull()) {
+        return false;
+    }
+
+    usize size = (usize)width * (usize)height * PixelSize(format, type);
+    Slot& slot = this->Acquire(size);
+
+    GLint alignment = PackTightly();
+    GL(glGetTextureImage(tex, level, format, type, (GLsizei)size, nullptr));
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, alignment));
+
+    this->Submit(slot, size, std::move(callback));
+    return true;
+}
+
+bool ReadbackService::ReadFramebuffer(
+    const FBO& fbo,
+    GLenum     attachment,
+    i32        x,
+    i32        y,
+    i32        width,
+    i32        height,
+    GLenum     format,
+    GLenum     type,
+    Callback   callback)
+{
+    PROFILE_FUNCTION();
+
+    if (this->IsFull()) {
+        return false;
+    }
+
+    usize size = (usize)width * (usize)height * PixelSize(format, type);
+    Slot& slot = this->Acquire(size);
+
+    GLenum read_buffer = fbo.handle == 0 ? GL_BACK : attachment;
+    GL(glNamedFramebufferReadBuffer(fbo.handle, read_buffer));
+    GLState.BindFramebuffer(fbo.handle);
+
+    GLint alignment = PackTightly();
+    GL(glReadPixels(x, y, width, height, format, type, nullptr));
+    GL(glPixelStorei(GL_PACK_ALIGNMENT, alignment));
+
+    this->Submit(slot, size, std::move(callback));
+    return true;
+}
+
+bool ReadbackService::ReadBuffer(GLuint buffer, usize offset, usize size, Callback callback)
+{
+    PROFILE_FUNCTION();
+
+    if (this->IsFull()) {
+        return false;
+    }
+
+    Slot& slot = this->Acquire(size);
+    GL(glCopyNamedBufferSubData(buffer, slot.pbo.handle, offset, 0, size));
+
+    this->Submit(slot, size, std::move(callback));
+    return true;
+}
+
+// hands the oldest request to its callback and frees its slot
+void ReadbackService::Complete()
+{
+    Slot& slot = this->slots[this->head];
+
+    GL(glDeleteSync(slot.fence));
+    slot.fence = nullptr;
+
+    // the slot stays pending during the call, so requests the callback makes can't be given it
+    // and overwrite or free the data it's reading
+    slot.callback(slot.mapped, slot.size);
+    slot.callback = nullptr;
+
+    this->head = (this->head + 1) % RING_SIZE;
+    this->pending -= 1;
+}
+
+void ReadbackService::Poll()
+{
+    PROFILE_FUNCTION();
+
+    while (this->pending > 0) {
+        GLenum status;
+        GL(status = glClientWaitSync(this->slots[this->head].fence, 0, 0));
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return;
+        }
+
+        ASSERT(status != GL_WAIT_FAILED);
+        this->Complete();
+    }
+}
+
+void ReadbackService::Flush()
+{
+    PROFILE_FUNCTION();
+
+    while (this->pending > 0) {
+        GLenum status;
+        GL(status = glClientWaitSync(
+               this->slots[this->head].fence,
+               GL_SYNC_FLUSH_COMMANDS_BIT,
+               GL_TIMEOUT_IGNORED));
+
+        ASSERT(status != GL_WAIT_FAILED);
+        this->Complete();
+    }
+}
+
+void ReadbackService::Delete()
+{
+    this->Flush();
+
+    for (auto& slot : this->slots) {
+        if (slot.pbo.handle != 0) {
+            slot.pbo.Delete();
+        }
+
+        slot.mapped   = nullptr;
+        slot.capacity = 0;
+    }
+}
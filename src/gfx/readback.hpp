@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <functional>
+
+#include "common.hpp"
+#include "gfx/opengl.hpp"
+
+// Copies data off the GPU without stalling: every request copies into its own persistently mapped
+// PBO followed by a fence, and Poll hands the data to the request's callback once the fence has
+// signaled, which is usually a frame or two later
+// Requests complete in the order they were made
+struct ReadbackService {
+    static constexpr usize RING_SIZE = 8;
+
+    // runs on the thread calling Poll, the data is only valid for the duration of the call
+    using Callback = std::function<void(const u8* data, usize size)>;
+
+    struct Slot {
+        PBO       pbo;
+        const u8* mapped   = nullptr;
+        usize     capacity = 0;
+        usize     size     = 0;
+        GLsync    fence    = nullptr;
+        Callback  callback;
+    };
+
+    std::array<Slot, RING_SIZE> slots;
+    usize                       head    = 0; // oldest pending request
+    usize                       pending = 0;
+
+    // each returns false without reading anything if every slot is still waiting on the GPU, the
+    // caller can retry on a later frame or drop the request
+    bool ReadTexture(
+        GLuint   tex,
+        GLint    level,
+        GLenum   format,
+        GLenum   type,
+        i32      width,
+        i32      height,
+        Callback callback);
+    // reads a rectangle of one of fbo's color attachments, fbo 0 reads the backbuffer
+    bool ReadFramebuffer(
+        const FBO& fbo,
+        GLenum     attachment,
+        i32        x,
+        i32        y,
+        i32        width,
+        i32        height,
+        GLenum     format,
+        GLenum     type,
+        Callback   callback);
+    // the producer has to issue its own barrier if buffer was written by a shader
+    bool ReadBuffer(GLuint buffer, usize offset, usize size, Callback callback);
+
+    // runs the callbacks of every finished request, never waits on the GPU
+    void Poll();
+    // waits for and runs every pending request, for shutdown where nothing else will poll
+    void Flush();
+    void Delete();
+
+    bool IsFull() const;
+
+    // the next free slot with room for size bytes, bound as the pixel pack buffer
+    Slot& Acquire(usize size);
+    void  Submit(Slot& slot, usize size, Callback callback);
+    void  Complete();
+};
+
+extern ReadbackService Readback;
@@ -2,80 +2,194 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "common.hpp"
 #include "gfx/opengl.hpp"
+#include "gfx/readback.hpp"
 #include "math/random.hpp"
+#include "utils/hash.hpp"
 #include "utils/profiling.hpp"
 #include "utils/settings.hpp"
+#include "utils/threads.hpp"
 
 SHADER_FILE(Lighting_VS);
 SHADER_FILE(Lighting_FS);
 SHADER_FILE(ShadowVolume_VS);
 SHADER_FILE(ShadowVolume_FS);
 SHADER_FILE(ShadowVolume_GS);
+SHADER_FILE(ShadowVolume_CS);
+SHADER_FILE(ShadowVolumeCompute_VS);
+SHADER_FILE(ShadowVolumeSilhouette_VS);
+SHADER_FILE(ShadowMap_VS);
+SHADER_FILE(ShadowCube_VS);
+SHADER_FILE(ShadowCube_FS);
 SHADER_FILE(Skybox_FS);
 SHADER_FILE(Skybox_VS);
-SHADER_FILE(PostFX_VS);
-SHADER_FILE(PostFX_Sharpen_FS);
-SHADER_FILE(PostFX_Gamma_FS);
-SHADER_FILE(PostFX_Tonemap_FS);
+SHADER_FILE(PostFX_CS);
 SHADER_FILE(SphericalBillboard_FS);
 SHADER_FILE(SphericalBillboard_VS);
-SHADER_FILE(Bloom_VS);
-SHADER_FILE(BloomDownsample_FS);
-SHADER_FILE(BloomUpsample_FS);
-SHADER_FILE(BloomFinal_FS);
-
-struct String {
-    size_t      len;
-    const char* str;
+SHADER_FILE(BloomDownsample_CS);
+SHADER_FILE(BloomUpsample_CS);
+SHADER_FILE(TAAMotion_CS);
+SHADER_FILE(TAA_CS);
+SHADER_FILE(SMAAEdges_CS);
+SHADER_FILE(SMAAWeights_CS);
+SHADER_FILE(SMAABlend_CS);
+
+SHADER_FILE(Lights_Include);
+SHADER_FILE(DrawData_Include);
+SHADER_FILE(BloomTent_Include);
+
+static const ShaderInclude ShaderIncludes[] = {
+    {"Lights_Include.glsl", Lights_Include},
+    {"DrawData_Include.glsl", DrawData_Include},
+    {"BloomTent_Include.glsl", BloomTent_Include},
+};
 
-    constexpr String(const char* str_literal)
-    {
-        str = str_literal;
-        len = std::char_traits<char>::length(str_literal);
-    }
+static constexpr const char* SHADER_VERSION = "#version 450 core\n";
+
+// Permutation space of the shaders that draw the scene. Every feature is #defined ahead of the
+// source, so branches on it are resolved when the variant is compiled instead of at runtime.
+// Variants are built lazily by the passes that need them, ShaderPool shares identical ones and the
+// program binary cache keeps them across runs
+struct ShaderFeatures {
+    LightType light_type        = LightType::Ambient;
+    bool      material_bindless = MaterialTable::IsBindless();
+    bool      multi_draw        = MultiDrawBatch::IsSupported();
+    bool      object_uniforms   = ObjectUniformRing::IsEnabled();
+    bool      normal_map        = true;
+    bool      specular_map      = true;
+
+    bool operator==(const ShaderFeatures&) const = default;
 };
 
-static constexpr String ShaderPreamble_Version = String("#version 450 core\n");
-static constexpr String ShaderPreamble_Line    = String("#line 1\n");
+/* --- SPIR-V modules --- */
+// The makefile compiles every variant of the shaders in SpirvShaders with glslangValidator, so
+// building validates all of them, and embeds the modules as
+// <shader>_L<light type>_B<bindless>_M<multi draw>_O<object uniforms>_N<normal map>_S<specular map>
+// The normal and specular maps are enumerated together, as CompileLightShader sets them
+// NOTE: must match SPIRV_LIGHT_SHADERS, SPIRV_SHADOW_SHADERS and SPIRV_DRAW_SHADERS in the makefile
+#define SPIRV_N(X, name, l, b, m, o) X(name, l, b, m, o, 0) X(name, l, b, m, o, 1)
+#define SPIRV_O(X, name, l, b, m)    SPIRV_N(X, name, l, b, m, 0) SPIRV_N(X, name, l, b, m, 1)
+#define SPIRV_M(X, name, l, b)       SPIRV_O(X, name, l, b, 0) SPIRV_O(X, name, l, b, 1)
+#define SPIRV_B(X, name, l)          SPIRV_M(X, name, l, 0) SPIRV_M(X, name, l, 1)
+
+// every light type, the light types with shadow volumes, and the shaders not built per light type
+#define SPIRV_LIGHT_VARIANTS(X, name)                           \
+    SPIRV_B(X, name, 0) SPIRV_B(X, name, 1) SPIRV_B(X, name, 2) \
+    SPIRV_B(X, name, 3) SPIRV_B(X, name, 4)
+#define SPIRV_SHADOW_VARIANTS(X, name) SPIRV_B(X, name, 1) SPIRV_B(X, name, 2) SPIRV_B(X, name, 3)
+#define SPIRV_DRAW_VARIANTS(X, name)   SPIRV_B(X, name, 0)
+
+#define SPIRV_DECLARE(name, l, b, m, o, n)                                         \
+    extern "C" const char name##_L##l##_B##b##_M##m##_O##o##_N##n##_S##n##_file[]; \
+    extern "C" const u32  name##_L##l##_B##b##_M##m##_O##o##_N##n##_S##n##_file_size;
+
+#define SPIRV_ENTRY(name, l, b, m, o, n)                              \
+    {                                                                 \
+        {(LightType)l, b == 1, m == 1, o == 1, n == 1, n == 1},       \
+        {name##_L##l##_B##b##_M##m##_O##o##_N##n##_S##n##_file,       \
+         name##_L##l##_B##b##_M##m##_O##o##_N##n##_S##n##_file_size}, \
+    },
+
+#define SPIRV_MODULES(variants, name) \
+    variants(SPIRV_DECLARE, name)     \
+    static const SpirvVariant name##_spirv[] = {variants(SPIRV_ENTRY, name)}
+
+struct SpirvVariant {
+    ShaderFeatures features;
+    ShaderFile     module;
+};
 
-static constexpr String ShaderPreamble_Light = String(
-    "#define AMBIENT_LIGHT 0\n"
-    "#define POINT_LIGHT   1\n"
-    "#define SPOT_LIGHT    2\n"
-    "#define SUN_LIGHT     3\n");
+struct SpirvShader {
+    const ShaderFile*             file;
+    std::span<const SpirvVariant> variants;
+};
 
-static constexpr String ShaderPreamble_LightType[] = {
-    String("#define LIGHT_TYPE AMBIENT_LIGHT\n"),
-    String("#define LIGHT_TYPE POINT_LIGHT\n"),
-    String("#define LIGHT_TYPE SPOT_LIGHT\n"),
-    String("#define LIGHT_TYPE SUN_LIGHT\n"),
+SPIRV_MODULES(SPIRV_LIGHT_VARIANTS, Lighting_VS);
+SPIRV_MODULES(SPIRV_LIGHT_VARIANTS, Lighting_FS);
+SPIRV_MODULES(SPIRV_SHADOW_VARIANTS, ShadowVolume_GS);
+SPIRV_MODULES(SPIRV_SHADOW_VARIANTS, ShadowVolume_CS);
+SPIRV_MODULES(SPIRV_DRAW_VARIANTS, ShadowMap_VS);
+SPIRV_MODULES(SPIRV_DRAW_VARIANTS, ShadowCube_VS);
+
+static const SpirvShader SpirvShaders[] = {
+    {&Lighting_VS, Lighting_VS_spirv},
+    {&Lighting_FS, Lighting_FS_spirv},
+    {&ShadowVolume_GS, ShadowVolume_GS_spirv},
+    {&ShadowVolume_CS, ShadowVolume_CS_spirv},
+    {&ShadowMap_VS, ShadowMap_VS_spirv},
+    {&ShadowCube_VS, ShadowCube_VS_spirv},
 };
 
-static Shader CompileLightShader(GLenum shader_type, LightType type, const char* src, i32 len)
+// the embedded module of a variant, nullptr if the makefile doesn't build one for its features
+static const ShaderFile* FindSpirvModule(const ShaderFile& file, const ShaderFeatures& features)
 {
-    const GLchar* source_fragments[] = {
-        ShaderPreamble_Version.str,
-        ShaderPreamble_Light.str,
-        ShaderPreamble_LightType[(usize)type].str,
-        ShaderPreamble_Line.str,
-        src,
-    };
+    for (const auto& shader : SpirvShaders) {
+        if (shader.file != &file) {
+            continue;
+        }
+
+        for (const auto& variant : shader.variants) {
+            if (variant.features == features) {
+                return &variant.module;
+            }
+        }
+    }
 
-    const GLint source_lens[] = {
-        (GLint)ShaderPreamble_Version.len,
-        (GLint)ShaderPreamble_Light.len,
-        (GLint)ShaderPreamble_LightType[(usize)type].len,
-        (GLint)ShaderPreamble_Line.len,
-        (GLint)len,
+    return nullptr;
+}
+
+static Shader CompileVariant(
+    GLenum                shader_type,
+    const ShaderFile&     file,
+    const ShaderFeatures& features)
+{
+    const ShaderDefine defines[] = {
+        {"LIGHT_TYPE", (i32)features.light_type},
+        {"MATERIAL_BINDLESS", features.material_bindless},
+        {"MULTI_DRAW", features.multi_draw},
+        {"OBJECT_UNIFORMS", features.object_uniforms},
+        {"NORMAL_MAP", features.normal_map},
+        {"SPECULAR_MAP", features.specular_map},
     };
 
-    return CompileShader(shader_type, lengthof(source_fragments), source_fragments, source_lens);
+    std::string       source = PreprocessShader(SHADER_VERSION, defines, file, ShaderIncludes);
+    const ShaderFile* spirv  = FindSpirvModule(file, features);
+    return CompileShader(shader_type, source.data(), (i32)source.size(), spirv);
+}
+
+static Shader CompileLightShader(GLenum shader_type, LightType type, const ShaderFile& file)
+{
+    // the ambient term only depends on the diffuse color
+    bool is_shaded = type != LightType::Ambient;
+
+    return CompileVariant(
+        shader_type,
+        file,
+        {
+            .light_type   = type,
+            .normal_map   = is_shaded,
+            .specular_map = is_shaded,
+        });
+}
+
+// for shaders that draw out of a MultiDrawBatch but don't depend on the light type
+static Shader CompileDrawShader(GLenum shader_type, const ShaderFile& file)
+{
+    return CompileVariant(shader_type, file, {});
+}
+
+// for shaders that only need their includes resolved
+static Shader CompileIncludingShader(GLenum shader_type, const ShaderFile& file)
+{
+    std::string source = PreprocessShader(SHADER_VERSION, {}, file, ShaderIncludes);
+    return CompileShader(shader_type, source.data(), (i32)source.size());
 }
 
 /* --- Ambient Light --- */
@@ -155,6 +269,24 @@ SunLight& SunLight::Intensity(f32 new_intensity)
     return *this;
 }
 
+f32 SunLight::Intensity() const
+{
+    return this->intensity;
+}
+
+SunLight& SunLight::ShadowCascades(u32 count)
+{
+    ASSERT(count == 0 || (count >= 2 && count <= MAX_SHADOW_CASCADES));
+
+    this->shadow_cascades = count;
+    return *this;
+}
+
+u32 SunLight::ShadowCascades() const
+{
+    return this->shadow_cascades;
+}
+
 /* --- Spot Light --- */
 SpotLight::SpotLight(
     const glm::vec3& pos,
@@ -258,11 +390,16 @@ f32 SpotLight::Intensity() const
 }
 
 /* --- Point Light --- */
-PointLight::PointLight(const glm::vec3& pos, const glm::vec3& color, f32 intensity)
+PointLight::PointLight(
+    const glm::vec3& pos,
+    const glm::vec3& color,
+    f32              intensity,
+    bool             casts_shadows)
 {
-    this->pos       = pos;
-    this->color     = color;
-    this->intensity = intensity;
+    this->pos           = pos;
+    this->color         = color;
+    this->intensity     = intensity;
+    this->casts_shadows = casts_shadows;
 }
 
 PointLight& PointLight::Position(const glm::vec3& new_pos)
@@ -310,6 +447,36 @@ f32 PointLight::Intensity() const
     return this->intensity;
 }
 
+PointLight& PointLight::CastsShadows(bool light_casts_shadows)
+{
+    this->casts_shadows = light_casts_shadows;
+    return *this;
+}
+
+bool PointLight::CastsShadows() const
+{
+    return this->casts_shadows;
+}
+
+PointLight& PointLight::ShadowMapped(bool light_shadow_mapped)
+{
+    this->shadow_mapped = light_shadow_mapped;
+    return *this;
+}
+
+bool PointLight::ShadowMapped() const
+{
+    return this->shadow_mapped;
+}
+
+// distance at which the light's contribution falls below INFLUENCE_CUTOFF, follows from the
+// 1 / (1 + d^2) falloff used by the lighting shaders
+f32 PointLight::Radius() const
+{
+    f32 peak = glm::max(glm::max(this->color.r, this->color.g), this->color.b) * this->intensity;
+    return glm::sqrt(glm::max(peak / INFLUENCE_CUTOFF - 1.0f, 0.0f));
+}
+
 // Target Camera
 glm::mat4 TargetCamera::ViewMatrix() const
 {
@@ -471,417 +638,1927 @@ Skybox::Skybox(std::string_view skybox_path)
     this->tex = TextureCubemap(faces);
 
     this->vao.Reserve();
-    this->vao.Bind();
 
     this->vbo.Reserve();
     this->vbo.LoadData(sizeof(skybox_vertices), &skybox_vertices, GL_STATIC_DRAW);
 
-    this->vbo.Bind();
-    this->vao.SetAttribute(0, 3, GL_FLOAT, sizeof(glm::vec3), 0);
+    this->vao.SetVertexBuffer(this->vbo, sizeof(glm::vec3));
+    this->vao.SetAttribute(0, 3, GL_FLOAT, 0);
 }
 
 void Skybox::Draw() const
 {
-    GL(glActiveTexture(GL_TEXTURE0));
-    this->tex.Bind();
+    this->tex.Bind(GL_TEXTURE0);
 
     this->vao.Bind();
     GL(glDrawArrays(GL_TRIANGLES, 0, lengthof(skybox_vertices)));
 }
 
-/* --- FullscreenQuad --- */
-static const glm::vec2 fullscreen_quad[] = {
-  // positions   // texCoords
-    {-1.0f,  1.0f},
-    { 0.0f,  1.0f},
-    {-1.0f, -1.0f},
-    { 0.0f,  0.0f},
-    { 1.0f, -1.0f},
-    { 1.0f,  0.0f},
-
-    {-1.0f,  1.0f},
-    { 0.0f,  1.0f},
-    { 1.0f, -1.0f},
-    { 1.0f,  0.0f},
-    { 1.0f,  1.0f},
-    { 1.0f,  1.0f}
-};
+static constexpr f32 SHADOW_OFFSET_FACTOR = 0.025f;
+static constexpr f32 SHADOW_OFFSET_UNITS  = 1.0f;
 
-bool FullscreenQuad::is_vao_initialized = false;
-VAO  FullscreenQuad::vao;
-VBO  FullscreenQuad::vbo;
+static constexpr f32 SHADOW_MAP_OFFSET_FACTOR = 2.0f;
+static constexpr f32 SHADOW_MAP_OFFSET_UNITS  = 4.0f;
+
+// NOTE: fields that don't matter to a pass are kept the same as in the passes around it, so
+// switching between them issues as few calls as possible
+static PipelineState DirectLightingState(LightType light)
+{
+    bool is_additive  = light != LightType::Ambient;
+    bool uses_stencil = light != LightType::Ambient && light != LightType::Clustered;
+
+    return {
+        // depth
+        .depth_test  = true,
+        .depth_clamp = false,
+        .depth_write = true,
+        .depth_func  = is_additive ? (GLenum)GL_LEQUAL : (GLenum)GL_LESS,
+
+        // culling
+        .cull_face  = true,
+        .cull_mode  = GL_BACK,
+        .front_face = GL_CCW,
+
+        // pixel buffer
+        .blend       = true,
+        .blend_eq    = GL_FUNC_ADD,
+        .blend_src   = GL_ONE,
+        .blend_dst   = is_additive ? (GLenum)GL_ONE : (GLenum)GL_ZERO,
+        .color_write = true,
+        .alpha_write = true,
+
+        // stencil buffer
+        .stencil_test = uses_stencil,
+        .stencil_func = GL_EQUAL,
+        .stencil_ref  = 0x0,
+        .stencil_mask = 0xFF,
+
+        // polygon offset
+        .polygon_offset = false,
+    };
+}
 
-FullscreenQuad::FullscreenQuad()
+static PipelineState ShadowVolumeState(bool is_z_fail)
 {
-    if (is_vao_initialized) {
-        return;
+    // z-fail counts the volume faces behind the surface, z-pass the ones in front of it
+    StencilOps front, back;
+    if (is_z_fail) {
+        front = {GL_KEEP, GL_DECR_WRAP, GL_KEEP};
+        back  = {GL_KEEP, GL_INCR_WRAP, GL_KEEP};
+    } else {
+        front = {GL_KEEP, GL_KEEP, GL_INCR_WRAP};
+        back  = {GL_KEEP, GL_KEEP, GL_DECR_WRAP};
     }
 
-    this->vao.Reserve();
-    this->vbo.Reserve();
-
-    this->vbo.LoadData(sizeof(fullscreen_quad), &fullscreen_quad, GL_STATIC_DRAW);
-
-    this->vbo.Bind();
-    this->vao.SetAttribute(0, 2, GL_FLOAT, 2 * sizeof(glm::vec2), 0);
-    this->vao.SetAttribute(1, 2, GL_FLOAT, 2 * sizeof(glm::vec2), sizeof(glm::vec2));
-
-    this->is_vao_initialized = true;
+    return {
+        // depth
+        .depth_test  = true,
+        .depth_clamp = true,
+        .depth_write = false,
+        .depth_func  = GL_LESS,
+
+        // culling
+        .cull_face = false,
+
+        // pixel buffer
+        .blend       = true,
+        .blend_eq    = GL_FUNC_ADD,
+        .blend_src   = GL_ONE,
+        .blend_dst   = GL_ONE,
+        .color_write = false,
+        .alpha_write = false,
+
+        // stencil buffer
+        .stencil_test  = true,
+        .stencil_func  = GL_ALWAYS,
+        .stencil_ref   = 0,
+        .stencil_mask  = 0xFF,
+        .stencil_front = front,
+        .stencil_back  = back,
+
+        // polygon offset
+        .polygon_offset = true,
+        .offset_factor  = SHADOW_OFFSET_FACTOR,
+        .offset_units   = SHADOW_OFFSET_UNITS,
+    };
 }
 
-void FullscreenQuad::Draw() const
+static void SetupShadowLightingPass(LightType light)
 {
-    this->vao.Bind();
-    GL(glDrawArrays(GL_TRIANGLES, 0, lengthof(fullscreen_quad) / 2));
-}
+    (void)light;
 
-static constexpr f32 SHADOW_OFFSET_FACTOR = 0.025f;
-static constexpr f32 SHADOW_OFFSET_UNITS  = 1.0f;
+    GLState.Apply(ShadowVolumeState(false));
 
-static void SetupDirectLightingPass(LightType light)
-{
+    // clear stencil buffer
+    GL(glClear(GL_STENCIL_BUFFER_BIT));
+}
+
+// depth clamping keeps casters between the light and the near plane of a cascade
+static constexpr PipelineState SHADOW_MAP_STATE = {
     // depth
-    GL(glEnable(GL_DEPTH_TEST));
-    GL(glDisable(GL_DEPTH_CLAMP));
-    GL(glDepthMask(GL_TRUE));
-    if (light != LightType::Ambient) {
-        GL(glDepthFunc(GL_LEQUAL));
-    } else {
-        GL(glDepthFunc(GL_LESS));
-    }
+    .depth_test  = true,
+    .depth_clamp = true,
+    .depth_write = true,
+    .depth_func  = GL_LESS,
 
     // culling
-    GL(glEnable(GL_CULL_FACE));
-    GL(glCullFace(GL_BACK));
-    GL(glFrontFace(GL_CCW));
+    .cull_face = false,
 
     // pixel buffer
-    GL(glEnable(GL_BLEND));
-    GL(glBlendEquation(GL_FUNC_ADD));
-    GL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
-    if (light != LightType::Ambient) {
-        GL(glBlendFunc(GL_ONE, GL_ONE));
-    } else {
-        GL(glBlendFunc(GL_ONE, GL_ZERO));
-    }
+    .blend       = false,
+    .color_write = false,
+    .alpha_write = false,
 
     // stencil buffer
-    if (light != LightType::Ambient) {
-        GL(glEnable(GL_STENCIL_TEST));
-        GL(glStencilFunc(GL_EQUAL, 0x0, 0xFF));
-        GL(glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP));
-    } else {
-        GL(glDisable(GL_STENCIL_TEST));
-    }
+    .stencil_test = false,
 
     // polygon offset
-    GL(glDisable(GL_POLYGON_OFFSET_FILL));
-}
-
-static void SetupShadowLightingPass(LightType light)
-{
-    (void)light;
+    .polygon_offset = true,
+    .offset_factor  = SHADOW_MAP_OFFSET_FACTOR,
+    .offset_units   = SHADOW_MAP_OFFSET_UNITS,
+};
 
+// the fragment shader writes linear distances so polygon offset has no effect
+static constexpr PipelineState CUBE_SHADOW_MAP_STATE = {
     // depth
-    GL(glEnable(GL_DEPTH_TEST));
-    GL(glEnable(GL_DEPTH_CLAMP));
-    GL(glDepthMask(GL_FALSE));
-    GL(glDepthFunc(GL_LESS));
+    .depth_test  = true,
+    .depth_clamp = false,
+    .depth_write = true,
+    .depth_func  = GL_LESS,
 
     // culling
-    GL(glDisable(GL_CULL_FACE));
+    .cull_face = false,
 
     // pixel buffer
-    GL(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+    .blend       = false,
+    .color_write = false,
+    .alpha_write = false,
 
     // stencil buffer
-    GL(glEnable(GL_STENCIL_TEST));
-    GL(glStencilFunc(GL_ALWAYS, 0, 0xFF));
-    GL(glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP));
-    GL(glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP));
+    .stencil_test = false,
 
     // polygon offset
-    GL(glEnable(GL_POLYGON_OFFSET_FILL));
-    GL(glPolygonOffset(SHADOW_OFFSET_FACTOR, SHADOW_OFFSET_UNITS));
+    .polygon_offset = false,
+};
 
-    // clear stencil buffer
-    GL(glClear(GL_STENCIL_BUFFER_BIT));
+// world space bounds of a local space bounding box
+static void WorldBounds(
+    const glm::vec3& aabb_min,
+    const glm::vec3& aabb_max,
+    const glm::mat4& mtx_world,
+    glm::vec3*       world_min,
+    glm::vec3*       world_max)
+{
+    for (usize ii = 0; ii < 8; ii++) {
+        glm::vec3 corner = {
+            (ii & 1) ? aabb_max.x : aabb_min.x,
+            (ii & 2) ? aabb_max.y : aabb_min.y,
+            (ii & 4) ? aabb_max.z : aabb_min.z,
+        };
+        glm::vec3 world_corner = glm::vec3(mtx_world * glm::vec4(corner, 1.0f));
+
+        *world_min = ii == 0 ? world_corner : glm::min(*world_min, world_corner);
+        *world_max = ii == 0 ? world_corner : glm::max(*world_max, world_corner);
+    }
 }
 
-/* --- Renderer_AmbientLighting --- */
-Renderer_AmbientLighting::Renderer_AmbientLighting()
+// world space bounds of all of an object's models
+static void ObjectBounds(const Object& obj, glm::vec3* world_min, glm::vec3* world_max)
 {
-    LOG_DEBUG("Compiling Ambient Lighting Vertex Shader");
-    this->vs = CompileLightShader(
-        GL_VERTEX_SHADER,
-        LightType::Ambient,
-        Lighting_VS.src,
-        Lighting_VS.len);
-
-    LOG_DEBUG("Compiling Ambient Lighting Fragment Shader");
-    this->fs = CompileLightShader(
-        GL_FRAGMENT_SHADER,
-        LightType::Ambient,
-        Lighting_FS.src,
-        Lighting_FS.len);
+    const glm::mat4& mtx_world = obj.WorldMatrix();
 
-    LOG_DEBUG("Linking Ambient Lighting Shaders");
-    this->sp_light = LinkShaders(this->vs, this->fs);
-    LOG_DEBUG("Ambient Lighting Shader Program = %u", this->sp_light.handle);
+    *world_min = glm::vec3(mtx_world[3]);
+    *world_max = *world_min;
+    for (const auto& model : obj.models) {
+        glm::vec3 model_min, model_max;
+        WorldBounds(
+            model.geometry.aabb_min,
+            model.geometry.aabb_max,
+            mtx_world,
+            &model_min,
+            &model_max);
 
-    LOG_DEBUG("Initializing Ambient Lighting Shader Program");
-    this->sp_light.SetUniform("g_material.diffuse", 0);
-    this->sp_light.SetUniform("g_material.specular", 1);
-    this->sp_light.SetUniform("g_material.normal", 2);
+        *world_min = glm::min(*world_min, model_min);
+        *world_max = glm::max(*world_max, model_max);
+    }
 }
 
-void Renderer_AmbientLighting::Render(
-    const AmbientLight&        light,
-    const std::vector<Object>& objs,
-    const RenderState&         rs)
+// true if the box is entirely on the negative side of the plane
+static bool
+IsOutsidePlane(const glm::vec4& plane, const glm::vec3& box_min, const glm::vec3& box_max)
 {
-    SetupDirectLightingPass(LightType::Ambient);
-    this->sp_light.UseProgram();
-    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
-
-    for (const auto& obj : objs) {
-        this->sp_light.SetUniform("g_mtx_world", obj.WorldMatrix());
-        this->sp_light.SetUniform("g_mtx_normal", obj.NormalMatrix());
-        this->sp_light.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+    // the corner of the box furthest along the plane normal
+    glm::vec3 corner = {
+        plane.x >= 0.0f ? box_max.x : box_min.x,
+        plane.y >= 0.0f ? box_max.y : box_min.y,
+        plane.z >= 0.0f ? box_max.z : box_min.z,
+    };
 
-        obj.DrawVisual(this->sp_light);
-    }
+    return glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f;
 }
 
-/* --- Renderer_PointLighting --- */
-Renderer_PointLighting::Renderer_PointLighting()
+static void SetupMaterialSamplers(ShaderProgram& sp)
 {
-    // direct lighting
-    LOG_DEBUG("Compiling Point Lighting Vertex Shader");
-    this->vs
-        = CompileLightShader(GL_VERTEX_SHADER, LightType::Point, Lighting_VS.src, Lighting_VS.len);
+    // NOTE: these don't exist when using bindless textures
+    if (MaterialTable::IsBindless()) {
+        return;
+    }
 
-    LOG_DEBUG("Compiling Point Lighting Fragment Shader");
-    this->fs = CompileLightShader(
-        GL_FRAGMENT_SHADER,
-        LightType::Point,
-        Lighting_FS.src,
-        Lighting_FS.len);
+    static constexpr UniformName array_names[MaterialTable::MAX_TEXTURE_ARRAYS] = {
+        "g_material_arrays[0]",
+        "g_material_arrays[1]",
+        "g_material_arrays[2]",
+        "g_material_arrays[3]",
+        "g_material_arrays[4]",
+        "g_material_arrays[5]",
+        "g_material_arrays[6]",
+        "g_material_arrays[7]",
+    };
 
-    LOG_DEBUG("Linking Point Lighting Shaders");
-    this->sp_light = LinkShaders(this->vs, this->fs);
-    LOG_DEBUG("Point Lighting Shader Program = %u", this->sp_light.handle);
+    for (usize ii = 0; ii < lengthof(array_names); ii++) {
+        sp.SetUniform(array_names[ii], (GLint)(MaterialTable::TEXTURE_SLOT + ii));
+    }
+}
 
-    LOG_DEBUG("Initializing Point Lighting Shader Program");
-    this->sp_light.SetUniform("g_material.diffuse", 0);
-    this->sp_light.SetUniform("g_material.specular", 1);
-    this->sp_light.SetUniform("g_material.normal", 2);
+// sorts every model of the objects by state and then front to back
+static void QueueVisuals(
+    RenderQueue*               queue,
+    LightType                  pass,
+    const ShaderProgram&       sp,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    queue->Clear();
+    for (const auto& obj : objs) {
+        glm::mat4 mtx_world_view = rs.mtx_view * obj.WorldMatrix();
 
-    // shadow casting
-    LOG_DEBUG("Compiling Point Lighting (Shadows) Vertex Shader");
-    this->vs_shadow = CompileShader(GL_VERTEX_SHADER, ShadowVolume_VS.src, ShadowVolume_VS.len);
+        for (const auto& model : obj.models) {
+            glm::vec3 center = (model.geometry.aabb_min + model.geometry.aabb_max) * 0.5f;
+            f32       depth  = -(mtx_world_view * glm::vec4(center, 1.0f)).z;
 
-    LOG_DEBUG("Compiling Point Lighting (Shadows) Geometry Shader");
-    this->gs_shadow = CompileLightShader(
-        GL_GEOMETRY_SHADER,
-        LightType::Point,
-        ShadowVolume_GS.src,
-        ShadowVolume_GS.len);
+            u64 key = RenderQueue::Key(
+                (u32)pass,
+                sp.handle,
+                model.material.id,
+                model.geometry.vao_visual.handle,
+                (depth - Renderer::CLIP_NEAR) / (Renderer::CLIP_FAR - Renderer::CLIP_NEAR));
 
-    LOG_DEBUG("Compiling Point Lighting (Shadows) Fragment Shader");
-    this->fs_shadow = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+            queue->Push(key, obj, model);
+        }
+    }
 
-    LOG_DEBUG("Linking Point Lighting (Shadows) Shaders");
-    this->sp_shadow = LinkShaders(this->vs_shadow, this->gs_shadow, this->fs_shadow);
-    LOG_DEBUG("Point Lighting (Shadows) Shader Program = %u", this->sp_shadow.handle);
+    queue->Sort();
 }
 
-void Renderer_PointLighting::Render(
-    const PointLight&          light,
+// draws every model of the objects in the order of the queue
+// with multi draw the batch only depends on the objects and the camera, so every light of the pass
+// reuses it within a frame, otherwise models are drawn one at a time skipping redundant material,
+// VAO, and matrix updates
+// shared by every lighting pass drawn one model at a time
+static ObjectUniformRing ObjectRing;
+
+static void DrawVisuals(
+    RenderQueue*               queue,
+    MultiDrawBatch*            batch,
+    LightType                  pass,
+    ShaderProgram&             sp,
     const std::vector<Object>& objs,
     const RenderState&         rs)
 {
-    SetupShadowLightingPass(LightType::Point);
-    this->sp_shadow.UseProgram();
-    this->sp_shadow.SetUniform("g_light_source.pos", light.pos);
-
-    for (const auto& obj : objs) {
-        if (obj.CastsShadows()) {
-            this->sp_shadow.SetUniform("g_mtx_world", obj.WorldMatrix());
-            this->sp_shadow.SetUniform("g_mtx_normal", obj.NormalMatrix());
-            this->sp_shadow.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+    MaterialPool.Use();
 
-            obj.DrawShadow(this->sp_shadow);
-        }
+    bool is_batched = MultiDrawBatch::IsSupported();
+    if (is_batched && batch->source == &objs && batch->frame == rs.frame) {
+        batch->Draw();
+        return;
     }
 
-    SetupDirectLightingPass(LightType::Point);
-    this->sp_light.UseProgram();
-    this->sp_light.SetUniform("g_light_source.pos", light.pos);
-    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+    QueueVisuals(queue, pass, sp, objs, rs);
 
-    for (const auto& obj : objs) {
-        this->sp_light.SetUniform("g_mtx_world", obj.WorldMatrix());
-        this->sp_light.SetUniform("g_mtx_normal", obj.NormalMatrix());
-        this->sp_light.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+    const Object* bound_obj = nullptr;
 
-        obj.DrawVisual(this->sp_light);
-    }
-}
+    if (is_batched) {
+        batch->Clear();
+        for (const auto& item : queue->items) {
+            batch->Push(item.obj->WorldMatrix(), item.obj->NormalMatrix(), *item.model);
+        }
 
-/* --- Renderer_SpotLighting --- */
-Renderer_SpotLighting::Renderer_SpotLighting()
-{
-    // direct lighting
-    LOG_DEBUG("Compiling Spot Lighting Vertex Shader");
-    this->vs
-        = CompileLightShader(GL_VERTEX_SHADER, LightType::Spot, Lighting_VS.src, Lighting_VS.len);
+        batch->Upload();
+        batch->source = &objs;
+        batch->frame  = rs.frame;
 
-    LOG_DEBUG("Compiling Spot Lighting Fragment Shader");
-    this->fs
-        = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Spot, Lighting_FS.src, Lighting_FS.len);
+        batch->Draw();
+        return;
+    }
 
-    LOG_DEBUG("Linking Spot Lighting Shaders");
-    this->sp_light = LinkShaders(this->vs, this->fs);
-    LOG_DEBUG("Spot Lighting Shader Program = %u", this->sp_light.handle);
+    bool use_ring = ObjectUniformRing::IsEnabled();
+    if (use_ring) {
+        ObjectRing.Clear();
+        for (const auto& item : queue->items) {
+            if (item.obj != bound_obj) {
+                ObjectRing.Push(
+                    item.obj->WorldMatrix(),
+                    item.obj->WVPMatrix(),
+                    item.obj->NormalMatrix());
+                bound_obj = item.obj;
+            }
+        }
 
-    LOG_DEBUG("Initializing Spot Lighting Shader Program");
-    this->sp_light.SetUniform("g_material.diffuse", 0);
-    this->sp_light.SetUniform("g_material.specular", 1);
-    this->sp_light.SetUniform("g_material.normal", 2);
+        ObjectRing.Upload();
+        bound_obj = nullptr;
+    }
 
-    // shadow casting
-    LOG_DEBUG("Compiling Spot Lighting (Shadows) Vertex Shader");
-    this->vs_shadow = CompileShader(GL_VERTEX_SHADER, ShadowVolume_VS.src, ShadowVolume_VS.len);
+    usize  object_index   = 0;
+    u32    bound_material = UINT32_MAX;
+    GLuint bound_vao      = 0;
+
+    for (const auto& item : queue->items) {
+        if (item.obj != bound_obj) {
+            if (use_ring) {
+                // same order the objects were pushed in above
+                ObjectRing.Bind(object_index++);
+            } else {
+                sp.SetUniform("g_mtx_world", item.obj->WorldMatrix());
+                sp.SetUniform("g_mtx_normal", item.obj->NormalMatrix());
+                sp.SetUniform("g_mtx_wvp", item.obj->WVPMatrix());
+            }
+
+            bound_obj = item.obj;
+        }
 
-    LOG_DEBUG("Compiling Spot Lighting (Shadows) Geometry Shader");
-    this->gs_shadow = CompileLightShader(
-        GL_GEOMETRY_SHADER,
-        LightType::Spot,
-        ShadowVolume_GS.src,
-        ShadowVolume_GS.len);
+        const Material& material = item.model->material;
+        if (material.id != bound_material) {
+            material.Use(sp);
+            bound_material = material.id;
+        }
 
-    LOG_DEBUG("Compiling Spot Lighting (Shadows) Fragment Shader");
-    this->fs_shadow = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+        const Geometry& geometry = item.model->geometry;
+        if (geometry.vao_visual.handle != bound_vao) {
+            geometry.vao_visual.Bind();
+            bound_vao = geometry.vao_visual.handle;
+        }
 
-    LOG_DEBUG("Linking Spot Lighting (Shadows) Shaders");
-    this->sp_shadow = LinkShaders(this->vs_shadow, this->gs_shadow, this->fs_shadow);
-    LOG_DEBUG("Spot Lighting (Shadows) Shader Program = %u", this->sp_shadow.handle);
+        GL(glDrawElements(GL_TRIANGLES, geometry.len_visual, GL_UNSIGNED_INT, 0));
+    }
 }
 
-void Renderer_SpotLighting::Render(
-    const SpotLight&           light,
+/* --- ShadowCasters --- */
+// A shadow volume reaches the near plane only if some point of the near plane rectangle is in the
+// caster's shadow, i.e. the caster intersects the region between the rectangle and the light
+// That region is a pyramid with the light at its apex, or the rectangle extruded towards the light
+// for directional lights, so a caster whose bounds are outside one of its planes can use z-pass
+void ShadowCasters::Partition(
     const std::vector<Object>& objs,
+    const glm::vec4&           light,
     const RenderState&         rs)
 {
-    SetupShadowLightingPass(LightType::Spot);
-    this->sp_shadow.UseProgram();
-    this->sp_shadow.SetUniform("g_light_source.pos", light.pos);
-    this->sp_shadow.SetUniform("g_light_source.dir", light.dir);
-    this->sp_shadow.SetUniform("g_light_source.inner_cutoff", light.inner_cutoff);
-    this->sp_shadow.SetUniform("g_light_source.outer_cutoff", light.outer_cutoff);
+    this->z_pass.clear();
+    this->z_fail.clear();
 
-    for (const auto& obj : objs) {
-        if (obj.CastsShadows()) {
-            this->sp_shadow.SetUniform("g_mtx_world", obj.WorldMatrix());
-            this->sp_shadow.SetUniform("g_mtx_normal", obj.NormalMatrix());
-            this->sp_shadow.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+    // near plane rectangle in world space, counter clockwise
+    const glm::vec2 ndc_corners[4] = {
+        {-1.0f, -1.0f},
+        {1.0f, -1.0f},
+        {1.0f, 1.0f},
+        {-1.0f, 1.0f},
+    };
 
-            obj.DrawShadow(this->sp_shadow);
-        }
+    glm::mat4 mtx_inv_vp = glm::inverse(rs.mtx_vp);
+    glm::vec3 corners[4];
+    glm::vec3 center = glm::vec3(0.0f);
+    for (usize ii = 0; ii < 4; ii++) {
+        glm::vec4 corner = mtx_inv_vp * glm::vec4(ndc_corners[ii], -1.0f, 1.0f);
+        corners[ii]      = glm::vec3(corner) / corner.w;
+        center += corners[ii] / 4.0f;
     }
 
-    SetupDirectLightingPass(LightType::Spot);
-    this->sp_light.UseProgram();
-    this->sp_light.SetUniform("g_light_source.pos", light.pos);
-    this->sp_light.SetUniform("g_light_source.dir", light.dir);
-    this->sp_light.SetUniform("g_light_source.inner_cutoff", light.inner_cutoff);
-    this->sp_light.SetUniform("g_light_source.outer_cutoff", light.outer_cutoff);
-    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+    // planes bounding the region, oriented so the inside is positive
+    glm::vec4 planes[5];
+    usize     plane_count = 0;
 
-    for (const auto& obj : objs) {
-        this->sp_light.SetUniform("g_mtx_world", obj.WorldMatrix());
-        this->sp_light.SetUniform("g_mtx_normal", obj.NormalMatrix());
-        this->sp_light.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+    glm::vec3 near_normal = glm::cross(corners[1] - corners[0], corners[3] - corners[0]);
+    f32       near_dist   = -glm::dot(near_normal, corners[0]);
+    f32       light_side  = glm::dot(near_normal, glm::vec3(light)) + near_dist * light.w;
 
-        obj.DrawVisual(this->sp_light);
-    }
-}
+    // the light (almost) lies on the near plane, the region degenerates so stay conservative
+    if (glm::abs(light_side) < 1e-6f * glm::length(near_normal)) {
+        for (const auto& obj : objs) {
+            if (obj.CastsShadows()) {
+                this->z_fail.push_back(&obj);
+            }
+        }
 
-/* --- Renderer_SunLighting --- */
-Renderer_SunLighting::Renderer_SunLighting()
-{
-    // direct lighting
-    LOG_DEBUG("Compiling Sun Lighting Vertex Shader");
-    this->vs
-        = CompileLightShader(GL_VERTEX_SHADER, LightType::Sun, Lighting_VS.src, Lighting_VS.len);
+        return;
+    }
 
-    LOG_DEBUG("Compiling Sun Lighting Fragment Shader");
-    this->fs
-        = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Sun, Lighting_FS.src, Lighting_FS.len);
+    planes[plane_count++] = light_side > 0.0f ? glm::vec4(near_normal, near_dist)
+                                              : -glm::vec4(near_normal, near_dist);
 
-    LOG_DEBUG("Linking Sun Lighting Shaders");
-    this->sp_light = LinkShaders(this->vs, this->fs);
-    LOG_DEBUG("Sun Lighting Shader Program = %u", this->sp_light.handle);
+    for (usize ii = 0; ii < 4; ii++) {
+        const glm::vec3& start = corners[ii];
+        const glm::vec3& end   = corners[(ii + 1) % 4];
 
-    LOG_DEBUG("Initializing Sun Lighting Shader Program");
-    this->sp_light.SetUniform("g_material.diffuse", 0);
-    this->sp_light.SetUniform("g_material.specular", 1);
-    this->sp_light.SetUniform("g_material.normal", 2);
+        // towards the light, from the start of the edge
+        glm::vec3 to_light = glm::vec3(light) - start * light.w;
+        glm::vec3 normal   = glm::cross(end - start, to_light);
 
-    // shadow casting
-    LOG_DEBUG("Compiling Sun Lighting (Shadows) Vertex Shader");
-    this->vs_shadow = CompileShader(GL_VERTEX_SHADER, ShadowVolume_VS.src, ShadowVolume_VS.len);
+        // skipping a plane only makes the region bigger
+        if (glm::dot(normal, normal) == 0.0f) {
+            continue;
+        }
 
-    LOG_DEBUG("Compiling Sun Lighting (Shadows) Geometry Shader");
-    this->gs_shadow = CompileLightShader(
-        GL_GEOMETRY_SHADER,
-        LightType::Sun,
-        ShadowVolume_GS.src,
-        ShadowVolume_GS.len);
+        glm::vec4 plane = glm::vec4(normal, -glm::dot(normal, start));
+        if (glm::dot(glm::vec3(plane), center) + plane.w < 0.0f) {
+            plane = -plane;
+        }
 
-    LOG_DEBUG("Compiling Sun Lighting (Shadows) Fragment Shader");
-    this->fs_shadow = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+        planes[plane_count++] = plane;
+    }
 
-    LOG_DEBUG("Linking Sun Lighting (Shadows) Shaders");
-    this->sp_shadow = LinkShaders(this->vs_shadow, this->gs_shadow, this->fs_shadow);
-    LOG_DEBUG("Sun Lighting (Shadows) Shader Program = %u", this->sp_shadow.handle);
-}
+    for (const auto& obj : objs) {
+        if (!obj.CastsShadows()) {
+            continue;
+        }
 
-void Renderer_SunLighting::Render(
-    const SunLight&            light,
-    const std::vector<Object>& objs,
-    const RenderState&         rs)
-{
-    SetupShadowLightingPass(LightType::Sun);
-    this->sp_shadow.UseProgram();
-    this->sp_shadow.SetUniform("g_light_source.dir", light.dir);
+        glm::vec3 obj_min, obj_max;
+        ObjectBounds(obj, &obj_min, &obj_max);
 
-    for (const auto& obj : objs) {
-        if (obj.CastsShadows()) {
-            this->sp_shadow.SetUniform("g_mtx_world", obj.WorldMatrix());
-            this->sp_shadow.SetUniform("g_mtx_normal", obj.NormalMatrix());
-            this->sp_shadow.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+        bool is_outside = false;
+        for (usize ii = 0; ii < plane_count; ii++) {
+            if (IsOutsidePlane(planes[ii], obj_min, obj_max)) {
+                is_outside = true;
+                break;
+            }
+        }
 
-            obj.DrawShadow(this->sp_shadow);
+        if (is_outside) {
+            this->z_pass.push_back(&obj);
+        } else {
+            this->z_fail.push_back(&obj);
         }
     }
+}
 
-    SetupDirectLightingPass(LightType::Sun);
-    this->sp_light.UseProgram();
-    this->sp_light.SetUniform("g_light_source.dir", light.dir);
-    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+/* --- ShadowVolumeCompute --- */
+bool  ShadowVolumeCompute::is_buffer_initialized = false;
+SSBO  ShadowVolumeCompute::ssbo_volume;
+DIB   ShadowVolumeCompute::dib_volume;
+VAO   ShadowVolumeCompute::vao_volume;
+usize ShadowVolumeCompute::volume_capacity = 0;
 
-    for (const auto& obj : objs) {
-        this->sp_light.SetUniform("g_mtx_world", obj.WorldMatrix());
-        this->sp_light.SetUniform("g_mtx_normal", obj.NormalMatrix());
-        this->sp_light.SetUniform("g_mtx_wvp", rs.mtx_vp * obj.WorldMatrix());
+std::unordered_map<size_t, ShadowVolumeCompute::CachedVolume> ShadowVolumeCompute::volume_cache;
+std::vector<ShadowVolumeCompute::CachedVolume> ShadowVolumeCompute::volume_free_list;
+std::vector<size_t>                            ShadowVolumeCompute::volume_seen;
+std::vector<size_t>                            ShadowVolumeCompute::volume_seen_prev;
+u64                                            ShadowVolumeCompute::frame = 0;
 
-        obj.DrawVisual(this->sp_light);
-    }
-}
+ShadowVolumeCompute::ShadowVolumeCompute(LightType type)
+{
+    LOG_DEBUG("Compiling Shadow Volume Compute Shader");
+    this->cs = CompileLightShader(GL_COMPUTE_SHADER, type, ShadowVolume_CS);
 
-/* --- Renderer_Skybox --- */
+    LOG_DEBUG("Linking Shadow Volume Compute Shader");
+    this->sp_extrude = LinkShaders(this->cs);
+    LOG_DEBUG("Shadow Volume Compute Shader Program = %u", this->sp_extrude.handle);
+
+    LOG_DEBUG("Compiling Shadow Volume (Compute) Vertex Shader");
+    this->vs = CompileShader(
+        GL_VERTEX_SHADER,
+        ShadowVolumeCompute_VS.src,
+        ShadowVolumeCompute_VS.len);
+
+    LOG_DEBUG("Compiling Shadow Volume (Compute) Fragment Shader");
+    this->fs = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+
+    LOG_DEBUG("Linking Shadow Volume (Compute) Shaders");
+    this->sp_draw = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Shadow Volume (Compute) Shader Program = %u", this->sp_draw.handle);
+
+    if (is_buffer_initialized) {
+        return;
+    }
+
+    this->ssbo_volume.Reserve();
+    this->dib_volume.Reserve();
+    this->dib_volume.LoadData(sizeof(DrawArraysIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+
+    // the volume is pulled from the SSBO, but the core profile still requires a VAO to draw
+    this->vao_volume.Reserve();
+
+    is_buffer_initialized = true;
+}
+
+// hashes everything about the shadow casters that affects their world space volumes
+static size_t HashShadowCasters(const std::vector<const Object*>& casters)
+{
+    size_t hash = HashCombine(casters.size());
+
+    for (const auto* obj : casters) {
+        const glm::mat4& mtx_world = obj->WorldMatrix();
+        for (usize ii = 0; ii < 4; ii++) {
+            const glm::vec4& col = mtx_world[ii];
+            hash                 = HashCombine(hash, col.x, col.y, col.z, col.w);
+        }
+
+        for (const auto& model : obj->models) {
+            hash = HashCombine(hash, model.geometry.vbo.handle, model.geometry.len_shadow);
+        }
+    }
+
+    return hash;
+}
+
+void ShadowVolumeCompute::Render(
+    const std::vector<const Object*>& casters,
+    bool                              is_capped,
+    size_t                            light_hash)
+{
+    usize triangle_count = 0;
+    for (const auto* obj : casters) {
+        for (const auto& model : obj->models) {
+            triangle_count += model.geometry.len_shadow / 6;
+        }
+    }
+
+    if (triangle_count == 0) {
+        return;
+    }
+
+    if (!settings.cache_shadow_volumes) {
+        this->Extrude(casters, is_capped, triangle_count);
+        this->DrawIndirect();
+        return;
+    }
+
+    size_t key  = HashCombine(light_hash, is_capped, HashShadowCasters(casters));
+    auto   iter = volume_cache.find(key);
+
+    if (iter != volume_cache.end()) {
+        iter->second.last_used_frame = frame;
+        this->Draw(iter->second.ssbo, iter->second.count);
+        return;
+    }
+
+    this->Extrude(casters, is_capped, triangle_count);
+
+    // only volumes that were also needed last frame get cached, caching requires reading back the
+    // vertex count which would stall every frame for lights that are moving
+    bool is_static = std::find(volume_seen_prev.begin(), volume_seen_prev.end(), key)
+                     != volume_seen_prev.end();
+    if (!is_static) {
+        volume_seen.push_back(key);
+        this->DrawIndirect();
+        return;
+    }
+
+    DrawArraysIndirectCommand cmd;
+    this->dib_volume.GetSubData(0, sizeof(cmd), &cmd);
+
+    // prefer recycling an evicted buffer that's big enough
+    CachedVolume volume = {};
+    for (usize ii = 0; ii < volume_free_list.size(); ii++) {
+        if (volume_free_list[ii].capacity >= cmd.count) {
+            volume = volume_free_list[ii];
+            volume_free_list.erase(volume_free_list.begin() + ii);
+            break;
+        }
+    }
+
+    if (volume.ssbo.handle == 0) {
+        volume.ssbo.Reserve();
+        volume.ssbo.LoadData(cmd.count * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+        volume.capacity = cmd.count;
+    }
+
+    volume.ssbo.CopyData(this->ssbo_volume, cmd.count * sizeof(glm::vec4));
+    volume.count           = cmd.count;
+    volume.last_used_frame = frame;
+
+    volume_cache[key] = volume;
+
+    this->Draw(volume.ssbo, volume.count);
+}
+
+void ShadowVolumeCompute::NextFrame()
+{
+    for (auto iter = volume_cache.begin(); iter != volume_cache.end();) {
+        if (iter->second.last_used_frame == frame) {
+            iter++;
+            continue;
+        }
+
+        if (volume_free_list.size() < MAX_FREE_VOLUMES) {
+            volume_free_list.push_back(iter->second);
+        } else {
+            iter->second.ssbo.Delete();
+        }
+
+        iter = volume_cache.erase(iter);
+    }
+
+    std::swap(volume_seen, volume_seen_prev);
+    volume_seen.clear();
+
+    frame += 1;
+}
+
+void ShadowVolumeCompute::Extrude(
+    const std::vector<const Object*>& casters,
+    bool                              is_capped,
+    usize                             triangle_count)
+{
+    // the buffer is sized for the worst case so the compute shader never has to bounds check, most
+    // triangles only emit a cap or nothing at all so much of it goes unused, but sizing it from the
+    // emitted count would mean reading the count back or dropping triangles when a frame needs more
+    usize required_capacity = triangle_count * MAX_VERTICES_PER_TRIANGLE;
+    if (required_capacity > this->volume_capacity) {
+        this->ssbo_volume.LoadData(required_capacity * sizeof(glm::vec4), NULL, GL_DYNAMIC_COPY);
+        this->volume_capacity = required_capacity;
+    }
+
+    DrawArraysIndirectCommand cmd = {0, 1, 0, 0};
+    this->dib_volume.SubData(0, sizeof(cmd), &cmd);
+
+    // extrude the volumes of every caster into the shared buffer
+    this->sp_extrude.UseProgram();
+    this->sp_extrude.SetUniform("g_emit_caps", is_capped);
+    this->ssbo_volume.BindSlot(2);
+    this->dib_volume.BindSlot(3);
+
+    for (const auto* obj : casters) {
+        this->sp_extrude.SetUniform("g_mtx_world", obj->WorldMatrix());
+
+        for (const auto& model : obj->models) {
+            GLuint model_triangles = model.geometry.len_shadow / 6;
+
+            this->sp_extrude.SetUniform("g_triangle_count", model_triangles);
+            model.geometry.vbo.BindSlot(0);
+            model.geometry.ebo_shadow.BindSlot(1);
+
+            GL(glDispatchCompute((model_triangles + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1));
+        }
+    }
+
+    // the draw (or copy) consumes both the vertices and the vertex count written by the shader
+    GL(glMemoryBarrier(
+        GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+}
+
+void ShadowVolumeCompute::Draw(const SSBO& ssbo, GLsizei count)
+{
+    this->sp_draw.UseProgram();
+    this->vao_volume.Bind();
+    ssbo.BindSlot(2);
+
+    GL(glDrawArrays(GL_TRIANGLES, 0, count));
+}
+
+void ShadowVolumeCompute::DrawIndirect()
+{
+    this->sp_draw.UseProgram();
+    this->vao_volume.Bind();
+    this->ssbo_volume.BindSlot(2);
+    this->dib_volume.Bind();
+
+    GL(glDrawArraysIndirect(GL_TRIANGLES, 0));
+
+    this->dib_volume.Unbind();
+}
+
+/* --- ShadowVolumeSilhouette --- */
+ShadowVolumeSilhouette::ShadowVolumeSilhouette()
+{
+    LOG_DEBUG("Compiling Shadow Volume (Silhouette) Vertex Shader");
+    this->vs = CompileShader(
+        GL_VERTEX_SHADER,
+        ShadowVolumeSilhouette_VS.src,
+        ShadowVolumeSilhouette_VS.len);
+
+    LOG_DEBUG("Compiling Shadow Volume (Silhouette) Fragment Shader");
+    this->fs = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+
+    LOG_DEBUG("Linking Shadow Volume (Silhouette) Shaders");
+    this->sp = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Shadow Volume (Silhouette) Shader Program = %u", this->sp.handle);
+
+    this->ssbo_records.Reserve();
+}
+
+// A caster's shadow volume lies within its bounding box extruded away from the light, if the box is
+// outside one of the side planes of the view frustum and the extrusion never comes back across it
+// then the volume can't touch the view
+// NOTE: the near and far planes are skipped since depth clamping means they never clip the volume
+static bool IsShadowVolumeVisible(
+    const glm::vec3& aabb_min,
+    const glm::vec3& aabb_max,
+    const glm::mat4& mtx_world,
+    const glm::vec4& light,
+    const glm::mat4& mtx_vp)
+{
+    glm::vec3 world_min, world_max;
+    WorldBounds(aabb_min, aabb_max, mtx_world, &world_min, &world_max);
+
+    // see: Gribb & Hartmann, Fast Extraction of Viewing Frustum Planes from the WVP Matrix
+    glm::vec4 row_x = {mtx_vp[0][0], mtx_vp[1][0], mtx_vp[2][0], mtx_vp[3][0]};
+    glm::vec4 row_y = {mtx_vp[0][1], mtx_vp[1][1], mtx_vp[2][1], mtx_vp[3][1]};
+    glm::vec4 row_w = {mtx_vp[0][3], mtx_vp[1][3], mtx_vp[2][3], mtx_vp[3][3]};
+
+    const glm::vec4 planes[4] = {
+        row_w + row_x, // left
+        row_w - row_x, // right
+        row_w + row_y, // bottom
+        row_w - row_y, // top
+    };
+
+    for (const auto& plane : planes) {
+        // the corner of the box furthest along the plane normal
+        glm::vec3 corner = {
+            plane.x >= 0.0f ? world_max.x : world_min.x,
+            plane.y >= 0.0f ? world_max.y : world_min.y,
+            plane.z >= 0.0f ? world_max.z : world_min.z,
+        };
+
+        f32 box_dist   = glm::dot(glm::vec3(plane), corner) + plane.w;
+        f32 light_dist = glm::dot(plane, light);
+
+        if (box_dist >= 0.0f) {
+            continue;
+        }
+
+        // positional lights push the box further out as long as the light is no further out than
+        // the box, directional lights as long as they point away from the plane
+        bool is_extruded_outwards = light.w > 0.0f ? light_dist >= box_dist : light_dist >= 0.0f;
+        if (is_extruded_outwards) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ShadowVolumeSilhouette::Render(
+    const std::vector<const Object*>& casters,
+    bool                              is_capped,
+    const glm::vec4&                  light,
+    const RenderState&                rs)
+{
+    usize job_count = 0;
+    this->draws.clear();
+
+    // split the visible casters into jobs
+    for (const auto* obj : casters) {
+        glm::mat4 mtx_world   = obj->WorldMatrix();
+        glm::vec4 light_local = glm::inverse(mtx_world) * light;
+
+        for (const auto& model : obj->models) {
+            const Geometry&       geometry = model.geometry;
+            const SilhouetteMesh& mesh     = geometry.silhouette;
+
+            if (!IsShadowVolumeVisible(
+                    geometry.aabb_min,
+                    geometry.aabb_max,
+                    mtx_world,
+                    light,
+                    rs.mtx_vp))
+            {
+                continue;
+            }
+
+            Draw draw      = {};
+            draw.geometry  = &geometry;
+            draw.mtx_world = mtx_world;
+            draw.job_begin = job_count;
+
+            for (usize is_face = 0; is_face < 2; is_face++) {
+                usize count = is_face ? (is_capped ? mesh.face_count : 0) : mesh.edge_count;
+                for (usize begin = 0; begin < count; begin += CHUNK_SIZE) {
+                    if (job_count == this->jobs.size()) {
+                        this->jobs.emplace_back();
+                    }
+
+                    Job& job    = this->jobs[job_count++];
+                    job.mesh    = &mesh;
+                    job.light   = light_local;
+                    job.begin   = begin;
+                    job.end     = glm::min(begin + CHUNK_SIZE, count);
+                    job.is_face = is_face;
+                    job.records.clear();
+                }
+            }
+
+            draw.job_end = job_count;
+            this->draws.push_back(draw);
+        }
+    }
+
+    if (this->draws.empty()) {
+        return;
+    }
+
+    {
+        PROFILE_SCOPE("Classify Silhouettes");
+        WorkerThreads().ParallelFor(job_count, 1, [&](usize begin, usize end) {
+            for (usize ii = begin; ii < end; ii++) {
+                Job& job = this->jobs[ii];
+                if (job.is_face) {
+                    job.mesh->ClassifyFaces(job.light, job.begin, job.end, &job.records);
+                } else {
+                    job.mesh->ClassifyEdges(job.light, job.begin, job.end, &job.records);
+                }
+            }
+        });
+    }
+
+    // pack the records of each draw together, edges first then faces
+    this->records.clear();
+    for (auto& draw : this->draws) {
+        for (usize is_face = 0; is_face < 2; is_face++) {
+            usize offset = this->records.size();
+
+            for (usize ii = draw.job_begin; ii < draw.job_end; ii++) {
+                const Job& job = this->jobs[ii];
+                if (job.is_face == (bool)is_face) {
+                    this->records.insert(
+                        this->records.end(),
+                        job.records.begin(),
+                        job.records.end());
+                }
+            }
+
+            GLsizei count = this->records.size() - offset;
+            if (is_face) {
+                draw.face_offset = offset;
+                draw.face_count  = count;
+            } else {
+                draw.edge_offset = offset;
+                draw.edge_count  = count;
+            }
+        }
+    }
+
+    if (this->records.empty()) {
+        return;
+    }
+
+    this->ssbo_records.LoadData(
+        this->records.size() * sizeof(u32),
+        this->records.data(),
+        GL_STREAM_DRAW);
+
+    this->sp.UseProgram();
+    this->sp.SetUniform("g_light", light);
+    this->ssbo_records.BindSlot(2);
+    ShadowVolumeCompute::vao_volume.Bind();
+
+    for (const auto& draw : this->draws) {
+        this->sp.SetUniform("g_mtx_world", draw.mtx_world);
+        draw.geometry->silhouette.ssbo_edges.BindSlot(0);
+        draw.geometry->silhouette.ssbo_faces.BindSlot(1);
+
+        if (draw.edge_count > 0) {
+            this->sp.SetUniform("g_is_cap", false);
+            this->sp.SetUniform("g_record_offset", draw.edge_offset);
+            GL(glDrawArrays(GL_TRIANGLES, 0, draw.edge_count * VERTICES_PER_RECORD));
+        }
+
+        if (draw.face_count > 0) {
+            this->sp.SetUniform("g_is_cap", true);
+            this->sp.SetUniform("g_record_offset", draw.face_offset);
+            GL(glDrawArrays(GL_TRIANGLES, 0, draw.face_count * VERTICES_PER_RECORD));
+        }
+    }
+}
+
+/* --- CubeShadowMapCache --- */
+CubeShadowMapCache::CubeShadowMapCache()
+{
+    LOG_DEBUG("Compiling Cube Shadow Map Vertex Shader");
+    this->vs = CompileDrawShader(GL_VERTEX_SHADER, ShadowCube_VS);
+
+    LOG_DEBUG("Compiling Cube Shadow Map Fragment Shader");
+    this->fs = CompileShader(GL_FRAGMENT_SHADER, ShadowCube_FS.src, ShadowCube_FS.len);
+
+    LOG_DEBUG("Linking Cube Shadow Map Shaders");
+    this->sp = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Cube Shadow Map Shader Program = %u", this->sp.handle);
+
+    for (usize ii = 0; ii < TIER_COUNT; ii++) {
+        this->tiers[ii].tex_depth.Reserve();
+        this->tiers[ii].tex_depth.Setup(TIER_RESOLUTION[ii], TIER_SLOTS[ii]);
+        this->tiers[ii].slots.resize(TIER_SLOTS[ii], Slot{0, 0, 0});
+    }
+
+    this->fbo.Reserve();
+    this->fbo.Attach(this->tiers[0].tex_depth, GL_DEPTH_ATTACHMENT, 0);
+    GL(glNamedFramebufferDrawBuffer(this->fbo.handle, GL_NONE));
+    GL(glNamedFramebufferReadBuffer(this->fbo.handle, GL_NONE));
+    this->fbo.CheckComplete();
+}
+
+// the highest resolution tier that isn't much larger than the light's on screen diameter
+usize CubeShadowMapCache::SelectTier(const PointLight& light, const RenderState& rs) const
+{
+    f32 radius = light.Radius();
+    f32 dist   = glm::length(light.pos - rs.pos_view);
+
+    f32 coverage = rs.resolution.y;
+    if (dist > radius) {
+        // projected radius of the bounding sphere in NDC, where the screen is 2 units tall, so
+        // scaling by the resolution gives the diameter in pixels
+        f32 ndc_radius = radius / glm::sqrt(dist * dist - radius * radius) * rs.mtx_proj[1][1];
+        coverage       = glm::min(ndc_radius * rs.resolution.y, rs.resolution.y);
+    }
+
+    for (usize ii = 0; ii < TIER_COUNT; ii++) {
+        if ((f32)TIER_RESOLUTION[ii] <= coverage) {
+            return ii;
+        }
+    }
+
+    return TIER_COUNT - 1;
+}
+
+// finds a free slot, or the least recently used one that wasn't used this frame, starting at the
+// given tier and falling back to lower resolutions
+bool CubeShadowMapCache::Allocate(usize tier, size_t light_key, Location* location)
+{
+    for (usize ii = tier; ii < TIER_COUNT; ii++) {
+        std::vector<Slot>& slots = this->tiers[ii].slots;
+
+        usize best = slots.size();
+        for (usize jj = 0; jj < slots.size(); jj++) {
+            if (slots[jj].light_key == 0) {
+                best = jj;
+                break;
+            }
+
+            if (slots[jj].last_used_frame == this->frame) {
+                continue;
+            }
+
+            if (best == slots.size() || slots[jj].last_used_frame < slots[best].last_used_frame) {
+                best = jj;
+            }
+        }
+
+        if (best == slots.size()) {
+            continue;
+        }
+
+        if (slots[best].light_key != 0) {
+            this->locations.erase(slots[best].light_key);
+        }
+
+        slots[best] = {light_key, 0, this->frame};
+
+        *location                  = {ii, best};
+        this->locations[light_key] = *location;
+        return true;
+    }
+
+    return false;
+}
+
+void CubeShadowMapCache::RenderFaces(const PointLight& light, const Location& location)
+{
+    // see: https://www.khronos.org/opengl/wiki/Cubemap_Texture#Upload_and_orientation
+    const glm::vec3 face_dirs[6] = {
+        {1.0f, 0.0f, 0.0f},
+        {-1.0f, 0.0f, 0.0f},
+        {0.0f, 1.0f, 0.0f},
+        {0.0f, -1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f},
+        {0.0f, 0.0f, -1.0f},
+    };
+    const glm::vec3 face_ups[6] = {
+        {0.0f, -1.0f, 0.0f},
+        {0.0f, -1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f},
+        {0.0f, 0.0f, -1.0f},
+        {0.0f, -1.0f, 0.0f},
+        {0.0f, -1.0f, 0.0f},
+    };
+
+    f32       radius   = light.Radius();
+    glm::mat4 mtx_proj = glm::perspective(glm::radians(90.0f), 1.0f, CLIP_NEAR, radius);
+
+    const Tier& tier = this->tiers[location.tier];
+
+    GLState.Apply(CUBE_SHADOW_MAP_STATE);
+    this->fbo.Bind();
+    GL(glViewport(0, 0, TIER_RESOLUTION[location.tier], TIER_RESOLUTION[location.tier]));
+
+    this->sp.UseProgram();
+    this->sp.SetUniform("g_light_pos", light.pos);
+    this->sp.SetUniform("g_light_radius", radius);
+
+    // every face draws the same casters, so the batch is built once
+    bool is_batched = MultiDrawBatch::IsSupported();
+    if (is_batched) {
+        this->batch.Clear();
+        for (const auto* obj : this->casters) {
+            for (const auto& model : obj->models) {
+                this->batch.Push(obj->WorldMatrix(), obj->NormalMatrix(), model);
+            }
+        }
+
+        this->batch.Upload();
+    }
+
+    for (usize face = 0; face < 6; face++) {
+        this->fbo.Attach(tier.tex_depth, GL_DEPTH_ATTACHMENT, (GLint)(location.slot * 6 + face));
+        GL(glClear(GL_DEPTH_BUFFER_BIT));
+
+        glm::mat4 mtx_view = glm::lookAt(light.pos, light.pos + face_dirs[face], face_ups[face]);
+        this->sp.SetUniform("g_mtx_vp", mtx_proj * mtx_view);
+
+        if (is_batched) {
+            this->batch.Draw();
+            continue;
+        }
+
+        for (const auto* obj : this->casters) {
+            this->sp.SetUniform("g_mtx_world", obj->WorldMatrix());
+            for (const auto& model : obj->models) {
+                model.geometry.DrawVisual(this->sp);
+            }
+        }
+    }
+}
+
+bool CubeShadowMapCache::Render(
+    const PointLight&          light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    f32 radius = light.Radius();
+
+    // only casters within the light's radius affect its map
+    this->casters.clear();
+    for (const auto& obj : objs) {
+        if (!obj.CastsShadows()) {
+            continue;
+        }
+
+        glm::vec3 obj_min, obj_max;
+        ObjectBounds(obj, &obj_min, &obj_max);
+
+        glm::vec3 closest = glm::clamp(light.pos, obj_min, obj_max);
+        if (glm::dot(closest - light.pos, closest - light.pos) <= radius * radius) {
+            this->casters.push_back(&obj);
+        }
+    }
+
+    // 0 marks free slots
+    size_t light_key   = HashCombine(light.pos.x, light.pos.y, light.pos.z, radius) | 1;
+    size_t caster_hash = HashShadowCasters(this->casters);
+    usize  tier        = this->SelectTier(light, rs);
+
+    auto iter = this->locations.find(light_key);
+    if (iter != this->locations.end()) {
+        Location location = iter->second;
+        Slot&    slot     = this->tiers[location.tier].slots[location.slot];
+
+        // moving between neighbouring tiers isn't worth a re-render, this also keeps lights near
+        // a tier's threshold from bouncing between tiers
+        usize tier_distance = location.tier > tier ? location.tier - tier : tier - location.tier;
+        if (tier_distance <= 1) {
+            slot.last_used_frame = this->frame;
+            this->current        = location;
+
+            if (slot.caster_hash != caster_hash) {
+                this->RenderFaces(light, location);
+                slot.caster_hash = caster_hash;
+            }
+
+            return true;
+        }
+
+        slot.light_key = 0;
+        this->locations.erase(iter);
+    }
+
+    Location location;
+    if (!this->Allocate(tier, light_key, &location)) {
+        return false;
+    }
+
+    this->RenderFaces(light, location);
+
+    this->tiers[location.tier].slots[location.slot].caster_hash = caster_hash;
+    this->current = location;
+
+    return true;
+}
+
+void CubeShadowMapCache::Use(ShaderProgram& sp, const PointLight& light) const
+{
+    this->tiers[this->current.tier].tex_depth.Bind(GL_TEXTURE0 + TEXTURE_SLOT);
+
+    sp.SetUniform("g_shadow_layer", (GLint)this->current.slot);
+    sp.SetUniform("g_shadow_radius", light.Radius());
+    sp.SetUniform("g_shadow_texel_angle", 2.0f / (f32)TIER_RESOLUTION[this->current.tier]);
+}
+
+void CubeShadowMapCache::NextFrame()
+{
+    this->frame += 1;
+}
+
+/* --- Renderer_AmbientLighting --- */
+Renderer_AmbientLighting::Renderer_AmbientLighting()
+{
+    LOG_DEBUG("Compiling Ambient Lighting Vertex Shader");
+    this->vs = CompileLightShader(GL_VERTEX_SHADER, LightType::Ambient, Lighting_VS);
+
+    LOG_DEBUG("Compiling Ambient Lighting Fragment Shader");
+    this->fs = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Ambient, Lighting_FS);
+
+    LOG_DEBUG("Linking Ambient Lighting Shaders");
+    this->sp_light = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Ambient Lighting Shader Program = %u", this->sp_light.handle);
+
+    LOG_DEBUG("Initializing Ambient Lighting Shader Program");
+    SetupMaterialSamplers(this->sp_light);
+}
+
+void Renderer_AmbientLighting::Render(
+    const AmbientLight&        light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    GLState.Apply(DirectLightingState(LightType::Ambient));
+    this->sp_light.UseProgram();
+    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+
+    DrawVisuals(&this->queue, &this->batch, LightType::Ambient, this->sp_light, objs, rs);
+}
+
+/* --- Renderer_PointLighting --- */
+Renderer_PointLighting::Renderer_PointLighting()
+{
+    // direct lighting
+    LOG_DEBUG("Compiling Point Lighting Vertex Shader");
+    this->vs = CompileLightShader(GL_VERTEX_SHADER, LightType::Point, Lighting_VS);
+
+    LOG_DEBUG("Compiling Point Lighting Fragment Shader");
+    this->fs = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Point, Lighting_FS);
+
+    LOG_DEBUG("Linking Point Lighting Shaders");
+    this->sp_light = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Point Lighting Shader Program = %u", this->sp_light.handle);
+
+    LOG_DEBUG("Initializing Point Lighting Shader Program");
+    SetupMaterialSamplers(this->sp_light);
+
+    // shadow casting
+    LOG_DEBUG("Compiling Point Lighting (Shadows) Vertex Shader");
+    this->vs_shadow = CompileShader(GL_VERTEX_SHADER, ShadowVolume_VS.src, ShadowVolume_VS.len);
+
+    LOG_DEBUG("Compiling Point Lighting (Shadows) Geometry Shader");
+    this->gs_shadow = CompileLightShader(GL_GEOMETRY_SHADER, LightType::Point, ShadowVolume_GS);
+
+    LOG_DEBUG("Compiling Point Lighting (Shadows) Fragment Shader");
+    this->fs_shadow = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+
+    LOG_DEBUG("Linking Point Lighting (Shadows) Shaders");
+    this->sp_shadow = LinkShaders(this->vs_shadow, this->gs_shadow, this->fs_shadow);
+    LOG_DEBUG("Point Lighting (Shadows) Shader Program = %u", this->sp_shadow.handle);
+
+    this->shadow_compute = ShadowVolumeCompute(LightType::Point);
+    this->sp_light.SetUniform("g_shadow_cube", CubeShadowMapCache::TEXTURE_SLOT);
+}
+
+bool Renderer_PointLighting::RenderShadowMap(
+    const PointLight&          light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    ASSERT(light.ShadowMapped());
+
+    return this->shadow_maps.Render(light, objs, rs);
+}
+
+void Renderer_PointLighting::RenderShadowVolumes(
+    const PointLight&          light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    SetupShadowLightingPass(LightType::Point);
+    this->shadow_casters.Partition(objs, glm::vec4(light.pos, 1.0f), rs);
+
+    for (bool is_z_fail : {false, true}) {
+        const auto& casters = is_z_fail ? this->shadow_casters.z_fail : this->shadow_casters.z_pass;
+        if (casters.empty()) {
+            continue;
+        }
+
+        GLState.Apply(ShadowVolumeState(is_z_fail));
+        if (settings.shadow_volume_mode == ShadowVolumeMode::ComputeShader) {
+            PROFILE_SCOPE("Shadow Volumes (CS)");
+            this->shadow_compute.sp_extrude.SetUniform("g_light_source.pos", light.pos);
+            this->shadow_compute.Render(
+                casters,
+                is_z_fail,
+                HashCombine(LightType::Point, light.pos.x, light.pos.y, light.pos.z));
+        } else if (settings.shadow_volume_mode == ShadowVolumeMode::CPU) {
+            PROFILE_SCOPE("Shadow Volumes (CPU)");
+            this->shadow_silhouette.Render(casters, is_z_fail, glm::vec4(light.pos, 1.0f), rs);
+        } else {
+            PROFILE_SCOPE("Shadow Volumes (GS)");
+            this->sp_shadow.UseProgram();
+            this->sp_shadow.SetUniform("g_emit_caps", is_z_fail);
+            this->sp_shadow.SetUniform("g_light_source.pos", light.pos);
+
+            for (const auto* obj : casters) {
+                this->sp_shadow.SetUniform("g_mtx_world", obj->WorldMatrix());
+                this->sp_shadow.SetUniform("g_mtx_normal", obj->NormalMatrix());
+                this->sp_shadow.SetUniform("g_mtx_wvp", obj->WVPMatrix());
+
+                obj->DrawShadow(this->sp_shadow);
+            }
+        }
+    }
+}
+
+void Renderer_PointLighting::Render(
+    const PointLight&          light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs,
+    bool                       uses_shadow_map)
+{
+    if (!uses_shadow_map) {
+        this->RenderShadowVolumes(light, objs, rs);
+    }
+
+    // the stencil buffer still holds the volumes of the previous light when using a shadow map
+    PipelineState state = DirectLightingState(LightType::Point);
+    state.stencil_test  = !uses_shadow_map;
+    GLState.Apply(state);
+    this->sp_light.UseProgram();
+    this->sp_light.SetUniform("g_light_source.pos", light.pos);
+    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+
+    if (uses_shadow_map) {
+        this->shadow_maps.Use(this->sp_light, light);
+    } else {
+        this->sp_light.SetUniform("g_shadow_layer", -1);
+    }
+
+    DrawVisuals(&this->queue, &this->batch, LightType::Point, this->sp_light, objs, rs);
+}
+
+/* --- Renderer_SpotLighting --- */
+Renderer_SpotLighting::Renderer_SpotLighting()
+{
+    // direct lighting
+    LOG_DEBUG("Compiling Spot Lighting Vertex Shader");
+    this->vs = CompileLightShader(GL_VERTEX_SHADER, LightType::Spot, Lighting_VS);
+
+    LOG_DEBUG("Compiling Spot Lighting Fragment Shader");
+    this->fs = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Spot, Lighting_FS);
+
+    LOG_DEBUG("Linking Spot Lighting Shaders");
+    this->sp_light = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Spot Lighting Shader Program = %u", this->sp_light.handle);
+
+    LOG_DEBUG("Initializing Spot Lighting Shader Program");
+    SetupMaterialSamplers(this->sp_light);
+
+    // shadow casting
+    LOG_DEBUG("Compiling Spot Lighting (Shadows) Vertex Shader");
+    this->vs_shadow = CompileShader(GL_VERTEX_SHADER, ShadowVolume_VS.src, ShadowVolume_VS.len);
+
+    LOG_DEBUG("Compiling Spot Lighting (Shadows) Geometry Shader");
+    this->gs_shadow = CompileLightShader(GL_GEOMETRY_SHADER, LightType::Spot, ShadowVolume_GS);
+
+    LOG_DEBUG("Compiling Spot Lighting (Shadows) Fragment Shader");
+    this->fs_shadow = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+
+    LOG_DEBUG("Linking Spot Lighting (Shadows) Shaders");
+    this->sp_shadow = LinkShaders(this->vs_shadow, this->gs_shadow, this->fs_shadow);
+    LOG_DEBUG("Spot Lighting (Shadows) Shader Program = %u", this->sp_shadow.handle);
+
+    this->shadow_compute = ShadowVolumeCompute(LightType::Spot);
+}
+
+void Renderer_SpotLighting::Render(
+    const SpotLight&           light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    SetupShadowLightingPass(LightType::Spot);
+    this->shadow_casters.Partition(objs, glm::vec4(light.pos, 1.0f), rs);
+
+    for (bool is_z_fail : {false, true}) {
+        const auto& casters = is_z_fail ? this->shadow_casters.z_fail : this->shadow_casters.z_pass;
+        if (casters.empty()) {
+            continue;
+        }
+
+        GLState.Apply(ShadowVolumeState(is_z_fail));
+        if (settings.shadow_volume_mode == ShadowVolumeMode::ComputeShader) {
+            PROFILE_SCOPE("Shadow Volumes (CS)");
+            this->shadow_compute.sp_extrude.SetUniform("g_light_source.pos", light.pos);
+            this->shadow_compute.sp_extrude.SetUniform("g_light_source.dir", light.dir);
+            this->shadow_compute.Render(
+                casters,
+                is_z_fail,
+                HashCombine(
+                    LightType::Spot,
+                    light.pos.x,
+                    light.pos.y,
+                    light.pos.z,
+                    light.dir.x,
+                    light.dir.y,
+                    light.dir.z));
+        } else if (settings.shadow_volume_mode == ShadowVolumeMode::CPU) {
+            PROFILE_SCOPE("Shadow Volumes (CPU)");
+            this->shadow_silhouette.Render(casters, is_z_fail, glm::vec4(light.pos, 1.0f), rs);
+        } else {
+            PROFILE_SCOPE("Shadow Volumes (GS)");
+            this->sp_shadow.UseProgram();
+            this->sp_shadow.SetUniform("g_emit_caps", is_z_fail);
+            this->sp_shadow.SetUniform("g_light_source.pos", light.pos);
+            this->sp_shadow.SetUniform("g_light_source.dir", light.dir);
+            this->sp_shadow.SetUniform("g_light_source.inner_cutoff", light.inner_cutoff);
+            this->sp_shadow.SetUniform("g_light_source.outer_cutoff", light.outer_cutoff);
+
+            for (const auto* obj : casters) {
+                this->sp_shadow.SetUniform("g_mtx_world", obj->WorldMatrix());
+                this->sp_shadow.SetUniform("g_mtx_normal", obj->NormalMatrix());
+                this->sp_shadow.SetUniform("g_mtx_wvp", obj->WVPMatrix());
+
+                obj->DrawShadow(this->sp_shadow);
+            }
+        }
+    }
+
+    GLState.Apply(DirectLightingState(LightType::Spot));
+    this->sp_light.UseProgram();
+    this->sp_light.SetUniform("g_light_source.pos", light.pos);
+    this->sp_light.SetUniform("g_light_source.dir", light.dir);
+    this->sp_light.SetUniform("g_light_source.inner_cutoff", light.inner_cutoff);
+    this->sp_light.SetUniform("g_light_source.outer_cutoff", light.outer_cutoff);
+    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+
+    DrawVisuals(&this->queue, &this->batch, LightType::Spot, this->sp_light, objs, rs);
+}
+
+/* --- CascadedShadowMap --- */
+CascadedShadowMap::CascadedShadowMap(u32 max_cascades)
+{
+    LOG_DEBUG("Compiling Shadow Map Vertex Shader");
+    this->vs = CompileDrawShader(GL_VERTEX_SHADER, ShadowMap_VS);
+
+    LOG_DEBUG("Linking Shadow Map Shaders");
+    this->sp = LinkShaders(this->vs);
+    LOG_DEBUG("Shadow Map Shader Program = %u", this->sp.handle);
+
+    this->tex_depth.Reserve();
+    this->tex_depth.Setup(RESOLUTION, RESOLUTION, max_cascades);
+
+    this->fbo.Reserve();
+    this->fbo.Attach(this->tex_depth, GL_DEPTH_ATTACHMENT, 0);
+    GL(glNamedFramebufferDrawBuffer(this->fbo.handle, GL_NONE));
+    GL(glNamedFramebufferReadBuffer(this->fbo.handle, GL_NONE));
+    this->fbo.CheckComplete();
+}
+
+void CascadedShadowMap::Fit(const SunLight& light, const RenderState& rs)
+{
+    this->cascade_count = light.ShadowCascades();
+
+    // recover the clip planes and the frustum's slopes from the projection matrix
+    f32 clip_near = rs.mtx_proj[3][2] / (rs.mtx_proj[2][2] - 1.0f);
+    f32 clip_far  = rs.mtx_proj[3][2] / (rs.mtx_proj[2][2] + 1.0f);
+    f32 slope_x   = 1.0f / rs.mtx_proj[0][0];
+    f32 slope_y   = 1.0f / rs.mtx_proj[1][1];
+
+    glm::mat4 mtx_inv_view = glm::inverse(rs.mtx_view);
+
+    // rotation only, so snapping in light space is stable under camera translation
+    glm::vec3 up = glm::abs(light.dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f)
+                                                 : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 mtx_light_view = glm::lookAt(glm::vec3(0.0f), light.dir, up);
+
+    // see: GPU Gems 3, Chapter 10 (Parallel-Split Shadow Maps)
+    const glm::mat4 mtx_bias = {
+        {0.5f, 0.0f, 0.0f, 0.0f},
+        {0.0f, 0.5f, 0.0f, 0.0f},
+        {0.0f, 0.0f, 0.5f, 0.0f},
+        {0.5f, 0.5f, 0.5f, 1.0f},
+    };
+
+    f32 split_near = clip_near;
+    for (u32 ii = 0; ii < this->cascade_count; ii++) {
+        f32 ratio         = (f32)(ii + 1) / (f32)this->cascade_count;
+        f32 split_log     = clip_near * glm::pow(clip_far / clip_near, ratio);
+        f32 split_uniform = clip_near + (clip_far - clip_near) * ratio;
+        f32 split_far     = glm::mix(split_uniform, split_log, SPLIT_LAMBDA);
+
+        // bounding sphere of the slice of the view frustum
+        glm::vec3 corners[8];
+        glm::vec3 center = glm::vec3(0.0f);
+        for (usize jj = 0; jj < 8; jj++) {
+            f32       depth  = (jj & 4) ? split_far : split_near;
+            glm::vec4 corner = {
+                ((jj & 1) ? 1.0f : -1.0f) * depth * slope_x,
+                ((jj & 2) ? 1.0f : -1.0f) * depth * slope_y,
+                -depth,
+                1.0f,
+            };
+            corners[jj] = glm::vec3(mtx_inv_view * corner);
+            center += corners[jj] / 8.0f;
+        }
+
+        f32 radius = 0.0f;
+        for (const auto& corner : corners) {
+            radius = glm::max(radius, glm::length(corner - center));
+        }
+
+        // quantize the radius so float noise doesn't change the texel size frame to frame
+        radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+        // snap the center to whole texels in light space
+        f32       texel     = 2.0f * radius / (f32)RESOLUTION;
+        glm::vec3 center_ls = glm::vec3(mtx_light_view * glm::vec4(center, 1.0f));
+        center_ls.x         = glm::floor(center_ls.x / texel) * texel;
+        center_ls.y         = glm::floor(center_ls.y / texel) * texel;
+
+        glm::mat4 mtx_light_proj = glm::ortho(
+            center_ls.x - radius,
+            center_ls.x + radius,
+            center_ls.y - radius,
+            center_ls.y + radius,
+            -center_ls.z - radius,
+            -center_ls.z + radius);
+
+        this->mtx_light_vp[ii] = mtx_light_proj * mtx_light_view;
+        this->mtx_shadow[ii]   = mtx_bias * this->mtx_light_vp[ii];
+        this->split_depths[ii] = split_far;
+        this->texel_sizes[ii]  = texel;
+
+        split_near = split_far;
+    }
+}
+
+void CascadedShadowMap::Render(
+    const SunLight&            light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    this->Fit(light, rs);
+
+    GLState.Apply(SHADOW_MAP_STATE);
+    this->fbo.Bind();
+    GL(glViewport(0, 0, RESOLUTION, RESOLUTION));
+    this->sp.UseProgram();
+
+    bool is_batched = MultiDrawBatch::IsSupported();
+
+    for (u32 ii = 0; ii < this->cascade_count; ii++) {
+        this->fbo.Attach(this->tex_depth, GL_DEPTH_ATTACHMENT, ii);
+        GL(glClear(GL_DEPTH_BUFFER_BIT));
+
+        // the sides of the cascade, the near plane doesn't cull since casters in front of it are
+        // clamped onto it
+        const glm::mat4& mtx_vp = this->mtx_light_vp[ii];
+        this->sp.SetUniform("g_mtx_vp", mtx_vp);
+        this->batch.Clear();
+
+        glm::vec4 row_x = {mtx_vp[0][0], mtx_vp[1][0], mtx_vp[2][0], mtx_vp[3][0]};
+        glm::vec4 row_y = {mtx_vp[0][1], mtx_vp[1][1], mtx_vp[2][1], mtx_vp[3][1]};
+        glm::vec4 row_z = {mtx_vp[0][2], mtx_vp[1][2], mtx_vp[2][2], mtx_vp[3][2]};
+        glm::vec4 row_w = {mtx_vp[0][3], mtx_vp[1][3], mtx_vp[2][3], mtx_vp[3][3]};
+
+        const glm::vec4 planes[5] = {
+            row_w + row_x, // left
+            row_w - row_x, // right
+            row_w + row_y, // bottom
+            row_w - row_y, // top
+            row_w - row_z, // far
+        };
+
+        for (const auto& obj : objs) {
+            if (!obj.CastsShadows()) {
+                continue;
+            }
+
+            glm::vec3 obj_min, obj_max;
+            ObjectBounds(obj, &obj_min, &obj_max);
+
+            bool is_outside = false;
+            for (const auto& plane : planes) {
+                if (IsOutsidePlane(plane, obj_min, obj_max)) {
+                    is_outside = true;
+                    break;
+                }
+            }
+
+            if (is_outside) {
+                continue;
+            }
+
+            if (is_batched) {
+                for (const auto& model : obj.models) {
+                    this->batch.Push(obj.WorldMatrix(), obj.NormalMatrix(), model);
+                }
+
+                continue;
+            }
+
+            this->sp.SetUniform("g_mtx_world", obj.WorldMatrix());
+            for (const auto& model : obj.models) {
+                model.geometry.DrawVisual(this->sp);
+            }
+        }
+
+        if (is_batched) {
+            this->batch.Upload();
+            this->batch.Draw();
+        }
+    }
+}
+
+void CascadedShadowMap::Use(ShaderProgram& sp) const
+{
+    this->tex_depth.Bind(GL_TEXTURE0 + TEXTURE_SLOT);
+
+    sp.SetUniform("g_cascade_count", this->cascade_count);
+    sp.SetUniform("g_cascade_splits", this->split_depths);
+    sp.SetUniform("g_cascade_texel_sizes", this->texel_sizes);
+
+    static constexpr UniformName mtx_names[SunLight::MAX_SHADOW_CASCADES] = {
+        "g_mtx_cascades[0]",
+        "g_mtx_cascades[1]",
+        "g_mtx_cascades[2]",
+        "g_mtx_cascades[3]",
+    };
+
+    for (u32 ii = 0; ii < this->cascade_count; ii++) {
+        sp.SetUniform(mtx_names[ii], this->mtx_shadow[ii]);
+    }
+}
+
+/* --- Renderer_SunLighting --- */
+Renderer_SunLighting::Renderer_SunLighting()
+{
+    // direct lighting
+    LOG_DEBUG("Compiling Sun Lighting Vertex Shader");
+    this->vs = CompileLightShader(GL_VERTEX_SHADER, LightType::Sun, Lighting_VS);
+
+    LOG_DEBUG("Compiling Sun Lighting Fragment Shader");
+    this->fs = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Sun, Lighting_FS);
+
+    LOG_DEBUG("Linking Sun Lighting Shaders");
+    this->sp_light = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Sun Lighting Shader Program = %u", this->sp_light.handle);
+
+    LOG_DEBUG("Initializing Sun Lighting Shader Program");
+    SetupMaterialSamplers(this->sp_light);
+
+    // shadow casting
+    LOG_DEBUG("Compiling Sun Lighting (Shadows) Vertex Shader");
+    this->vs_shadow = CompileShader(GL_VERTEX_SHADER, ShadowVolume_VS.src, ShadowVolume_VS.len);
+
+    LOG_DEBUG("Compiling Sun Lighting (Shadows) Geometry Shader");
+    this->gs_shadow = CompileLightShader(GL_GEOMETRY_SHADER, LightType::Sun, ShadowVolume_GS);
+
+    LOG_DEBUG("Compiling Sun Lighting (Shadows) Fragment Shader");
+    this->fs_shadow = CompileShader(GL_FRAGMENT_SHADER, ShadowVolume_FS.src, ShadowVolume_FS.len);
+
+    LOG_DEBUG("Linking Sun Lighting (Shadows) Shaders");
+    this->sp_shadow = LinkShaders(this->vs_shadow, this->gs_shadow, this->fs_shadow);
+    LOG_DEBUG("Sun Lighting (Shadows) Shader Program = %u", this->sp_shadow.handle);
+
+    this->shadow_compute = ShadowVolumeCompute(LightType::Sun);
+    this->shadow_map     = CascadedShadowMap(SunLight::MAX_SHADOW_CASCADES);
+    this->sp_light.SetUniform("g_shadow_cascades", CascadedShadowMap::TEXTURE_SLOT);
+}
+
+void Renderer_SunLighting::RenderShadowMap(
+    const SunLight&            light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    ASSERT(light.ShadowCascades() > 0);
+
+    this->shadow_map.Render(light, objs, rs);
+}
+
+void Renderer_SunLighting::RenderShadowVolumes(
+    const SunLight&            light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    SetupShadowLightingPass(LightType::Sun);
+    this->shadow_casters.Partition(objs, glm::vec4(-light.dir, 0.0f), rs);
+
+    for (bool is_z_fail : {false, true}) {
+        const auto& casters = is_z_fail ? this->shadow_casters.z_fail : this->shadow_casters.z_pass;
+        if (casters.empty()) {
+            continue;
+        }
+
+        GLState.Apply(ShadowVolumeState(is_z_fail));
+        if (settings.shadow_volume_mode == ShadowVolumeMode::ComputeShader) {
+            PROFILE_SCOPE("Shadow Volumes (CS)");
+            this->shadow_compute.sp_extrude.SetUniform("g_light_source.dir", light.dir);
+            this->shadow_compute.Render(
+                casters,
+                is_z_fail,
+                HashCombine(LightType::Sun, light.dir.x, light.dir.y, light.dir.z));
+        } else if (settings.shadow_volume_mode == ShadowVolumeMode::CPU) {
+            PROFILE_SCOPE("Shadow Volumes (CPU)");
+            this->shadow_silhouette.Render(casters, is_z_fail, glm::vec4(-light.dir, 0.0f), rs);
+        } else {
+            PROFILE_SCOPE("Shadow Volumes (GS)");
+            this->sp_shadow.UseProgram();
+            this->sp_shadow.SetUniform("g_emit_caps", is_z_fail);
+            this->sp_shadow.SetUniform("g_light_source.dir", light.dir);
+
+            for (const auto* obj : casters) {
+                this->sp_shadow.SetUniform("g_mtx_world", obj->WorldMatrix());
+                this->sp_shadow.SetUniform("g_mtx_normal", obj->NormalMatrix());
+                this->sp_shadow.SetUniform("g_mtx_wvp", obj->WVPMatrix());
+
+                obj->DrawShadow(this->sp_shadow);
+            }
+        }
+    }
+}
+
+void Renderer_SunLighting::Render(
+    const SunLight&            light,
+    const std::vector<Object>& objs,
+    const RenderState&         rs)
+{
+    bool uses_shadow_map = light.ShadowCascades() > 0;
+    if (!uses_shadow_map) {
+        this->RenderShadowVolumes(light, objs, rs);
+    }
+
+    // the stencil buffer still holds the volumes of the previous light when using a shadow map
+    PipelineState state = DirectLightingState(LightType::Sun);
+    state.stencil_test  = !uses_shadow_map;
+    GLState.Apply(state);
+    this->sp_light.UseProgram();
+    this->sp_light.SetUniform("g_light_source.dir", light.dir);
+    this->sp_light.SetUniform("g_light_source.color", light.color * light.intensity);
+
+    if (uses_shadow_map) {
+        this->shadow_map.Use(this->sp_light);
+    } else {
+        this->sp_light.SetUniform("g_cascade_count", 0u);
+    }
+
+    DrawVisuals(&this->queue, &this->batch, LightType::Sun, this->sp_light, objs, rs);
+}
+
+/* --- Renderer_ClusteredLighting --- */
+Renderer_ClusteredLighting::Renderer_ClusteredLighting()
+{
+    LOG_DEBUG("Compiling Clustered Lighting Vertex Shader");
+    this->vs = CompileLightShader(GL_VERTEX_SHADER, LightType::Clustered, Lighting_VS);
+
+    LOG_DEBUG("Compiling Clustered Lighting Fragment Shader");
+    this->fs = CompileLightShader(GL_FRAGMENT_SHADER, LightType::Clustered, Lighting_FS);
+
+    LOG_DEBUG("Linking Clustered Lighting Shaders");
+    this->sp_light = LinkShaders(this->vs, this->fs);
+    LOG_DEBUG("Clustered Lighting Shader Program = %u", this->sp_light.handle);
+
+    LOG_DEBUG("Initializing Clustered Lighting Shader Program");
+    SetupMaterialSamplers(this->sp_light);
+
+    LOG_DEBUG("Creating Clustered Lighting SSBOs");
+    this->ssbo_lights.Reserve();
+    this->ssbo_clusters.Reserve();
+    this->ssbo_indices.Reserve();
+
+    this->gpu_clusters.resize(CLUSTER_COUNT);
+    this->cluster_cursor.resize(CLUSTER_COUNT);
+}
+
+// Projects the view space interval [center - radius, center + radius] along one axis to NDC, given
+// that the bounded region lies between the depths depth_min and depth_max (both positive)
+static void ProjectClusterBounds(
+    f32  center,
+    f32  radius,
+    f32  proj_scale,
+    f32  depth_min,
+    f32  depth_max,
+    f32* ndc_min,
+    f32* ndc_max)
+{
+    f32 hi = center + radius;
+    f32 lo = center - radius;
+
+    // an extent projects furthest from the center of the screen when it is closest to the camera,
+    // extents on the opposite side of the view axis are bounded by the far depth instead
+    *ndc_max = proj_scale * hi / (hi > 0.0f ? depth_min : depth_max);
+    *ndc_min = proj_scale * lo / (lo < 0.0f ? depth_min : depth_max);
+}
+
+static u32 ClusterTileFromNDC(f32 ndc, u32 tile_count)
+{
+    f32 tile = glm::floor((ndc * 0.5f + 0.5f) * (f32)tile_count);
+    return (u32)glm::clamp(tile, 0.0f, (f32)(tile_count - 1));
+}
+
+// Calls fn(cluster_index) for every cluster overlapped by the light, the test is conservative since
+// it bounds the sphere with a box in each depth slice
+template<class F>
+static void ForEachLightCluster(const glm::vec3& pos_view, f32 radius, const glm::mat4& proj, F fn)
+{
+    constexpr u32 CLUSTER_X = Renderer_ClusteredLighting::CLUSTER_X;
+    constexpr u32 CLUSTER_Y = Renderer_ClusteredLighting::CLUSTER_Y;
+    constexpr u32 CLUSTER_Z = Renderer_ClusteredLighting::CLUSTER_Z;
+
+    constexpr f32 clip_near = Renderer::CLIP_NEAR;
+    constexpr f32 clip_far  = Renderer::CLIP_FAR;
+
+    // view space looks down -Z
+    f32 depth       = -pos_view.z;
+    f32 depth_front = glm::max(depth - radius, clip_near);
+    f32 depth_back  = glm::min(depth + radius, clip_far);
+
+    if (depth_front >= depth_back) {
+        return;
+    }
+
+    const f32 log_depth_range = glm::log(clip_far / clip_near);
+
+    const auto slice_from_depth = [&](f32 slice_depth) {
+        f32 slice = glm::floor(glm::log(slice_depth / clip_near) * CLUSTER_Z / log_depth_range);
+        return (u32)glm::clamp(slice, 0.0f, (f32)(CLUSTER_Z - 1));
+    };
+
+    const auto depth_from_slice = [&](u32 slice) {
+        return clip_near * glm::pow(clip_far / clip_near, (f32)slice / (f32)CLUSTER_Z);
+    };
+
+    u32 slice_front = slice_from_depth(depth_front);
+    u32 slice_back  = slice_from_depth(depth_back);
+
+    for (u32 zz = slice_front; zz <= slice_back; zz++) {
+        // restrict the bounds to the part of the sphere that lies in this slice
+        f32 slice_near = glm::max(depth_from_slice(zz), depth_front);
+        f32 slice_far  = glm::min(depth_from_slice(zz + 1), depth_back);
+
+        f32 ndc_x_min, ndc_x_max;
+        f32 ndc_y_min, ndc_y_max;
+        ProjectClusterBounds(
+            pos_view.x,
+            radius,
+            proj[0][0],
+            slice_near,
+            slice_far,
+            &ndc_x_min,
+            &ndc_x_max);
+        ProjectClusterBounds(
+            pos_view.y,
+            radius,
+            proj[1][1],
+            slice_near,
+            slice_far,
+            &ndc_y_min,
+            &ndc_y_max);
+
+        if (ndc_x_max < -1.0f || ndc_x_min > 1.0f || ndc_y_max < -1.0f || ndc_y_min > 1.0f) {
+            continue;
+        }
+
+        u32 tile_x_min = ClusterTileFromNDC(ndc_x_min, CLUSTER_X);
+        u32 tile_x_max = ClusterTileFromNDC(ndc_x_max, CLUSTER_X);
+        u32 tile_y_min = ClusterTileFromNDC(ndc_y_min, CLUSTER_Y);
+        u32 tile_y_max = ClusterTileFromNDC(ndc_y_max, CLUSTER_Y);
+
+        for (u32 yy = tile_y_min; yy <= tile_y_max; yy++) {
+            for (u32 xx = tile_x_min; xx <= tile_x_max; xx++) {
+                fn(xx + CLUSTER_X * (yy + CLUSTER_Y * zz));
+            }
+        }
+    }
+}
+
+usize Renderer_ClusteredLighting::BuildClusters(
+    const std::vector<PointLight>& lights,
+    const RenderState&             rs)
+{
+    PROFILE_FUNCTION();
+
+    this->gpu_lights.clear();
+    this->gpu_indices.clear();
+    for (auto& cluster : this->gpu_clusters) {
+        cluster = {0, 0};
+    }
+
+    // first pass counts the lights touching each cluster
+    for (const auto& light : lights) {
+        if (light.CastsShadows()) {
+            continue;
+        }
+
+        f32       radius   = light.Radius();
+        glm::vec3 pos_view = glm::vec3(rs.mtx_view * glm::vec4(light.pos, 1.0f));
+        bool      visible  = false;
+
+        ForEachLightCluster(pos_view, radius, rs.mtx_proj, [&](u32 cluster) {
+            this->gpu_clusters[cluster].count += 1;
+            visible = true;
+        });
+
+        if (visible) {
+            this->gpu_lights.push_back({
+                glm::vec4(light.pos, radius),
+                glm::vec4(light.color * light.intensity, 1.0f),
+            });
+        }
+    }
+
+    if (this->gpu_lights.empty()) {
+        return 0;
+    }
+
+    // prefix sum gives each cluster its range in the index list
+    u32 offset = 0;
+    for (usize ii = 0; ii < CLUSTER_COUNT; ii++) {
+        this->gpu_clusters[ii].offset = offset;
+        this->cluster_cursor[ii]      = offset;
+        offset += this->gpu_clusters[ii].count;
+    }
+
+    this->gpu_indices.resize(offset);
+
+    // second pass fills in the light indices, only visible lights made it into gpu_lights so their
+    // indices are recomputed in the same order as the first pass
+    u32 light_index = 0;
+    for (const auto& light : lights) {
+        if (light.CastsShadows()) {
+            continue;
+        }
+
+        glm::vec3 pos_view = glm::vec3(rs.mtx_view * glm::vec4(light.pos, 1.0f));
+        bool      visible  = false;
+
+        ForEachLightCluster(pos_view, light.Radius(), rs.mtx_proj, [&](u32 cluster) {
+            this->gpu_indices[this->cluster_cursor[cluster]++] = light_index;
+            visible                                            = true;
+        });
+
+        if (visible) {
+            light_index += 1;
+        }
+    }
+
+    this->ssbo_lights.LoadData(
+        this->gpu_lights.size() * sizeof(GPU_Light),
+        this->gpu_lights.data(),
+        GL_STREAM_DRAW);
+    this->ssbo_clusters.LoadData(
+        this->gpu_clusters.size() * sizeof(GPU_Cluster),
+        this->gpu_clusters.data(),
+        GL_STREAM_DRAW);
+    this->ssbo_indices.LoadData(
+        this->gpu_indices.size() * sizeof(u32),
+        this->gpu_indices.data(),
+        GL_STREAM_DRAW);
+
+    return this->gpu_lights.size();
+}
+
+void Renderer_ClusteredLighting::Render(
+    const std::vector<PointLight>& lights,
+    const std::vector<Object>&     objs,
+    const RenderState&             rs)
+{
+    if (this->BuildClusters(lights, rs) == 0) {
+        return;
+    }
+
+    // slice = log(depth) * scale - bias, see ForEachLightCluster
+    f32       log_depth_range = glm::log(Renderer::CLIP_FAR / Renderer::CLIP_NEAR);
+    glm::vec2 depth_params    = {
+        (f32)CLUSTER_Z / log_depth_range,
+        (f32)CLUSTER_Z * glm::log(Renderer::CLIP_NEAR) / log_depth_range,
+    };
+    glm::vec2 tile_size = rs.resolution / glm::vec2(CLUSTER_X, CLUSTER_Y);
+
+    GLState.Apply(DirectLightingState(LightType::Clustered));
+    this->sp_light.UseProgram();
+    this->sp_light.SetUniform("g_cluster_tile_size", tile_size);
+    this->sp_light.SetUniform("g_cluster_depth_params", depth_params);
+
+    this->ssbo_lights.BindSlot(1);
+    this->ssbo_clusters.BindSlot(2);
+    this->ssbo_indices.BindSlot(3);
+
+    DrawVisuals(&this->queue, &this->batch, LightType::Clustered, this->sp_light, objs, rs);
+}
+
+/* --- Renderer_Skybox --- */
 Renderer_Skybox::Renderer_Skybox()
 {
     LOG_DEBUG("Compiling Skybox Vertex Shader");
@@ -898,12 +2575,29 @@ Renderer_Skybox::Renderer_Skybox()
     this->sp.SetUniform("g_skybox", 0);
 }
 
+// drawn at the far plane behind the lit geometry
+static constexpr PipelineState SKYBOX_STATE = {
+    // depth
+    .depth_test  = true,
+    .depth_clamp = false,
+    .depth_write = true,
+    .depth_func  = GL_LEQUAL,
+
+    // culling
+    .cull_face  = true,
+    .cull_mode  = GL_BACK,
+    .front_face = GL_CCW,
+
+    // pixel buffer
+    .blend = false,
+
+    // stencil buffer
+    .stencil_test = false,
+};
+
 void Renderer_Skybox::Render(const Skybox& sky, const RenderState& rs)
 {
-    // TODO: be more explicit
-    GL(glDisable(GL_BLEND));
-    GL(glDisable(GL_STENCIL_TEST));
-    GL(glDepthFunc(GL_LEQUAL));
+    GLState.Apply(SKYBOX_STATE);
 
     glm::mat4 vp_fixed = rs.mtx_proj * glm::mat4(glm::mat3(rs.mtx_view));
 
@@ -932,6 +2626,29 @@ Renderer_SphericalBillboard::Renderer_SphericalBillboard()
     this->sp.SetUniform("g_sprite", 0);
 }
 
+// additive sprites, tested against but not written to the depth buffer
+static constexpr PipelineState BILLBOARD_STATE = {
+    // depth
+    .depth_test  = true,
+    .depth_clamp = false,
+    .depth_write = false,
+    .depth_func  = GL_LESS,
+
+    // culling
+    .cull_face  = true,
+    .cull_mode  = GL_BACK,
+    .front_face = GL_CCW,
+
+    // pixel buffer
+    .blend     = true,
+    .blend_eq  = GL_FUNC_ADD,
+    .blend_src = GL_SRC_ALPHA,
+    .blend_dst = GL_ONE,
+
+    // stencil buffer
+    .stencil_test = false,
+};
+
 // TODO: cleanup naming, should be something like SphericalBillboard3D
 // fixed size regardless of distance should be SphericalBillboard2D, etc.
 // TODO: some sprites may be emissive (light flares), others may not be (smoke), needs better
@@ -940,18 +2657,7 @@ void Renderer_SphericalBillboard::Render(
     const std::vector<Sprite3D>& sprites,
     const RenderState&           rs)
 {
-    // TODO: be more explicit
-    GL(glEnable(GL_BLEND));
-    GL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
-    GL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
-
-    GL(glEnable(GL_CULL_FACE));
-
-    GL(glEnable(GL_DEPTH_TEST));
-    GL(glDepthMask(GL_FALSE));
-    GL(glDepthFunc(GL_LESS));
-
-    GL(glDisable(GL_STENCIL_TEST));
+    GLState.Apply(BILLBOARD_STATE);
 
     this->sp.UseProgram();
     for (const auto& sprite : sprites) {
@@ -963,245 +2669,523 @@ void Renderer_SphericalBillboard::Render(
 
         sprite.Draw(this->sp);
     }
-
-    // TODO: this shouldn't be required, other passes should be explicit about the depth mask
-    GL(glDepthMask(GL_TRUE));
 }
 
 /* --- Renderer_Bloom --- */
 Renderer_Bloom::Renderer_Bloom()
 {
-    LOG_DEBUG("Compiling Bloom Vertex Shader");
-    this->vs = CompileShader(GL_VERTEX_SHADER, Bloom_VS.src, Bloom_VS.len);
+    LOG_DEBUG("Compiling Bloom Downsample Compute Shader");
+    this->cs_downsample = CompileIncludingShader(GL_COMPUTE_SHADER, BloomDownsample_CS);
+
+    LOG_DEBUG("Linking Bloom Downsample Shader");
+    this->sp_downsample = LinkShaders(this->cs_downsample);
+    LOG_DEBUG("Bloom Downsample Shader Program = %u", this->sp_downsample.handle);
+
+    LOG_DEBUG("Initializing Bloom Downsample Shader Program");
+    this->sp_downsample.SetUniform("g_tex_input", 0);
+
+    LOG_DEBUG("Compiling Bloom Upsample Compute Shader");
+    this->cs_upsample = CompileIncludingShader(GL_COMPUTE_SHADER, BloomUpsample_CS);
 
-    LOG_DEBUG("Compiling Bloom Upscale Fragment Shader");
-    this->fs_upscale
-        = CompileShader(GL_FRAGMENT_SHADER, BloomUpsample_FS.src, BloomUpsample_FS.len);
+    LOG_DEBUG("Linking Bloom Upsample Shader");
+    this->sp_upsample = LinkShaders(this->cs_upsample);
+    LOG_DEBUG("Bloom Upsample Shader Program = %u", this->sp_upsample.handle);
 
-    LOG_DEBUG("Linking Bloom Upscale Shaders");
-    this->sp_upscale = LinkShaders(this->vs, this->fs_upscale);
-    LOG_DEBUG("Bloom Upscale Shader Program = %u", this->sp_upscale.handle);
+    LOG_DEBUG("Initializing Bloom Upsample Shader Program");
+    this->sp_upsample.SetUniform("g_tex_chain", 0);
+    this->sp_upsample.SetUniform("g_radius", BLOOM_RADIUS);
+}
 
-    LOG_DEBUG("Initializng Bloom Upscale Shader Program");
-    this->sp_upscale.SetUniform("g_tex_input", 0);
-    this->sp_upscale.SetUniform("g_radius", BLOOM_RADIUS);
+void Renderer_Bloom::Render(
+    const FrameGraph& graph,
+    u32               src_hdr,
+    u32               chain,
+    f32               radius,
+    glm::vec2         render_scale)
+{
+    const FrameGraph::TextureDesc& input     = graph.Desc(src_hdr);
+    const FrameGraph::TextureDesc& mips      = graph.Desc(chain);
+    const TextureRT&               tex_chain = graph.Texture(chain);
 
-    LOG_DEBUG("Compiling Bloom Downscale Fragment Shader");
-    this->fs_downscale
-        = CompileShader(GL_FRAGMENT_SHADER, BloomDownsample_FS.src, BloomDownsample_FS.len);
+    glm::vec2 texel_size = 1.0f / glm::vec2(input.width, input.height);
 
-    LOG_DEBUG("Linking Bloom Downscale Shaders");
-    this->sp_downscale = LinkShaders(this->vs, this->fs_downscale);
-    LOG_DEBUG("Bloom Downscale Shader Program = %u", this->sp_downscale.handle);
+    // downsample chain, every mip is written as an image in a single dispatch
+    this->sp_downsample.UseProgram();
+    this->sp_downsample.SetUniform("g_texel_size", texel_size);
+    this->sp_downsample.SetUniform("g_uv_scale", render_scale);
+    this->sp_downsample.SetUniform("g_uv_max", render_scale - 0.5f * texel_size);
 
-    LOG_DEBUG("Initializing Bloom Downscale Shader Program");
-    this->sp_downscale.SetUniform("g_tex_input", 0);
-    this->sp_downscale.SetUniform("g_resolution", glm::vec2(0, 0));
+    graph.Texture(src_hdr).Bind(GL_TEXTURE0);
+    for (GLint mip = 0; mip < BLOOM_MIP_CHAIN_LEN; mip++) {
+        tex_chain.BindImage(mip, mip, GL_WRITE_ONLY, mips.format);
+    }
 
-    LOG_DEBUG("Compiling Bloom Final Fragment Shader");
-    this->fs_final = CompileShader(GL_FRAGMENT_SHADER, BloomFinal_FS.src, BloomFinal_FS.len);
+    GL(glDispatchCompute(
+        (mips.width + DOWNSAMPLE_TILE_SIZE - 1) / DOWNSAMPLE_TILE_SIZE,
+        (mips.height + DOWNSAMPLE_TILE_SIZE - 1) / DOWNSAMPLE_TILE_SIZE,
+        1));
 
-    LOG_DEBUG("Linking Bloom Final Shaders");
-    this->sp_final = LinkShaders(this->vs, this->fs_final);
-    LOG_DEBUG("Bloom Final Shader Program = %u", this->sp_final.handle);
+    // upsample chain, each mip from the second up accumulates the ones below it, the first is
+    // left to the post pass
+    this->sp_upsample.UseProgram();
+    this->sp_upsample.SetUniform("g_radius", radius);
 
-    LOG_DEBUG("Initializing Bloom Final Shader Program");
-    this->sp_final.SetUniform("g_tex_hdr", 0);
-    this->sp_final.SetUniform("g_tex_bloom", 1);
-    this->sp_final.SetUniform("g_bloom_strength", 0.04f);
+    tex_chain.Bind(GL_TEXTURE0);
 
-    LOG_DEBUG("Creating Bloom FBO");
-    this->fbo.Reserve();
+    for (GLint mip = BLOOM_MIP_CHAIN_LEN - 1; mip > 1; mip--) {
+        // the last dispatch wrote the mip that's sampled now
+        GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT));
+
+        GLsizei width  = glm::max(mips.width >> (mip - 1), 1);
+        GLsizei height = glm::max(mips.height >> (mip - 1), 1);
+
+        tex_chain.BindImage(0, mip - 1, GL_READ_WRITE, mips.format);
+        this->sp_upsample.SetUniform("g_src_mip", mip);
+
+        GL(glDispatchCompute(
+            (width + UPSAMPLE_GROUP_SIZE - 1) / UPSAMPLE_GROUP_SIZE,
+            (height + UPSAMPLE_GROUP_SIZE - 1) / UPSAMPLE_GROUP_SIZE,
+            1));
+    }
+
+    // the post pass samples the chain
+    GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
 }
 
-void Renderer_Bloom::SetResolution(f32 width, f32 height)
+/* --- Renderer_PostFX --- */
+ShaderProgram& Renderer_PostFX::Program(const PostParams& params)
 {
-    this->input_res = {width, height};
-    glm::vec2 res   = {width, height};
-    for (usize ii = 0; ii < BLOOM_MIP_CHAIN_LEN; ii++) {
-        if (this->mips_setup) {
-            this->mips[ii].tex.Delete();
-        }
+    bool is_bloom   = params.bloom_chain != FrameGraph::NONE;
+    bool is_sharpen = params.sharpen_strength != 0.0f;
+
+    u32 permutation = (u32)is_bloom | (u32)is_sharpen << 1 | params.tonemapper << 2;
 
-        res *= 0.5f;
-        this->mips[ii].tex.Reserve();
-        this->mips[ii].tex.Setup(GL_R11F_G11F_B10F, (GLsizei)res.x, (GLsizei)res.y);
-        this->mips[ii].res = res;
+    auto iter = this->programs.find(permutation);
+    if (iter != this->programs.end()) {
+        return iter->second;
     }
 
-    this->fbo.Attach(this->mips[0].tex, GL_COLOR_ATTACHMENT0);
-    this->fbo.CheckComplete();
+    const ShaderDefine defines[] = {
+        {"BLOOM", is_bloom},
+        {"SHARPEN", is_sharpen},
+        {"TONEMAPPER", (i32)params.tonemapper},
+    };
+
+    LOG_DEBUG("Compiling PostFX Compute Shader (permutation %u)", permutation);
+    std::string source = PreprocessShader(SHADER_VERSION, defines, PostFX_CS, ShaderIncludes);
+    Shader      cs     = CompileShader(GL_COMPUTE_SHADER, source.data(), (i32)source.size());
+
+    LOG_DEBUG("Linking PostFX Shader");
+    ShaderProgram sp = LinkShaders(cs);
+    LOG_DEBUG("PostFX Shader Program = %u", sp.handle);
 
-    this->mips_setup = true;
+    LOG_DEBUG("Initializing PostFX Shader Program");
+    sp.SetUniform("g_tex_hdr", 0);
+    if (is_bloom) {
+        sp.SetUniform("g_tex_bloom", 1);
+    }
+
+    return this->programs.emplace(permutation, sp).first->second;
 }
 
-void Renderer_Bloom::Render(const TextureRT& src_hdr, const FBO& dst_hdr, f32 radius, f32 strength)
+void Renderer_PostFX::Render(
+    const FrameGraph& graph,
+    u32               src_hdr,
+    u32               dst_ldr,
+    const PostParams& params)
 {
-    GL(glDisable(GL_DEPTH_TEST));
+    const FrameGraph::TextureDesc& input  = graph.Desc(src_hdr);
+    const FrameGraph::TextureDesc& output = graph.Desc(dst_ldr);
 
-    GL(glEnable(GL_BLEND));
-    GL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE));
-    GL(glBlendFunc(GL_ONE, GL_ZERO));
-    GL(glBlendEquation(GL_FUNC_ADD));
+    glm::vec2 src_texel_size = 1.0f / glm::vec2(input.width, input.height);
 
-    GL(glDisable(GL_STENCIL_TEST));
+    ShaderProgram& sp = this->Program(params);
+    sp.UseProgram();
+    sp.SetUniform("g_texel_size", 1.0f / glm::vec2(output.width, output.height));
+    sp.SetUniform("g_gamma", params.gamma);
+    sp.SetUniform("g_uv_scale", params.render_scale);
+    sp.SetUniform("g_uv_max", params.render_scale - 0.5f * src_texel_size);
 
-    // src_hdr is the input texture for first iteration of downsample
-    src_hdr.Bind(GL_TEXTURE0);
+    graph.Texture(src_hdr).Bind(GL_TEXTURE0);
 
-    // internal FBO is the output target until the final upscale stage
-    this->fbo.Bind();
+    if (params.bloom_chain != FrameGraph::NONE) {
+        sp.SetUniform("g_bloom_strength", params.bloom_strength);
+        sp.SetUniform("g_bloom_radius", params.bloom_radius);
+        graph.Texture(params.bloom_chain).Bind(GL_TEXTURE1);
+    }
+
+    if (params.sharpen_strength != 0.0f) {
+        sp.SetUniform("g_sharpen_strength", params.sharpen_strength);
+    }
+
+    graph.Texture(dst_ldr).BindImage(0, 0, GL_WRITE_ONLY, LDR_FORMAT);
+
+    GL(glDispatchCompute(
+        (output.width + GROUP_SIZE - 1) / GROUP_SIZE,
+        (output.height + GROUP_SIZE - 1) / GROUP_SIZE,
+        1));
+
+    // the result is blitted to the backbuffer
+    GL(glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT));
+}
+
+/* --- Renderer_SMAA --- */
+// integral of the parts of a line from (a, height_a) to (b, height_b) above and below zero
+static glm::vec2 SplitArea(f32 a, f32 height_a, f32 b, f32 height_b)
+{
+    if (height_a >= 0.0f && height_b >= 0.0f) {
+        return glm::vec2(0.5f * (height_a + height_b) * (b - a), 0.0f);
+    }
+
+    if (height_a <= 0.0f && height_b <= 0.0f) {
+        return glm::vec2(0.0f, -0.5f * (height_a + height_b) * (b - a));
+    }
+
+    // crosses zero in between, one triangle on either side
+    f32 cross = a + (b - a) * height_a / (height_a - height_b);
+    f32 first = 0.5f * height_a * (cross - a);
+    f32 last  = 0.5f * height_b * (b - cross);
+
+    return height_a > 0.0f ? glm::vec2(first, -last) : glm::vec2(last, -first);
+}
+
+// area between an edge and its revectorized silhouette over the texel at dist_start from the start
+// of the edge, the silhouette runs from the height of the crossing edge at either end to zero at
+// the middle of the edge
+static glm::vec2 EdgeArea(f32 height_start, f32 height_end, i32 dist_start, i32 dist_end)
+{
+    f32 middle = 0.5f * (f32)(dist_start + dist_end + 1);
 
-    this->sp_downscale.UseProgram();
-    this->sp_downscale.SetUniform("g_resolution", this->input_res);
-    this->sp_downscale.SetUniform("g_mip", 0);
+    auto height = [&](f32 x) {
+        if (x <= middle) {
+            return height_start * (1.0f - x / middle);
+        }
 
-    // downsample passes
-    for (isize ii = 0; ii < BLOOM_MIP_CHAIN_LEN; ii++) {
-        // color attachment is the mip target, clear it before rendering to it
-        GL(glViewport(0, 0, (GLsizei)this->mips[ii].res.x, (GLsizei)this->mips[ii].res.y));
-        this->fbo.Attach(this->mips[ii].tex, GL_COLOR_ATTACHMENT0);
-        GL(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
-        GL(glClear(GL_COLOR_BUFFER_BIT));
+        return height_end * (x / middle - 1.0f);
+    };
 
-        this->quad.Draw();
+    f32 x0 = (f32)dist_start;
+    f32 x1 = x0 + 1.0f;
 
-        // for next iter
-        // input res is this stage's res
-        this->sp_downscale.SetUniform("g_resolution", this->mips[ii].res);
-        this->sp_downscale.SetUniform("g_mip", (int)(ii + 1));
-        // input texture is this stage's tex
-        this->mips[ii].tex.Bind(GL_TEXTURE0);
+    if (x0 < middle && middle < x1) {
+        return SplitArea(x0, height(x0), middle, 0.0f) + SplitArea(middle, 0.0f, x1, height(x1));
     }
 
-    // now we upsample and additively blend backwards
-    GL(glBlendFunc(GL_ONE, GL_ONE));
+    return SplitArea(x0, height(x0), x1, height(x1));
+}
+
+Renderer_SMAA::Renderer_SMAA()
+{
+    LOG_DEBUG("Compiling SMAA Edges Compute Shader");
+    this->cs_edges = CompileIncludingShader(GL_COMPUTE_SHADER, SMAAEdges_CS);
+
+    LOG_DEBUG("Linking SMAA Edges Shader");
+    this->sp_edges = LinkShaders(this->cs_edges);
+    LOG_DEBUG("SMAA Edges Shader Program = %u", this->sp_edges.handle);
+
+    LOG_DEBUG("Initializing SMAA Edges Shader Program");
+    this->sp_edges.SetUniform("g_tex_input", 0);
 
-    this->sp_upscale.UseProgram();
-    this->sp_upscale.SetUniform("g_radius", radius);
+    LOG_DEBUG("Compiling SMAA Weights Compute Shader");
+    this->cs_weights = CompileIncludingShader(GL_COMPUTE_SHADER, SMAAWeights_CS);
 
-    // upsample passes
-    for (isize ii = BLOOM_MIP_CHAIN_LEN - 1; ii > 0; ii--) {
-        this->mips[ii].tex.Bind(GL_TEXTURE0);
-        GL(glViewport(0, 0, (GLsizei)this->mips[ii - 1].res.x, (GLsizei)this->mips[ii - 1].res.y));
-        this->fbo.Attach(this->mips[ii - 1].tex, GL_COLOR_ATTACHMENT0);
+    LOG_DEBUG("Linking SMAA Weights Shader");
+    this->sp_weights = LinkShaders(this->cs_weights);
+    LOG_DEBUG("SMAA Weights Shader Program = %u", this->sp_weights.handle);
 
-        this->quad.Draw();
+    LOG_DEBUG("Initializing SMAA Weights Shader Program");
+    this->sp_weights.SetUniform("g_tex_edges", 0);
+    this->sp_weights.SetUniform("g_tex_area", 1);
+
+    LOG_DEBUG("Compiling SMAA Blend Compute Shader");
+    this->cs_blend = CompileIncludingShader(GL_COMPUTE_SHADER, SMAABlend_CS);
+
+    LOG_DEBUG("Linking SMAA Blend Shader");
+    this->sp_blend = LinkShaders(this->cs_blend);
+    LOG_DEBUG("SMAA Blend Shader Program = %u", this->sp_blend.handle);
+
+    LOG_DEBUG("Initializing SMAA Blend Shader Program");
+    this->sp_blend.SetUniform("g_tex_input", 0);
+    this->sp_blend.SetUniform("g_tex_weights", 1);
+
+    // the areas only depend on the pattern and the distances to the ends, a tile of distances for
+    // every pair of patterns, where a pattern is the side of the crossing edge at an end
+    std::vector<glm::vec2> areas(AREA_SIZE * AREA_SIZE);
+    for (i32 pattern_end = 0; pattern_end < 3; pattern_end++) {
+        for (i32 pattern_start = 0; pattern_start < 3; pattern_start++) {
+            f32 height_start = 0.5f * (f32)(pattern_start - 1);
+            f32 height_end   = 0.5f * (f32)(pattern_end - 1);
+
+            for (i32 dist_end = 0; dist_end < MAX_DISTANCE; dist_end++) {
+                for (i32 dist_start = 0; dist_start < MAX_DISTANCE; dist_start++) {
+                    i32 x = pattern_start * MAX_DISTANCE + dist_start;
+                    i32 y = pattern_end * MAX_DISTANCE + dist_end;
+
+                    areas[y * AREA_SIZE + x]
+                        = EdgeArea(height_start, height_end, dist_start, dist_end);
+                }
+            }
+        }
     }
 
-    // final pass takes the highest res mip and mixes it with the input image and writes to the
-    // output FBO
-    GL(glBlendFunc(GL_ONE, GL_ZERO));
+    this->tex_area.Reserve();
+    this->tex_area.Setup(AREA_FORMAT, AREA_SIZE, AREA_SIZE);
+    GL(glTextureSubImage2D(
+        this->tex_area.handle,
+        0,
+        0,
+        0,
+        AREA_SIZE,
+        AREA_SIZE,
+        GL_RG,
+        GL_FLOAT,
+        areas.data()));
+}
+
+void Renderer_SMAA::Render(
+    const FrameGraph& graph,
+    u32               src_ldr,
+    u32               edges,
+    u32               weights,
+    u32               dst_ldr)
+{
+    const FrameGraph::TextureDesc& output = graph.Desc(dst_ldr);
+
+    GLuint groups_x = (output.width + GROUP_SIZE - 1) / GROUP_SIZE;
+    GLuint groups_y = (output.height + GROUP_SIZE - 1) / GROUP_SIZE;
+
+    // the input was written as an image by the post pass
+    GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+
+    this->sp_edges.UseProgram();
+    graph.Texture(src_ldr).Bind(GL_TEXTURE0);
+    graph.Texture(edges).BindImage(0, 0, GL_WRITE_ONLY, EDGES_FORMAT);
+    GL(glDispatchCompute(groups_x, groups_y, 1));
 
-    GL(glViewport(0, 0, (GLsizei)this->input_res.x, (GLsizei)this->input_res.y));
-    src_hdr.Bind(GL_TEXTURE0);
+    GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
 
-    this->mips[0].tex.Bind(GL_TEXTURE1);
+    this->sp_weights.UseProgram();
+    graph.Texture(edges).Bind(GL_TEXTURE0);
+    this->tex_area.Bind(GL_TEXTURE1);
+    graph.Texture(weights).BindImage(0, 0, GL_WRITE_ONLY, WEIGHTS_FORMAT);
+    GL(glDispatchCompute(groups_x, groups_y, 1));
 
-    this->sp_final.UseProgram();
-    this->sp_final.SetUniform("g_bloom_strength", strength);
+    GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
 
-    dst_hdr.Bind();
+    this->sp_blend.UseProgram();
+    graph.Texture(src_ldr).Bind(GL_TEXTURE0);
+    graph.Texture(weights).Bind(GL_TEXTURE1);
+    graph.Texture(dst_ldr).BindImage(0, 0, GL_WRITE_ONLY, Renderer_PostFX::LDR_FORMAT);
+    GL(glDispatchCompute(groups_x, groups_y, 1));
 
-    this->quad.Draw();
+    // the result is blitted to the backbuffer
+    GL(glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT));
 }
 
-/* --- Renderer_PostFX --- */
-Renderer_PostFX::Renderer_PostFX()
+/* --- Renderer_TAA --- */
+Renderer_TAA::Renderer_TAA()
 {
-    LOG_DEBUG("Compiling PostFX Vertex Shader");
-    this->vs = CompileShader(GL_VERTEX_SHADER, PostFX_VS.src, PostFX_VS.len);
+    LOG_DEBUG("Compiling TAA Motion Compute Shader");
+    this->cs_motion = CompileIncludingShader(GL_COMPUTE_SHADER, TAAMotion_CS);
+
+    LOG_DEBUG("Linking TAA Motion Shader");
+    this->sp_motion = LinkShaders(this->cs_motion);
+    LOG_DEBUG("TAA Motion Shader Program = %u", this->sp_motion.handle);
 
-    // Sharpening
-    LOG_DEBUG("Compiling PostFX Sharpen Fragment Shader");
-    this->fs_sharpen
-        = CompileShader(GL_FRAGMENT_SHADER, PostFX_Sharpen_FS.src, PostFX_Sharpen_FS.len);
+    LOG_DEBUG("Initializing TAA Motion Shader Program");
+    this->sp_motion.SetUniform("g_tex_depth", 0);
 
-    LOG_DEBUG("Linking PostFX Sharpen Shaders");
-    this->sp_sharpen = LinkShaders(this->vs, this->fs_sharpen);
-    LOG_DEBUG("PostFX Sharpen Shader Program = %u", this->sp_sharpen.handle);
+    LOG_DEBUG("Compiling TAA Resolve Compute Shader");
+    this->cs_resolve = CompileIncludingShader(GL_COMPUTE_SHADER, TAA_CS);
 
-    LOG_DEBUG("Initializing PostFX Sharpen Shader Program");
-    this->sp_sharpen.SetUniform("g_screen", 0);
+    LOG_DEBUG("Linking TAA Resolve Shader");
+    this->sp_resolve = LinkShaders(this->cs_resolve);
+    LOG_DEBUG("TAA Resolve Shader Program = %u", this->sp_resolve.handle);
 
-    // Gamma correction
-    LOG_DEBUG("Compiling PostFX Gamma Fragment Shader");
-    this->fs_gamma = CompileShader(GL_FRAGMENT_SHADER, PostFX_Gamma_FS.src, PostFX_Gamma_FS.len);
+    LOG_DEBUG("Initializing TAA Resolve Shader Program");
+    this->sp_resolve.SetUniform("g_tex_color", 0);
+    this->sp_resolve.SetUniform("g_tex_depth", 1);
+    this->sp_resolve.SetUniform("g_tex_motion", 2);
+    this->sp_resolve.SetUniform("g_tex_history", 3);
+}
 
-    LOG_DEBUG("Linking PostFX Gamma Shaders");
-    this->sp_gamma = LinkShaders(this->vs, this->fs_gamma);
-    LOG_DEBUG("PostFX Gamma Shader Program = %u", this->sp_gamma.handle);
+// radical inverse of index in base, the points of consecutive indices are spread evenly over [0, 1)
+static f32 Halton(u64 index, u64 base)
+{
+    f32 result   = 0.0f;
+    f32 fraction = 1.0f;
 
-    LOG_DEBUG("Initializing PostFX Gamma Shader Program");
-    this->sp_gamma.SetUniform("g_screen", 0);
+    while (index > 0) {
+        fraction /= (f32)base;
+        result += fraction * (f32)(index % base);
+        index /= base;
+    }
 
-    // Tonemapping
-    LOG_DEBUG("Compiling PostFX Tonemap Fragment Shader");
-    this->fs_tonemap
-        = CompileShader(GL_FRAGMENT_SHADER, PostFX_Tonemap_FS.src, PostFX_Tonemap_FS.len);
+    return result;
+}
 
-    LOG_DEBUG("Linking PostFX Tonemapping Shaders");
-    this->sp_tonemap = LinkShaders(this->vs, this->fs_tonemap);
-    LOG_DEBUG("PostFX Tonemapping Program = %u", this->sp_tonemap.handle);
+glm::mat4 Renderer_TAA::NextFrame(
+    const glm::mat4& mtx_proj,
+    const glm::mat4& mtx_view,
+    glm::vec2        resolution,
+    glm::vec2        render_resolution)
+{
+    // the history is only reallocated on resizes, which also invalidate it
+    if (resolution != glm::vec2(this->history_width, this->history_height)) {
+        this->history_width  = (GLsizei)resolution.x;
+        this->history_height = (GLsizei)resolution.y;
 
-    LOG_DEBUG("Initializing PostFX Shader Program");
-    this->sp_tonemap.SetUniform("g_screen", 0);
+        for (auto& tex : this->history) {
+            if (tex.handle != 0) {
+                tex.Delete();
+            }
+
+            tex.Reserve();
+            tex.Setup(HISTORY_FORMAT, this->history_width, this->history_height);
+        }
+
+        this->is_history_valid = false;
+    }
+
+    this->history_index ^= 1;
+
+    // the first point of the sequence is the origin, which isn't offset at all
+    u64 index    = this->phase % JITTER_PHASES + 1;
+    this->jitter = glm::vec2(Halton(index, 2), Halton(index, 3)) - 0.5f;
+    this->phase += 1;
+
+    // shifts what's rendered by the jitter in texels, applied after the projection so it's in NDC
+    glm::vec2 offset       = 2.0f * this->jitter / render_resolution;
+    glm::mat4 mtx_jitter   = glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f));
+    glm::mat4 mtx_jittered = mtx_jitter * mtx_proj;
+
+    this->mtx_prev_vp         = this->mtx_vp;
+    this->mtx_vp              = mtx_proj * mtx_view;
+    this->mtx_inv_jittered_vp = glm::inverse(mtx_jittered * mtx_view);
+
+    return mtx_jittered;
+}
+
+void Renderer_TAA::RenderMotion(
+    const FrameGraph& graph,
+    u32               depth,
+    u32               motion,
+    glm::vec2         render_size)
+{
+    this->sp_motion.UseProgram();
+    this->sp_motion.SetUniform("g_render_size", render_size);
+    this->sp_motion.SetUniform("g_mtx_inv_vp", this->mtx_inv_jittered_vp);
+    this->sp_motion.SetUniform("g_mtx_vp", this->mtx_vp);
+    this->sp_motion.SetUniform("g_mtx_prev_vp", this->mtx_prev_vp);
+
+    graph.Texture(depth).Bind(GL_TEXTURE0);
+    graph.Texture(motion).BindImage(0, 0, GL_WRITE_ONLY, MOTION_FORMAT);
+
+    GLsizei width  = (GLsizei)render_size.x;
+    GLsizei height = (GLsizei)render_size.y;
+
+    GL(glDispatchCompute(
+        (width + GROUP_SIZE - 1) / GROUP_SIZE,
+        (height + GROUP_SIZE - 1) / GROUP_SIZE,
+        1));
+
+    // the resolve samples the motion vectors
+    GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
 }
 
-void Renderer_PostFX::RenderTonemap(const TextureRT& src, const FBO& dst, GLuint tonemapper)
+void Renderer_TAA::Render(
+    const FrameGraph& graph,
+    u32               color,
+    u32               depth,
+    u32               motion,
+    u32               history,
+    u32               dst,
+    glm::vec2         render_size)
 {
-    dst.Bind();
+    const FrameGraph::TextureDesc& source = graph.Desc(color);
+    const FrameGraph::TextureDesc& output = graph.Desc(dst);
 
-    GL(glDisable(GL_DEPTH_TEST));
-    GL(glDisable(GL_BLEND));
-    GL(glDisable(GL_STENCIL_TEST));
-    GL(glClear(GL_COLOR_BUFFER_BIT));
+    f32 history_weight = this->is_history_valid ? HISTORY_WEIGHT : 0.0f;
 
-    this->sp_tonemap.UseProgram();
-    this->sp_tonemap.SetUniform("g_tonemapper", tonemapper);
+    this->sp_resolve.UseProgram();
+    this->sp_resolve.SetUniform("g_render_size", render_size);
+    this->sp_resolve.SetUniform("g_source_size", glm::vec2(source.width, source.height));
+    this->sp_resolve.SetUniform("g_output_size", glm::vec2(output.width, output.height));
+    this->sp_resolve.SetUniform("g_jitter", this->jitter);
+    this->sp_resolve.SetUniform("g_history_weight", history_weight);
 
-    src.Bind(GL_TEXTURE0);
-    this->quad.Draw();
+    graph.Texture(color).Bind(GL_TEXTURE0);
+    graph.Texture(depth).Bind(GL_TEXTURE1);
+    graph.Texture(motion).Bind(GL_TEXTURE2);
+    graph.Texture(history).Bind(GL_TEXTURE3);
+    graph.Texture(dst).BindImage(0, 0, GL_WRITE_ONLY, HISTORY_FORMAT);
+
+    GL(glDispatchCompute(
+        (output.width + GROUP_SIZE - 1) / GROUP_SIZE,
+        (output.height + GROUP_SIZE - 1) / GROUP_SIZE,
+        1));
+
+    // the passes after this sample the output, and the next frame samples it as the history
+    GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+
+    this->is_history_valid = true;
+}
+
+/* --- DynamicResolution --- */
+DynamicResolution::DynamicResolution()
+{
+    for (usize ii = 0; ii < FRAMES_IN_FLIGHT; ii++) {
+        this->start[ii].Reserve();
+        this->end[ii].Reserve();
+    }
 }
 
-void Renderer_PostFX::RenderSharpen(
-    const TextureRT& src,
-    const FBO&       dst,
-    glm::vec2        screen_resolution,
-    f32              strength)
+f32 DynamicResolution::Update()
 {
-    dst.Bind();
+    // the slot that's about to be reused holds the oldest frame
+    usize slot = this->frame % FRAMES_IN_FLIGHT;
+    if (!this->is_recorded[slot] || !this->end[slot].IsAvailable()) {
+        return this->scale;
+    }
 
-    GL(glDisable(GL_DEPTH_TEST));
-    GL(glDisable(GL_BLEND));
-    GL(glDisable(GL_STENCIL_TEST));
-    GL(glClear(GL_COLOR_BUFFER_BIT));
+    u64 elapsed = this->end[slot].RetrieveValue() - this->start[slot].RetrieveValue();
+    this->gpu_ms = glm::max((f32)elapsed / 1000000.0f, 0.01f);
 
-    this->sp_sharpen.UseProgram();
-    this->sp_sharpen.SetUniform("g_resolution", screen_resolution);
-    this->sp_sharpen.SetUniform("g_strength", strength);
+    // the cost of a frame is mostly fill, which follows the pixel count, the square of the scale
+    f32 budget = settings.frame_budget_ms;
+    f32 target = this->frame_scale[slot] * glm::sqrt(budget / this->gpu_ms);
 
-    src.Bind(GL_TEXTURE0);
-    this->quad.Draw();
+    this->scale = glm::mix(this->scale, target, SMOOTHING);
+    this->scale = glm::clamp(this->scale, settings.min_render_scale, 1.0f);
+
+    return this->scale;
 }
 
-void Renderer_PostFX::RenderGammaCorrect(const TextureRT& src, const FBO& dst, f32 gamma)
+void DynamicResolution::BeginFrame()
 {
-    dst.Bind();
+    usize slot = this->frame % FRAMES_IN_FLIGHT;
 
-    GL(glDisable(GL_DEPTH_TEST));
-    GL(glDisable(GL_BLEND));
-    GL(glDisable(GL_STENCIL_TEST));
-    GL(glClear(GL_COLOR_BUFFER_BIT));
+    this->start[slot].RecordTimestamp();
+    this->frame_scale[slot] = this->scale;
+    this->is_recorded[slot] = false;
+}
 
-    this->sp_gamma.UseProgram();
-    this->sp_gamma.SetUniform("g_gamma", gamma);
+void DynamicResolution::EndFrame()
+{
+    usize slot = this->frame % FRAMES_IN_FLIGHT;
 
-    src.Bind(GL_TEXTURE0);
-    this->quad.Draw();
+    this->end[slot].RecordTimestamp();
+    this->is_recorded[slot] = true;
+    this->frame += 1;
 }
 
 /* --- Renderer --- */
+// TAA and single sample rendering draw to textures, which are sampled instead of resolved
+static bool IsSingleSampled()
+{
+    return settings.temporal_aa || settings.msaa_samples <= 1;
+}
+
 static void RenderInit(void)
 {
     TexturePool.LoadStatic(DefaultTexture_Diffuse, Texture2D(glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)));
@@ -1233,59 +3217,34 @@ Renderer::Renderer(bool opengl_logging)
     // exterior render initialization
     RenderInit();
 
-    // setup internal render target for MSAA
-    this->msaa.fbo.Reserve();
-    this->msaa.depth_stencil.Reserve();
-    this->msaa.color.Reserve();
-
-    this->msaa.depth_stencil.CreateStorage(
-        GL_DEPTH24_STENCIL8,
-        settings.msaa_samples,
-        this->res_width,
-        this->res_height);
-    this->msaa.color
-        .CreateStorage(GL_R11F_G11F_B10F, settings.msaa_samples, this->res_width, this->res_height);
-
-    this->msaa.fbo.Attach(this->msaa.depth_stencil, GL_DEPTH_STENCIL_ATTACHMENT);
-    this->msaa.fbo.Attach(this->msaa.color, GL_COLOR_ATTACHMENT0);
-    this->msaa.fbo.CheckComplete();
-
-    // setup internal render target for postprocessing
-    for (usize ii = 0; ii < lengthof(this->post); ii++) {
-        this->post[ii].fbo.Reserve();
-        this->post[ii].depth_stencil.Reserve();
-
-        this->post[ii].color.Reserve();
-        this->post[ii]
-            .depth_stencil.CreateStorage(GL_DEPTH24_STENCIL8, 1, this->res_width, this->res_height);
-        this->post[ii].color.Setup(GL_R11F_G11F_B10F, this->res_width, this->res_height);
-
-        this->post[ii].fbo.Attach(this->post[ii].depth_stencil, GL_DEPTH_STENCIL_ATTACHMENT);
-        this->post[ii].fbo.Attach(this->post[ii].color, GL_COLOR_ATTACHMENT0);
-        this->post[ii].fbo.CheckComplete();
+    // setup internal render target, MSAA or the single sample one
+    if (IsSingleSampled()) {
+        this->scene.fbo.Reserve();
+    } else {
+        this->msaa.fbo.Reserve();
+        this->msaa.depth_stencil.Reserve();
+        this->msaa.color.Reserve();
     }
 
+    this->CreateSceneTarget();
+
     // setup the shared UBO
     this->shared_data.Reserve(sizeof(SharedData));
     this->shared_data.BindSlot(0);
-
-    // initial bloom setup
-    this->rp_bloom.SetResolution(this->res_width, this->res_height);
 }
 
-Renderer::Simple_RT& Renderer::GetRenderSource()
+void Renderer::RenderShadowedLight(const PointLight& light, const std::vector<Object>& objs)
 {
-    return this->post[(this->post_target + 1) % lengthof(post)];
-}
+    bool uses_shadow_map = false;
+    if (light.ShadowMapped()) {
+        PROFILE_SCOPE("Shadow Map");
+        uses_shadow_map = this->rp_point_lighting.RenderShadowMap(light, objs, this->rs);
 
-Renderer::Simple_RT& Renderer::GetRenderTarget()
-{
-    return this->post[this->post_target];
-}
+        this->SceneTarget().Bind();
+        GL(glViewport(0, 0, this->render_width, this->render_height));
+    }
 
-void Renderer::AdvanceRenderTarget()
-{
-    this->post_target = (this->post_target + 1) % lengthof(post);
+    this->rp_point_lighting.Render(light, objs, this->rs, uses_shadow_map);
 }
 
 Renderer& Renderer::Resolution(u32 width, u32 height)
@@ -1297,23 +3256,55 @@ Renderer& Renderer::Resolution(u32 width, u32 height)
     this->res_width  = width;
     this->res_height = height;
 
-    this->msaa.depth_stencil.CreateStorage(
-        GL_DEPTH24_STENCIL8,
-        settings.msaa_samples,
-        this->res_width,
-        this->res_height);
-    this->msaa.color.CreateStorage(GL_R11F_G11F_B10F, settings.msaa_samples, width, height);
+    this->CreateSceneTarget();
+
+    // the post processing targets follow the resolution on their own, see FrameGraph::Compile
+    // and the viewport follows the render scale, see StartRender
+
+    return *this;
+}
+
+void Renderer::CreateSceneTarget()
+{
+    GLsizei width  = (GLsizei)this->res_width;
+    GLsizei height = (GLsizei)this->res_height;
+
+    if (!IsSingleSampled()) {
+        this->msaa.depth_stencil
+            .CreateStorage(GL_DEPTH24_STENCIL8, settings.msaa_samples, width, height);
+        this->msaa.color.CreateStorage(HDR_FORMAT, settings.msaa_samples, width, height);
+
+        this->msaa.fbo.Attach(this->msaa.depth_stencil, GL_DEPTH_STENCIL_ATTACHMENT);
+        this->msaa.fbo.Attach(this->msaa.color, GL_COLOR_ATTACHMENT0);
+        this->msaa.fbo.CheckComplete();
+        return;
+    }
 
-    for (usize ii = 0; ii < lengthof(this->post); ii++) {
-        this->post[ii].depth_stencil.CreateStorage(GL_DEPTH24_STENCIL8, 1, width, height);
-        this->post[ii].color.Setup(GL_R11F_G11F_B10F, width, height);
+    // texture storage is immutable, so resizes allocate new textures
+    if (this->scene.color.handle != 0) {
+        this->scene.depth_stencil.Delete();
+        this->scene.color.Delete();
     }
 
-    this->rp_bloom.SetResolution(width, height);
+    this->scene.depth_stencil.Reserve();
+    this->scene.depth_stencil.Setup(GL_DEPTH24_STENCIL8, width, height);
+    this->scene.color.Reserve();
+    this->scene.color.Setup(HDR_FORMAT, width, height);
 
-    GL(glViewport(0, 0, width, height));
+    this->scene.fbo.Attach(this->scene.depth_stencil, GL_DEPTH_STENCIL_ATTACHMENT);
+    this->scene.fbo.Attach(this->scene.color, GL_COLOR_ATTACHMENT0);
+    this->scene.fbo.CheckComplete();
+}
 
-    return *this;
+const FBO& Renderer::SceneTarget() const
+{
+    return IsSingleSampled() ? this->scene.fbo : this->msaa.fbo;
+}
+
+glm::vec2 Renderer::RenderScale() const
+{
+    return glm::vec2(this->render_width, this->render_height)
+           / glm::vec2(this->res_width, this->res_height);
 }
 
 Renderer& Renderer::FOV(f32 new_fov)
@@ -1340,15 +3331,57 @@ Renderer& Renderer::ClearColor(f32 red, f32 green, f32 blue)
     return *this;
 }
 
+Renderer& Renderer::OutputTarget(const FBO& fbo)
+{
+    this->output = fbo;
+    return *this;
+}
+
 void Renderer::StartRender()
 {
     PROFILE_FUNCTION();
 
+    // readbacks from earlier frames that have landed by now
+    Readback.Poll();
+
+    // the scale is picked before anything is drawn, the frame then keeps it throughout
+    f32 scale = 1.0f;
+    if (settings.dynamic_resolution) {
+        scale = this->dynamic_resolution.Update();
+        this->dynamic_resolution.BeginFrame();
+    }
+
+    this->render_width  = glm::max((u32)glm::round(this->res_width * scale), 1u);
+    this->render_height = glm::max((u32)glm::round(this->res_height * scale), 1u);
+    this->rs.resolution = glm::vec2(this->render_width, this->render_height);
+
     // cache the VP matrix for this render pass
     f32       aspect   = (f32)res_width / (f32)res_height;
     glm::mat4 mtx_proj = glm::perspective(glm::radians(this->fov), aspect, CLIP_NEAR, CLIP_FAR);
-    this->rs.mtx_proj  = mtx_proj;
-    this->rs.mtx_vp    = mtx_proj * this->rs.mtx_view;
+
+    if (settings.temporal_aa) {
+        mtx_proj = this->rp_taa.NextFrame(
+            mtx_proj,
+            this->rs.mtx_view,
+            glm::vec2(this->res_width, this->res_height),
+            this->rs.resolution);
+    }
+
+    this->rs.mtx_proj = mtx_proj;
+    this->rs.mtx_vp   = mtx_proj * this->rs.mtx_view;
+
+    this->rs.frame += 1;
+    GLState.ResetCounters();
+    this->graph.Reset();
+    this->post = {};
+
+    // every pass reads the transforms built here
+    TransformPool.Update(this->rs.mtx_vp);
+
+    ShadowVolumeCompute::NextFrame();
+    this->rp_point_lighting.shadow_maps.NextFrame();
+    MaterialPool.Upload();
+    GeometryPool.Upload();
 
     // Update UBO for VP matrix and View Position
     SharedData tmp = {
@@ -1359,8 +3392,15 @@ void Renderer::StartRender()
     };
     this->shared_data.SubData(0, sizeof(SharedData), &tmp);
 
-    // bind the internal frame target and clear the screen
-    this->msaa.fbo.Bind();
+    // bind the internal frame target and clear the screen, clears are subject to the write masks
+    PipelineState clear_state = GLState.pipeline;
+    clear_state.depth_write   = true;
+    clear_state.color_write   = true;
+    clear_state.alpha_write   = true;
+    GLState.Apply(clear_state);
+
+    this->SceneTarget().Bind();
+    GL(glViewport(0, 0, this->render_width, this->render_height));
     GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
 }
 
@@ -1375,7 +3415,7 @@ void Renderer::RenderObjectLighting(const AmbientLight& light, const std::vector
 void Renderer::RenderObjectLighting(const PointLight& light, const std::vector<Object>& objs)
 {
     PROFILE_FUNCTION();
-    this->rp_point_lighting.Render(light, objs, this->rs);
+    this->RenderShadowedLight(light, objs);
 }
 
 void Renderer::RenderObjectLighting(const SpotLight& light, const std::vector<Object>& objs)
@@ -1387,9 +3427,33 @@ void Renderer::RenderObjectLighting(const SpotLight& light, const std::vector<Ob
 void Renderer::RenderObjectLighting(const SunLight& light, const std::vector<Object>& objs)
 {
     PROFILE_FUNCTION();
+
+    if (light.ShadowCascades() > 0) {
+        PROFILE_SCOPE("Shadow Map");
+        this->rp_sun_lighting.RenderShadowMap(light, objs, this->rs);
+
+        this->SceneTarget().Bind();
+        GL(glViewport(0, 0, this->render_width, this->render_height));
+    }
+
     this->rp_sun_lighting.Render(light, objs, this->rs);
 }
 
+void Renderer::RenderObjectLighting(
+    const std::vector<PointLight>& lights,
+    const std::vector<Object>&     objs)
+{
+    PROFILE_FUNCTION();
+
+    for (const auto& light : lights) {
+        if (light.CastsShadows()) {
+            this->RenderShadowedLight(light, objs);
+        }
+    }
+
+    this->rp_clustered_lighting.Render(lights, objs, this->rs);
+}
+
 void Renderer::RenderSkybox(const Skybox& sky)
 {
     PROFILE_FUNCTION();
@@ -1407,56 +3471,144 @@ void Renderer::FinishGeometry()
 {
     PROFILE_FUNCTION();
 
-    // blit the MSAA FBO to the single sample FBO
-    GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, this->msaa.fbo.handle));
-    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->GetRenderTarget().fbo.handle));
-    GL(glBlitFramebuffer(
-        0,
-        0,
-        this->res_width,
-        this->res_height,
-        0,
-        0,
-        this->res_width,
-        this->res_height,
-        GL_COLOR_BUFFER_BIT,
-        GL_NEAREST));
+    FrameGraph::TextureDesc hdr = {
+        .format = HDR_FORMAT,
+        .width  = (GLsizei)this->res_width,
+        .height = (GLsizei)this->res_height,
+    };
 
-    this->AdvanceRenderTarget();
+    if (settings.temporal_aa) {
+        this->ResolveTemporal(hdr);
+    } else if (IsSingleSampled()) {
+        // nothing to resolve, the scene target is read as is
+        this->scene_color = this->graph.Import(
+            "Scene Color",
+            hdr,
+            this->scene.color,
+            this->scene.fbo,
+            {GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT});
+        this->scene_scale = this->RenderScale();
+    } else {
+        this->ResolveMSAA(hdr);
+    }
 }
 
-void Renderer::RenderBloom(f32 radius, f32 strength)
+void Renderer::ResolveMSAA(const FrameGraph::TextureDesc& hdr)
 {
-    PROFILE_FUNCTION();
+    // nothing reads the MSAA target after it's resolved
+    u32 msaa_color = this->graph.Import(
+        "MSAA",
+        hdr,
+        TextureRT(),
+        this->msaa.fbo,
+        {GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT});
+    u32 resolved = this->graph.Create("Resolved HDR", hdr);
+
+    // only the rendered corner is resolved, it stays in the corner until the post pass upscales it
+    GLint width  = (GLint)this->render_width;
+    GLint height = (GLint)this->render_height;
 
-    Simple_RT& src = this->GetRenderSource();
-    Simple_RT& dst = this->GetRenderTarget();
-    this->rp_bloom.Render(src.color, dst.fbo, radius, strength);
+    this->graph.AddPass("Resolve", {msaa_color}, {resolved}, [=](const FrameGraph& graph) {
+        // blit the MSAA FBO to the single sample FBO
+        GL(glBlitNamedFramebuffer(
+            graph.Target(msaa_color).handle,
+            graph.Target(resolved).handle,
+            0,
+            0,
+            width,
+            height,
+            0,
+            0,
+            width,
+            height,
+            GL_COLOR_BUFFER_BIT,
+            GL_NEAREST));
+    });
 
-    this->AdvanceRenderTarget();
+    this->scene_color = resolved;
+    this->scene_scale = this->RenderScale();
 }
 
-void Renderer::RenderTonemap(GLuint tonemapper)
+// the jittered frame is accumulated into the TAA history, which holds the frame at the full
+// resolution from then on
+void Renderer::ResolveTemporal(const FrameGraph::TextureDesc& hdr)
 {
-    PROFILE_FUNCTION();
+    const Renderer_TAA& taa = this->rp_taa;
+
+    FrameGraph::TextureDesc depth_desc   = hdr;
+    depth_desc.format                    = GL_DEPTH24_STENCIL8;
+    FrameGraph::TextureDesc motion_desc  = hdr;
+    motion_desc.format                   = Renderer_TAA::MOTION_FORMAT;
+    FrameGraph::TextureDesc history_desc = hdr;
+    history_desc.format                  = Renderer_TAA::HISTORY_FORMAT;
+
+    // nothing reads the scene target after the TAA pass
+    u32 color = this->graph.Import(
+        "Scene Color",
+        hdr,
+        this->scene.color,
+        this->scene.fbo,
+        {GL_COLOR_ATTACHMENT0, GL_DEPTH_STENCIL_ATTACHMENT});
+    u32 depth = this->graph.Import("Scene Depth", depth_desc, this->scene.depth_stencil, FBO());
 
-    Simple_RT& src = this->GetRenderSource();
-    Simple_RT& dst = this->GetRenderTarget();
-    this->rp_postfx.RenderTonemap(src.color, dst.fbo, tonemapper);
+    // the history outlives the frame, so it's owned by the TAA pass rather than the graph
+    TextureRT history_tex = taa.history[taa.history_index ^ 1];
+    TextureRT output_tex  = taa.history[taa.history_index];
 
-    this->AdvanceRenderTarget();
+    u32 history = this->graph.Import("TAA History", history_desc, history_tex, FBO());
+    u32 output  = this->graph.Import("TAA Output", history_desc, output_tex, FBO());
+    u32 motion  = this->graph.Create("Motion Vectors", motion_desc);
+
+    glm::vec2 render_size = this->rs.resolution;
+
+    this->graph.AddPass("Motion Vectors", {depth}, {motion}, [=, this](const FrameGraph& graph) {
+        this->rp_taa.RenderMotion(graph, depth, motion, render_size);
+    });
+
+    this->graph.AddPass(
+        "TAA",
+        {color, depth, motion, history},
+        {output},
+        [=, this](const FrameGraph& graph) {
+            this->rp_taa.Render(graph, color, depth, motion, history, output, render_size);
+        });
+
+    this->scene_color = output;
+    this->scene_scale = glm::vec2(1.0f);
 }
 
-void Renderer::RenderSharpening(f32 strength)
+void Renderer::RenderBloom(f32 radius, f32 strength)
 {
-    PROFILE_FUNCTION();
+    u32 src = this->scene_color;
+
+    // the chain only lives until the post pass, so its texture is free for the rest of the frame
+    FrameGraph::TextureDesc chain_desc = this->graph.Desc(src);
+    chain_desc.width                   = glm::max(chain_desc.width / 2, 1);
+    chain_desc.height                  = glm::max(chain_desc.height / 2, 1);
+    chain_desc.levels                  = Renderer_Bloom::BLOOM_MIP_CHAIN_LEN;
+    chain_desc.format                  = HDR_FORMAT;
 
-    Simple_RT& src = this->GetRenderSource();
-    Simple_RT& dst = this->GetRenderTarget();
-    this->rp_postfx
-        .RenderSharpen(src.color, dst.fbo, {this->res_width, this->res_height}, strength);
+    u32       chain        = this->graph.Create("Bloom Chain", chain_desc);
+    glm::vec2 render_scale = this->scene_scale;
 
-    this->AdvanceRenderTarget();
+    this->graph.AddPass("Bloom", {src}, {chain}, [=, this](const FrameGraph& graph) {
+        this->rp_bloom.Render(graph, src, chain, radius, render_scale);
+    });
+
+    // composited by the post pass
+    this->post.bloom_chain    = chain;
+    this->post.bloom_radius   = radius;
+    this->post.bloom_strength = strength;
+}
+
+void Renderer::RenderTonemap(GLuint tonemapper)
+{
+    this->post.tonemapper = tonemapper;
+}
+
+void Renderer::RenderSharpening(f32 strength)
+{
+    this->post.sharpen_strength = strength;
 }
 
 // TODO: should gamma be a parameter to this function, or part of the renderer's state?
@@ -1464,7 +3616,77 @@ void Renderer::FinishRender(f32 gamma)
 {
     PROFILE_FUNCTION();
 
-    FBO        default_fbo = FBO();
-    Simple_RT& src         = this->GetRenderSource();
-    this->rp_postfx.RenderGammaCorrect(src.color, default_fbo, gamma);
+    u32 src = this->scene_color;
+
+    FrameGraph::TextureDesc ldr_desc = this->graph.Desc(src);
+    ldr_desc.format                  = Renderer_PostFX::LDR_FORMAT;
+
+    u32 ldr    = this->graph.Create("Post LDR", ldr_desc);
+    u32 output = this->graph.Import("Output", ldr_desc, TextureRT(), this->output);
+
+    Renderer_PostFX::PostParams post = this->post;
+    post.gamma                       = gamma;
+    post.render_scale                = this->scene_scale;
+
+    // sharpening brings back some of the detail lost to the upscale
+    bool is_upscaled = this->render_width < this->res_width;
+    if (is_upscaled && post.sharpen_strength == 0.0f) {
+        post.sharpen_strength = UPSCALE_SHARPEN_STRENGTH;
+    }
+
+    std::vector<u32> reads = {src};
+    if (post.bloom_chain != FrameGraph::NONE) {
+        reads.push_back(post.bloom_chain);
+    }
+
+    this->graph.AddPass("Post", reads, {ldr}, [=, this](const FrameGraph& graph) {
+        this->rp_postfx.Render(graph, src, ldr, post);
+    });
+
+    u32 present = ldr;
+    if (settings.smaa) {
+        FrameGraph::TextureDesc edges_desc   = ldr_desc;
+        edges_desc.format                    = Renderer_SMAA::EDGES_FORMAT;
+        FrameGraph::TextureDesc weights_desc = ldr_desc;
+        weights_desc.format                  = Renderer_SMAA::WEIGHTS_FORMAT;
+
+        u32 edges   = this->graph.Create("SMAA Edges", edges_desc);
+        u32 weights = this->graph.Create("SMAA Weights", weights_desc);
+        u32 aa      = this->graph.Create("SMAA LDR", ldr_desc);
+
+        this->graph.AddPass(
+            "SMAA",
+            {ldr},
+            {edges, weights, aa},
+            [=, this](const FrameGraph& graph) {
+                this->rp_smaa.Render(graph, ldr, edges, weights, aa);
+            });
+
+        present = aa;
+    }
+
+    // compute can't write to the default framebuffer
+    this->graph.AddPass("Present", {present}, {output}, [=](const FrameGraph& graph) {
+        GL(glBlitNamedFramebuffer(
+            graph.Target(present).handle,
+            graph.Target(output).handle,
+            0,
+            0,
+            ldr_desc.width,
+            ldr_desc.height,
+            0,
+            0,
+            ldr_desc.width,
+            ldr_desc.height,
+            GL_COLOR_BUFFER_BIT,
+            GL_NEAREST));
+    });
+    this->graph.Output(output);
+
+    this->graph.Compile();
+    this->graph.Execute();
+
+    if (settings.dynamic_resolution) {
+        this->dynamic_resolution.EndFrame();
+    }
 }
@@ -3,11 +3,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <unordered_map>
 #include <vector>
 
 #include "common.hpp"
 #include "gfx/assets.hpp"
+#include "gfx/framegraph.hpp"
 #include "gfx/opengl.hpp"
+#include "gfx/queue.hpp"
 
 struct AmbientLight {
     glm::vec3 color;
@@ -24,9 +27,12 @@ struct AmbientLight {
 };
 
 struct SunLight {
+    static constexpr u32 MAX_SHADOW_CASCADES = 4;
+
     glm::vec3 dir; // must be pre-normalized
     glm::vec3 color;
     f32       intensity;
+    u32       shadow_cascades = 0; // 0 uses shadow volumes, otherwise cascaded shadow maps
 
     SunLight(
         const glm::vec3& dir       = glm::vec3(0.0f, -1.0f, 0.0f),
@@ -42,6 +48,10 @@ struct SunLight {
 
     SunLight& Intensity(f32 intensity);
     f32       Intensity() const;
+
+    // 2 to MAX_SHADOW_CASCADES, or 0 to go back to shadow volumes
+    SunLight& ShadowCascades(u32 count);
+    u32       ShadowCascades() const;
 };
 
 struct SpotLight {
@@ -84,14 +94,21 @@ struct SpotLight {
 };
 
 struct PointLight {
+    // radiance below which a point light is considered to have no influence, used to bound the
+    // light for clustering
+    static constexpr f32 INFLUENCE_CUTOFF = 0.05f;
+
     glm::vec3 pos;
     glm::vec3 color;
     f32       intensity;
+    bool      casts_shadows = true;
+    bool      shadow_mapped = false; // cube shadow map instead of shadow volumes
 
     PointLight(
-        const glm::vec3& pos       = glm::vec3(0.0f, 0.0f, 0.0f),
-        const glm::vec3& color     = glm::vec3(1.0f, 1.0f, 1.0f),
-        f32              intensity = 1.0f);
+        const glm::vec3& pos           = glm::vec3(0.0f, 0.0f, 0.0f),
+        const glm::vec3& color         = glm::vec3(1.0f, 1.0f, 1.0f),
+        f32              intensity     = 1.0f,
+        bool             casts_shadows = true);
 
     PointLight& Position(const glm::vec3& pos);
     PointLight& Position(f32 x, f32 y, f32 z);
@@ -103,13 +120,22 @@ struct PointLight {
 
     PointLight& Intensity(f32 intensity);
     f32         Intensity() const;
+
+    PointLight& CastsShadows(bool casts_shadows);
+    bool        CastsShadows() const;
+
+    PointLight& ShadowMapped(bool shadow_mapped);
+    bool        ShadowMapped() const;
+
+    f32 Radius() const;
 };
 
 enum class LightType {
     Ambient,
     Point,
     Spot,
-    Sun
+    Sun,
+    Clustered, // unshadowed point lights, evaluated through the cluster grid
 };
 
 struct TargetCamera {
@@ -143,15 +169,6 @@ struct Skybox {
     void Draw() const;
 };
 
-struct FullscreenQuad {
-    static VAO  vao;
-    static VBO  vbo;
-    static bool is_vao_initialized;
-
-    FullscreenQuad();
-    void Draw() const;
-};
-
 // pack of data for render passes to use
 struct RenderState {
     glm::mat4 mtx_vp;   // VP matrix         (world -> screen)
@@ -159,13 +176,191 @@ struct RenderState {
     glm::mat4 mtx_proj; // Projection matrix (view -> screen)
 
     glm::vec3 pos_view; // View position (in world space)
+
+    glm::vec2 resolution; // Render target resolution (in pixels)
+
+    u64 frame = 0; // incremented by every StartRender
 };
 
-// TODO: it's kind of dumb to compile some of the shaders multiple times since they don't change
-// maybe we can use an asset cache to store compiled shaders
-struct Renderer_AmbientLighting {
+// Shadow casters of one light, split by how their volumes have to be rendered into the stencil
+// buffer, if a caster's volume can't reach the near plane of the camera the cheaper depth pass
+// (z-pass) technique is exact and the volume doesn't need caps, the rest use depth fail (z-fail)
+// with caps, both can be mixed since they count the same volumes wherever z-pass is exact
+struct ShadowCasters {
+    std::vector<const Object*> z_pass, z_fail;
+
+    // light is (pos, 1) for positional lights and (-dir, 0) for directional lights
+    void Partition(const std::vector<Object>& objs, const glm::vec4& light, const RenderState& rs);
+};
+
+// Compute based alternative to the shadow volume geometry shader, silhouette edges and caps of
+// every shadow caster are extruded into one buffer which is then drawn with a single indirect draw
+// Volumes are built in world space, so when neither the light nor the casters change they are
+// kept in a cache and replayed with a plain draw instead of being extruded again
+struct ShadowVolumeCompute {
+    // NOTE: must match ShadowVolume_CS
+    static constexpr u32 WORKGROUP_SIZE = 64;
+    // 3 silhouette quads (6 vertices each) and 2 caps (3 vertices each)
+    static constexpr u32 MAX_VERTICES_PER_TRIANGLE = 24;
+    // evicted cache buffers kept around for reuse
+    static constexpr usize MAX_FREE_VOLUMES = 16;
+
+    // NOTE: must match the layout of the command in ShadowVolume_CS
+    struct DrawArraysIndirectCommand {
+        u32 count;
+        u32 instance_count;
+        u32 first;
+        u32 base_instance;
+    };
+
+    struct CachedVolume {
+        SSBO    ssbo;
+        usize   capacity;        // in vertices
+        GLsizei count;           // in vertices
+        u64     last_used_frame;
+    };
+
+    Shader        cs, vs, fs;
+    ShaderProgram sp_extrude, sp_draw;
+
+    // only one volume is extruded at a time so the buffers are shared between light types
+    static SSBO  ssbo_volume;
+    static DIB   dib_volume;
+    static VAO   vao_volume;
+    static usize volume_capacity; // in vertices
+    static bool  is_buffer_initialized;
+
+    // keyed by the light and shadow caster state, see Render
+    static std::unordered_map<size_t, CachedVolume> volume_cache;
+    static std::vector<CachedVolume>                 volume_free_list;
+    static std::vector<size_t>                       volume_seen, volume_seen_prev;
+    static u64                                       frame;
+
+    ShadowVolumeCompute() = default;
+    ShadowVolumeCompute(LightType type);
+
+    // the light source uniforms must be set on sp_extrude before calling this, light_hash must
+    // change whenever those uniforms do
+    void Render(const std::vector<const Object*>& casters, bool is_capped, size_t light_hash);
+
+    // evicts volumes that weren't used during the last frame
+    static void NextFrame();
+
+    void Extrude(const std::vector<const Object*>& casters, bool is_capped, usize triangle_count);
+    void Draw(const SSBO& ssbo, GLsizei count);
+    void DrawIndirect();
+};
+
+// CPU alternative to the shadow volume geometry shader, silhouettes are classified against the
+// light on the worker threads and the vertex shader extrudes them from compact record lists
+// Casters whose volumes can't reach the view are skipped entirely
+struct ShadowVolumeSilhouette {
+    // NOTE: must be a multiple of SilhouetteMesh::LANES
+    static constexpr usize CHUNK_SIZE = 4096;
+    // NOTE: must match ShadowVolumeSilhouette_VS
+    static constexpr GLsizei VERTICES_PER_RECORD = 6;
+
+    // a chunk of edges or faces of one mesh, classified on a worker thread
+    struct Job {
+        const SilhouetteMesh* mesh;
+        glm::vec4             light; // in the mesh's local space
+        usize                 begin, end;
+        bool                  is_face;
+        std::vector<u32>      records;
+    };
+
+    struct Draw {
+        const Geometry* geometry;
+        glm::mat4       mtx_world;
+        usize           job_begin, job_end;
+        GLuint          edge_offset, face_offset;
+        GLsizei         edge_count, face_count;
+    };
+
     Shader        vs, fs;
-    ShaderProgram sp_light;
+    ShaderProgram sp;
+
+    SSBO ssbo_records;
+
+    // scratch space, kept around to avoid reallocating every frame
+    std::vector<Job>  jobs;
+    std::vector<Draw> draws;
+    std::vector<u32>  records;
+
+    ShadowVolumeSilhouette();
+
+    // light is (pos, 1) for positional lights and (-dir, 0) for directional lights
+    void Render(
+        const std::vector<const Object*>& casters,
+        bool                              is_capped,
+        const glm::vec4&                  light,
+        const RenderState&                rs);
+};
+
+// Shadow map alternative to shadow volumes for point lights, maps live in a fixed budget of cube
+// map array slots split into resolution tiers, the tier is picked from the light's screen coverage
+// A map is only rendered when its light is new or moved, or when a caster within the light's
+// radius changed, otherwise it's reused as is, least recently used maps are evicted when a tier is
+// full
+struct CubeShadowMapCache {
+    static constexpr usize   TIER_COUNT                  = 3;
+    static constexpr GLsizei TIER_RESOLUTION[TIER_COUNT] = {512, 256, 128};
+    static constexpr GLsizei TIER_SLOTS[TIER_COUNT]      = {4, 8, 16};
+    static constexpr f32     CLIP_NEAR                   = 0.05f;
+    // NOTE: must match Lighting_FS
+    static constexpr GLint TEXTURE_SLOT = 4;
+
+    struct Slot {
+        size_t light_key;   // 0 if the slot is free
+        size_t caster_hash; // casters within the light's radius when the map was rendered
+        u64    last_used_frame;
+    };
+
+    struct Tier {
+        TextureShadowCubeArray tex_depth;
+        std::vector<Slot>      slots;
+    };
+
+    struct Location {
+        usize tier;
+        usize slot;
+    };
+
+    Shader         vs, fs;
+    ShaderProgram  sp;
+    FBO            fbo;
+    MultiDrawBatch batch;
+
+    Tier                                 tiers[TIER_COUNT];
+    std::unordered_map<size_t, Location> locations; // keyed by light
+
+    Location current = {}; // map of the light passed to the last successful Render
+    u64      frame   = 0;
+
+    // scratch space, kept around to avoid reallocating every frame
+    std::vector<const Object*> casters;
+
+    CubeShadowMapCache();
+
+    // finds (or renders) the light's map, returns false if the budget is exhausted, may change the
+    // bound FBO and the viewport
+    bool Render(const PointLight& light, const std::vector<Object>& objs, const RenderState& rs);
+    // binds the map found by the last Render and sets the sampling uniforms of Lighting_FS
+    void Use(ShaderProgram& sp, const PointLight& light) const;
+
+    // maps not used this frame become eligible for eviction
+    void NextFrame();
+
+    usize SelectTier(const PointLight& light, const RenderState& rs) const;
+    bool  Allocate(usize tier, size_t light_key, Location* location);
+    void  RenderFaces(const PointLight& light, const Location& location);
+};
+
+struct Renderer_AmbientLighting {
+    Shader         vs, fs;
+    ShaderProgram  sp_light;
+    RenderQueue    queue;
+    MultiDrawBatch batch;
 
     Renderer_AmbientLighting();
 
@@ -177,9 +372,30 @@ struct Renderer_PointLighting {
     Shader        vs_shadow, gs_shadow, fs_shadow;
     ShaderProgram sp_light, sp_shadow;
 
+    ShadowVolumeCompute    shadow_compute;
+    ShadowVolumeSilhouette shadow_silhouette;
+    ShadowCasters          shadow_casters;
+    CubeShadowMapCache     shadow_maps;
+    RenderQueue            queue;
+    MultiDrawBatch         batch;
+
     Renderer_PointLighting();
 
-    void Render(const PointLight& light, const std::vector<Object>& objs, const RenderState& rs);
+    // only for lights using shadow maps, must be called before Render, returns false if the light
+    // has to fall back to shadow volumes, changes the bound FBO and the viewport
+    bool RenderShadowMap(
+        const PointLight&          light,
+        const std::vector<Object>& objs,
+        const RenderState&         rs);
+    void RenderShadowVolumes(
+        const PointLight&          light,
+        const std::vector<Object>& objs,
+        const RenderState&         rs);
+    void Render(
+        const PointLight&          light,
+        const std::vector<Object>& objs,
+        const RenderState&         rs,
+        bool                       uses_shadow_map = false);
 };
 
 struct Renderer_SpotLighting {
@@ -187,21 +403,122 @@ struct Renderer_SpotLighting {
     Shader        vs_shadow, gs_shadow, fs_shadow;
     ShaderProgram sp_light, sp_shadow;
 
+    ShadowVolumeCompute    shadow_compute;
+    ShadowVolumeSilhouette shadow_silhouette;
+    ShadowCasters          shadow_casters;
+    RenderQueue            queue;
+    MultiDrawBatch         batch;
+
     Renderer_SpotLighting();
 
     void Render(const SpotLight& light, const std::vector<Object>& objs, const RenderState& rs);
 };
 
+// Shadow map alternative to shadow volumes for sun lights, the cost doesn't scale with the
+// complexity of the shadow casters or how far their shadows extend
+// The view frustum is split into cascades at blended logarithmic/uniform distances, each cascade is
+// fit with a bounding sphere so its size doesn't change as the camera rotates and is snapped to
+// whole texels so its contents don't shimmer as the camera moves
+struct CascadedShadowMap {
+    static constexpr GLsizei RESOLUTION = 2048;
+    // 1 is fully logarithmic, 0 is fully uniform
+    static constexpr f32 SPLIT_LAMBDA = 0.8f;
+    // NOTE: must match Lighting_FS
+    static constexpr GLint TEXTURE_SLOT = 3;
+
+    Shader         vs;
+    ShaderProgram  sp;
+    MultiDrawBatch batch;
+
+    FBO                fbo;
+    TextureShadowArray tex_depth;
+
+    u32       cascade_count = 0;
+    glm::mat4 mtx_light_vp[SunLight::MAX_SHADOW_CASCADES]; // world -> light clip space
+    glm::mat4 mtx_shadow[SunLight::MAX_SHADOW_CASCADES];   // world -> shadow map texture space
+    glm::vec4 split_depths; // view space depth where each cascade ends
+    glm::vec4 texel_sizes;  // world space size of a texel of each cascade
+
+    CascadedShadowMap() = default;
+    CascadedShadowMap(u32 max_cascades);
+
+    void Fit(const SunLight& light, const RenderState& rs);
+    void Render(const SunLight& light, const std::vector<Object>& objs, const RenderState& rs);
+    // binds the map and sets the sampling uniforms of Lighting_FS
+    void Use(ShaderProgram& sp) const;
+};
+
 struct Renderer_SunLighting {
     Shader        vs, fs;
     Shader        vs_shadow, gs_shadow, fs_shadow;
     ShaderProgram sp_light, sp_shadow;
 
+    ShadowVolumeCompute    shadow_compute;
+    ShadowVolumeSilhouette shadow_silhouette;
+    ShadowCasters          shadow_casters;
+    CascadedShadowMap      shadow_map;
+    RenderQueue            queue;
+    MultiDrawBatch         batch;
+
     Renderer_SunLighting();
 
+    // only for lights using shadow maps, must be called before Render, changes the bound FBO and
+    // the viewport
+    void
+    RenderShadowMap(const SunLight& light, const std::vector<Object>& objs, const RenderState& rs);
+    void RenderShadowVolumes(
+        const SunLight&            light,
+        const std::vector<Object>& objs,
+        const RenderState&         rs);
     void Render(const SunLight& light, const std::vector<Object>& objs, const RenderState& rs);
 };
 
+// Clustered forward shading for point lights that don't cast shadows, the view frustum is split
+// into froxels and each froxel gets a list of the lights that touch it, the whole set of lights is
+// then shaded in a single additive pass
+struct Renderer_ClusteredLighting {
+    static constexpr u32 CLUSTER_X     = 16;
+    static constexpr u32 CLUSTER_Y     = 9;
+    static constexpr u32 CLUSTER_Z     = 24;
+    static constexpr u32 CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+    // NOTE: must match the layout of ClusteredLight in the lighting shaders
+    struct GPU_Light {
+        glm::vec4 pos_radius;
+        glm::vec4 color;
+    };
+
+    // NOTE: must match the layout of the cluster grid in the lighting shaders
+    struct GPU_Cluster {
+        u32 offset;
+        u32 count;
+    };
+
+    Shader         vs, fs;
+    ShaderProgram  sp_light;
+    RenderQueue    queue;
+    MultiDrawBatch batch;
+
+    SSBO ssbo_lights;
+    SSBO ssbo_clusters;
+    SSBO ssbo_indices;
+
+    // scratch space for building the cluster grid, kept around to avoid reallocating every frame
+    std::vector<GPU_Light>   gpu_lights;
+    std::vector<GPU_Cluster> gpu_clusters;
+    std::vector<u32>         gpu_indices;
+    std::vector<u32>         cluster_cursor;
+
+    Renderer_ClusteredLighting();
+
+    void Render(
+        const std::vector<PointLight>& lights,
+        const std::vector<Object>&     objs,
+        const RenderState&             rs);
+
+    usize BuildClusters(const std::vector<PointLight>& lights, const RenderState& rs);
+};
+
 struct Renderer_Skybox {
     Shader        vs, fs;
     ShaderProgram sp;
@@ -220,54 +537,171 @@ struct Renderer_SphericalBillboard {
     void Render(const std::vector<Sprite3D>& sprites, const RenderState& rs);
 };
 
+// Bloom composite, tonemapping, sharpening and gamma correction fused into one compute pass that
+// reads the scene once and writes the LDR result once, every combination of steps is its own
+// program, built the first time a frame uses it
 struct Renderer_PostFX {
-    Shader         vs, fs_sharpen, fs_gamma, fs_tonemap;
-    ShaderProgram  sp_sharpen, sp_gamma, sp_tonemap;
-    FullscreenQuad quad;
+    // NOTE: must match PostFX_CS
+    static constexpr GLuint  TONEMAP_REINHARD    = 0;
+    static constexpr GLuint  TONEMAP_ACES_APPROX = 1;
+    static constexpr GLuint  TONEMAP_CLAMP       = 2;
+    static constexpr GLsizei GROUP_SIZE          = 16;
+    static constexpr GLenum  LDR_FORMAT          = GL_RGBA8;
+
+    // the steps requested for a frame
+    struct PostParams {
+        u32    bloom_chain      = FrameGraph::NONE; // NONE skips the bloom composite
+        f32    bloom_radius     = 0.0f;
+        f32    bloom_strength   = 0.0f;
+        GLuint tonemapper       = TONEMAP_CLAMP;
+        f32    sharpen_strength = 0.0f; // 0 skips sharpening
+        f32    gamma            = 2.2f;
+
+        // fraction of the source that was rendered to, it's upscaled to the whole output
+        glm::vec2 render_scale = glm::vec2(1.0f);
+    };
 
-    // NOTE: must match the tonemap shader
-    static constexpr GLuint TONEMAP_REINHARD    = 0;
-    static constexpr GLuint TONEMAP_ACES_APPROX = 1;
+    std::unordered_map<u32, ShaderProgram> programs; // permutation -> program
 
-    Renderer_PostFX();
+    ShaderProgram& Program(const PostParams& params);
 
-    void RenderTonemap(const TextureRT& src_hdr, const FBO& dst_sdr, GLuint tonemapper);
-    void
-    RenderSharpen(const TextureRT& src, const FBO& dst, glm::vec2 screen_resolution, f32 strength);
-    void RenderGammaCorrect(const TextureRT& src_hdr, const FBO& dst_sdr, f32 gamma);
+    // dst_ldr is LDR_FORMAT, the compute shader writes it as an image
+    void Render(const FrameGraph& graph, u32 src_hdr, u32 dst_ldr, const PostParams& params);
 };
 
+// Bloom over the mips of a single texture: one compute dispatch builds the whole downsample chain
+// and the upsample chain accumulates back up it, the last step is left to the post pass
 struct Renderer_Bloom {
-    static constexpr f32   BLOOM_RADIUS        = 0.005f;
-    static constexpr f32   BLOOM_STRENGTH      = 0.04f;
-    static constexpr isize BLOOM_MIP_CHAIN_LEN = 6;
+    static constexpr f32 BLOOM_RADIUS   = 0.005f;
+    static constexpr f32 BLOOM_STRENGTH = 0.04f;
 
-    ShaderProgram sp_upscale, sp_downscale, sp_final;
+    // NOTE: must match BloomDownsample_CS
+    static constexpr isize   BLOOM_MIP_CHAIN_LEN  = 6;
+    static constexpr GLsizei DOWNSAMPLE_TILE_SIZE = 64; // in texels of the first mip
+    // NOTE: must match BloomUpsample_CS
+    static constexpr GLsizei UPSAMPLE_GROUP_SIZE = 8;
 
-    glm::vec2 input_res;
+    ShaderProgram sp_downsample, sp_upsample;
 
-    struct {
-        glm::vec2 res;
-        TextureRT tex;
-    } mips[BLOOM_MIP_CHAIN_LEN];
+    Shader cs_downsample, cs_upsample;
 
-    Shader vs, fs_upscale, fs_downscale, fs_final;
+    Renderer_Bloom();
 
-    FBO fbo;
+    // chain is a transient texture of the frame graph with BLOOM_MIP_CHAIN_LEN levels, the first
+    // half the size of src_hdr, render_scale is the fraction of src_hdr that was rendered to
+    // NOTE: the chain has to be HDR_FORMAT, the compute shaders access it as r11f_g11f_b10f
+    void Render(
+        const FrameGraph& graph,
+        u32               src_hdr,
+        u32               chain,
+        f32               radius,
+        glm::vec2         render_scale);
+};
 
-    FullscreenQuad quad;
+// SMAA 1x on the LDR output: luma edge detection, blend weights from the area between each edge and
+// the silhouette its pattern is revectorized into, and neighborhood blending. The areas are
+// precomputed into a texture at startup
+struct Renderer_SMAA {
+    // NOTE: must match SMAAWeights_CS
+    static constexpr i32     MAX_DISTANCE   = 16; // texels searched along an edge, each way
+    static constexpr GLsizei AREA_SIZE      = 3 * MAX_DISTANCE;
+    static constexpr GLenum  AREA_FORMAT    = GL_RG16F;
+    static constexpr GLenum  EDGES_FORMAT   = GL_RG8;
+    static constexpr GLenum  WEIGHTS_FORMAT = GL_RGBA8;
+    // NOTE: must match the SMAA shaders
+    static constexpr GLsizei GROUP_SIZE = 8;
+
+    Shader        cs_edges, cs_weights, cs_blend;
+    ShaderProgram sp_edges, sp_weights, sp_blend;
+    TextureRT     tex_area;
+
+    Renderer_SMAA();
+
+    // src_ldr and dst_ldr are Renderer_PostFX::LDR_FORMAT, edges and weights are transient
+    // textures of their formats
+    void Render(const FrameGraph& graph, u32 src_ldr, u32 edges, u32 weights, u32 dst_ldr);
+};
 
-    bool mips_setup = false;
+// Temporal anti-aliasing in place of MSAA: the projection is jittered along a Halton sequence and
+// every frame is accumulated into a history at the full resolution, reprojected with the motion
+// vectors of the camera, which also upscales frames rendered at a lower resolution
+struct Renderer_TAA {
+    static constexpr u64    JITTER_PHASES  = 8;
+    static constexpr f32    HISTORY_WEIGHT = 0.9f;
+    static constexpr GLenum MOTION_FORMAT  = GL_RG16F;
+    static constexpr GLenum HISTORY_FORMAT = GL_RGBA16F;
+    // NOTE: must match TAAMotion_CS and TAA_CS
+    static constexpr GLsizei GROUP_SIZE = 8;
+
+    Shader        cs_motion, cs_resolve;
+    ShaderProgram sp_motion, sp_resolve;
+
+    // this frame's output is written to one while the other holds the last frame's
+    TextureRT history[2];
+    GLsizei   history_width = 0, history_height = 0;
+    u32       history_index    = 0; // of the one written this frame
+    bool      is_history_valid = false;
+
+    u64       phase               = 0;
+    glm::vec2 jitter              = glm::vec2(0.0f); // in rendered texels
+    glm::mat4 mtx_vp              = glm::mat4(1.0f); // without the jitter
+    glm::mat4 mtx_prev_vp         = glm::mat4(1.0f);
+    glm::mat4 mtx_inv_jittered_vp = glm::mat4(1.0f);
+
+    Renderer_TAA();
+
+    // advances the jitter and swaps the history, returns the jittered projection for the frame
+    glm::mat4 NextFrame(
+        const glm::mat4& mtx_proj,
+        const glm::mat4& mtx_view,
+        glm::vec2        resolution,
+        glm::vec2        render_resolution);
+
+    // render_size is the corner of the scene target that was rendered to
+    void RenderMotion(const FrameGraph& graph, u32 depth, u32 motion, glm::vec2 render_size);
+    void Render(
+        const FrameGraph& graph,
+        u32               color,
+        u32               depth,
+        u32               motion,
+        u32               history,
+        u32               dst,
+        glm::vec2         render_size);
+};
 
-    Renderer_Bloom();
+// Picks the render scale that keeps the GPU time of a frame within settings.frame_budget_ms. Frames
+// are timed with timestamp queries that are only read once they're available, a few frames later,
+// so the CPU never waits on the GPU for them
+struct DynamicResolution {
+    static constexpr usize FRAMES_IN_FLIGHT = 4;
+
+    // fraction of the way to the estimated scale that's covered per frame, the timings are a few
+    // frames old and noisy
+    static constexpr f32 SMOOTHING = 0.25f;
+
+    Query start[FRAMES_IN_FLIGHT];
+    Query end[FRAMES_IN_FLIGHT];
+    f32   frame_scale[FRAMES_IN_FLIGHT] = {}; // scale each timed frame was rendered at
+    bool  is_recorded[FRAMES_IN_FLIGHT] = {};
+    usize frame                         = 0;
+
+    f32 scale  = 1.0f;
+    f32 gpu_ms = 0.0f; // of the last frame that was read back
+
+    DynamicResolution();
 
-    void SetResolution(f32 width, f32 height);
-    void Render(const TextureRT& src_hdr, const FBO& dst_hdr, f32 radius, f32 strength);
+    // moves the scale towards the budget with the latest timing that's available
+    f32  Update();
+    void BeginFrame();
+    void EndFrame();
 };
 
 struct Renderer {
-    static constexpr f32 CLIP_NEAR = 0.1f;
-    static constexpr f32 CLIP_FAR  = 50.0f;
+    static constexpr f32    CLIP_NEAR  = 0.1f;
+    static constexpr f32    CLIP_FAR   = 50.0f;
+    static constexpr GLenum HDR_FORMAT = GL_R11F_G11F_B10F;
+    // applied by the post pass when an upscaled frame has no sharpening of its own
+    static constexpr f32 UPSCALE_SHARPEN_STRENGTH = 0.5f;
 
     // TODO: merge these? maybe not?
     RenderState rs;
@@ -286,9 +720,11 @@ struct Renderer {
         RBO color;
     };
 
-    struct Simple_RT {
+    // single sample, used instead of MSAA_RT with settings.temporal_aa or a single MSAA sample,
+    // it's sampled instead of resolved
+    struct SceneRT {
         FBO       fbo;
-        RBO       depth_stencil;
+        TextureRT depth_stencil;
         TextureRT color;
     };
 
@@ -297,20 +733,37 @@ struct Renderer {
     Renderer_PointLighting      rp_point_lighting;
     Renderer_SpotLighting       rp_spot_lighting;
     Renderer_SunLighting        rp_sun_lighting;
+    Renderer_ClusteredLighting  rp_clustered_lighting;
     Renderer_Skybox             rp_skybox;
     Renderer_SphericalBillboard rp_spherical_billboard;
     Renderer_Bloom              rp_bloom;
     Renderer_PostFX             rp_postfx;
+    Renderer_TAA                rp_taa;
+    Renderer_SMAA               rp_smaa;
 
     u32 res_width = 1920, res_height = 1080;
     f32 fov = 90.0f;
 
+    // the scene is rendered to the corner of the targets that's render_width x render_height, the
+    // targets stay at the full resolution so changing the scale never reallocates them
+    u32               render_width = 1920, render_height = 1080;
+    DynamicResolution dynamic_resolution;
+
     UBO shared_data;
 
     // Render FBOs
-    MSAA_RT   msaa;
-    Simple_RT post[2]; // TODO: this should probably just swap out the color attachment
-    usize     post_target = 0;
+    MSAA_RT msaa;
+    SceneRT scene;
+    FBO     output; // FinishRender presents to it, 0 is the window's backbuffer
+
+    // passes after FinishGeometry are recorded into the graph and run by FinishRender
+    FrameGraph graph;
+    u32        scene_color = FrameGraph::NONE; // resource with the latest result of the chain
+    glm::vec2  scene_scale = glm::vec2(1.0f);  // fraction of scene_color that holds the frame
+
+    // bloom composite, tonemapping and sharpening only record their parameters, FinishRender
+    // applies them all in a single pass
+    Renderer_PostFX::PostParams post;
 
     Renderer(bool opengl_logging = false);
 
@@ -321,10 +774,17 @@ struct Renderer {
     Renderer& ViewMatrix(const glm::mat4& mtx);
 
     Renderer& ClearColor(f32 red, f32 green, f32 blue);
+    // an offscreen target to present to instead of the backbuffer, for contexts without a window
+    Renderer& OutputTarget(const FBO& fbo);
 
-    Simple_RT& GetRenderTarget();
-    Simple_RT& GetRenderSource();
-    void       AdvanceRenderTarget();
+    // fraction of the targets that the scene is rendered to
+    glm::vec2 RenderScale() const;
+    // the target the scene is drawn to, MSAA or the single sample one for TAA
+    const FBO& SceneTarget() const;
+    void       CreateSceneTarget();
+
+    // renders the light's shadows with whichever technique it uses, then the light itself
+    void RenderShadowedLight(const PointLight& light, const std::vector<Object>& objs);
 
     // Rendering methods
     void StartRender();
@@ -333,12 +793,17 @@ struct Renderer {
     void RenderObjectLighting(const PointLight& light, const std::vector<Object>& objs);
     void RenderObjectLighting(const SpotLight& light, const std::vector<Object>& objs);
     void RenderObjectLighting(const SunLight& light, const std::vector<Object>& objs);
+    // shadowed lights are rendered individually, the rest go through the clustered pass
+    void
+    RenderObjectLighting(const std::vector<PointLight>& lights, const std::vector<Object>& objs);
     void RenderSkybox(const Skybox& sky);
     void RenderSprites(const std::vector<Sprite3D>& sprites);
 
     // TODO: Need to make it more clear that you have to call this function before calling any of
     // the functions below
     void FinishGeometry();
+    void ResolveMSAA(const FrameGraph::TextureDesc& hdr);
+    void ResolveTemporal(const FrameGraph::TextureDesc& hdr);
 
     void RenderBloom(f32 radius, f32 strength);
     void RenderTonemap(GLuint tonemapper);
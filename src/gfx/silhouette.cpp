@@ -0,0 +1,301 @@
+#include "silhouette.hpp"
+
+#ifdef __AVX2__
+#    include <immintrin.h>
+#endif
+
+static void PadToLanes(std::vector<f32>* vec, usize count)
+{
+    vec->resize(count, 0.0f);
+}
+
+SilhouetteMesh::SilhouetteMesh(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<GLuint>&    adjacency_indices)
+{
+    std::vector<glm::vec4> gpu_edges = {};
+    std::vector<glm::vec4> gpu_faces = {};
+
+    // see: https://ogldev.org/www/tutorial39/adjacencies.jpg
+    // start, end, and the opposite vertex of the face across the edge
+    constexpr usize adjacent_edges[3][3] = {
+        {0, 2, 1},
+        {2, 4, 3},
+        {4, 0, 5},
+    };
+
+    for (usize ii = 0; ii + 6 <= adjacency_indices.size(); ii += 6) {
+        const GLuint* adj = &adjacency_indices[ii];
+
+        glm::vec3 vtx[6];
+        for (usize jj = 0; jj < 6; jj++) {
+            vtx[jj] = positions[adj[jj]];
+        }
+
+        glm::vec3 normal = glm::cross(vtx[2] - vtx[0], vtx[4] - vtx[0]);
+
+        this->face_px.push_back(vtx[0].x);
+        this->face_py.push_back(vtx[0].y);
+        this->face_pz.push_back(vtx[0].z);
+        this->face_nx.push_back(normal.x);
+        this->face_ny.push_back(normal.y);
+        this->face_nz.push_back(normal.z);
+
+        gpu_faces.push_back(glm::vec4(vtx[0], 1.0f));
+        gpu_faces.push_back(glm::vec4(vtx[2], 1.0f));
+        gpu_faces.push_back(glm::vec4(vtx[4], 1.0f));
+
+        for (const auto& edge : adjacent_edges) {
+            GLuint idx_start    = adj[edge[0]];
+            GLuint idx_end      = adj[edge[1]];
+            GLuint idx_opposite = adj[edge[2]];
+
+            // ComputeAdjacencyIndices points boundary edges back at the face itself
+            bool is_boundary
+                = idx_opposite == adj[0] || idx_opposite == adj[2] || idx_opposite == adj[4];
+
+            // interior edges are shared by two faces, only keep the copy from one of them
+            // NOTE: this assumes the mesh is manifold, which ComputeAdjacencyIndices does as well
+            if (!is_boundary && idx_start > idx_end) {
+                continue;
+            }
+
+            const glm::vec3& start    = vtx[edge[0]];
+            const glm::vec3& end      = vtx[edge[1]];
+            const glm::vec3& opposite = vtx[edge[2]];
+
+            glm::vec3 normal_b = glm::vec3(0.0f);
+            if (!is_boundary) {
+                normal_b = glm::cross(opposite - start, end - start);
+            }
+
+            this->edge_px.push_back(start.x);
+            this->edge_py.push_back(start.y);
+            this->edge_pz.push_back(start.z);
+            this->edge_na_x.push_back(normal.x);
+            this->edge_na_y.push_back(normal.y);
+            this->edge_na_z.push_back(normal.z);
+            this->edge_nb_x.push_back(normal_b.x);
+            this->edge_nb_y.push_back(normal_b.y);
+            this->edge_nb_z.push_back(normal_b.z);
+
+            gpu_edges.push_back(glm::vec4(start, 1.0f));
+            gpu_edges.push_back(glm::vec4(end, 1.0f));
+        }
+    }
+
+    this->edge_count = (this->edge_px.size() + LANES - 1) / LANES * LANES;
+    this->face_count = (this->face_px.size() + LANES - 1) / LANES * LANES;
+
+    for (auto* vec : {
+             &this->edge_px,
+             &this->edge_py,
+             &this->edge_pz,
+             &this->edge_na_x,
+             &this->edge_na_y,
+             &this->edge_na_z,
+             &this->edge_nb_x,
+             &this->edge_nb_y,
+             &this->edge_nb_z,
+         })
+    {
+        PadToLanes(vec, this->edge_count);
+    }
+
+    for (auto* vec : {
+             &this->face_px,
+             &this->face_py,
+             &this->face_pz,
+             &this->face_nx,
+             &this->face_ny,
+             &this->face_nz,
+         })
+    {
+        PadToLanes(vec, this->face_count);
+    }
+
+    this->ssbo_edges.Reserve();
+    this->ssbo_faces.Reserve();
+    this->ssbo_edges.LoadData(
+        gpu_edges.size() * sizeof(glm::vec4),
+        gpu_edges.data(),
+        GL_STATIC_DRAW);
+    this->ssbo_faces.LoadData(
+        gpu_faces.size() * sizeof(glm::vec4),
+        gpu_faces.data(),
+        GL_STATIC_DRAW);
+}
+
+#ifdef __AVX2__
+static inline __m256
+Dot3_AVX2(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+    __m256 dot = _mm256_mul_ps(ax, bx);
+    dot        = _mm256_add_ps(dot, _mm256_mul_ps(ay, by));
+    dot        = _mm256_add_ps(dot, _mm256_mul_ps(az, bz));
+    return dot;
+}
+
+// bit N is set if lane N of the normal faces the light
+static inline u32 FacingMask_AVX2(
+    const f32* nx,
+    const f32* ny,
+    const f32* nz,
+    __m256     to_light_x,
+    __m256     to_light_y,
+    __m256     to_light_z)
+{
+    __m256 dot = Dot3_AVX2(
+        _mm256_loadu_ps(nx),
+        _mm256_loadu_ps(ny),
+        _mm256_loadu_ps(nz),
+        to_light_x,
+        to_light_y,
+        to_light_z);
+
+    return (u32)_mm256_movemask_ps(_mm256_cmp_ps(dot, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+#else
+static inline bool IsFacing(f32 nx, f32 ny, f32 nz, f32 to_light_x, f32 to_light_y, f32 to_light_z)
+{
+    return nx * to_light_x + ny * to_light_y + nz * to_light_z > 0.0f;
+}
+#endif
+
+void SilhouetteMesh::ClassifyEdges(
+    const glm::vec4&  light,
+    usize             begin,
+    usize             end,
+    std::vector<u32>* edges) const
+{
+    ASSERT(begin % LANES == 0 && end % LANES == 0);
+
+#ifdef __AVX2__
+    const __m256 light_x = _mm256_set1_ps(light.x);
+    const __m256 light_y = _mm256_set1_ps(light.y);
+    const __m256 light_z = _mm256_set1_ps(light.z);
+    const __m256 light_w = _mm256_set1_ps(light.w);
+
+    for (usize ii = begin; ii < end; ii += LANES) {
+        // vector from the start of the edge towards the light
+        __m256 to_light_x
+            = _mm256_sub_ps(light_x, _mm256_mul_ps(_mm256_loadu_ps(&this->edge_px[ii]), light_w));
+        __m256 to_light_y
+            = _mm256_sub_ps(light_y, _mm256_mul_ps(_mm256_loadu_ps(&this->edge_py[ii]), light_w));
+        __m256 to_light_z
+            = _mm256_sub_ps(light_z, _mm256_mul_ps(_mm256_loadu_ps(&this->edge_pz[ii]), light_w));
+
+        u32 facing_a = FacingMask_AVX2(
+            &this->edge_na_x[ii],
+            &this->edge_na_y[ii],
+            &this->edge_na_z[ii],
+            to_light_x,
+            to_light_y,
+            to_light_z);
+        u32 facing_b = FacingMask_AVX2(
+            &this->edge_nb_x[ii],
+            &this->edge_nb_y[ii],
+            &this->edge_nb_z[ii],
+            to_light_x,
+            to_light_y,
+            to_light_z);
+
+        // silhouette edges separate a light facing face from one that isn't
+        u32 silhouette = facing_a ^ facing_b;
+        while (silhouette) {
+            u32 lane = __builtin_ctz(silhouette);
+            silhouette &= silhouette - 1;
+
+            u32 record = (u32)(ii + lane);
+            if (!(facing_a & (1u << lane))) {
+                record |= EDGE_FLIP;
+            }
+
+            edges->push_back(record);
+        }
+    }
+#else
+    for (usize ii = begin; ii < end; ii++) {
+        f32 to_light_x = light.x - this->edge_px[ii] * light.w;
+        f32 to_light_y = light.y - this->edge_py[ii] * light.w;
+        f32 to_light_z = light.z - this->edge_pz[ii] * light.w;
+
+        bool facing_a = IsFacing(
+            this->edge_na_x[ii],
+            this->edge_na_y[ii],
+            this->edge_na_z[ii],
+            to_light_x,
+            to_light_y,
+            to_light_z);
+        bool facing_b = IsFacing(
+            this->edge_nb_x[ii],
+            this->edge_nb_y[ii],
+            this->edge_nb_z[ii],
+            to_light_x,
+            to_light_y,
+            to_light_z);
+
+        if (facing_a != facing_b) {
+            edges->push_back((u32)ii | (facing_a ? 0 : EDGE_FLIP));
+        }
+    }
+#endif
+}
+
+void SilhouetteMesh::ClassifyFaces(
+    const glm::vec4&  light,
+    usize             begin,
+    usize             end,
+    std::vector<u32>* faces) const
+{
+    ASSERT(begin % LANES == 0 && end % LANES == 0);
+
+#ifdef __AVX2__
+    const __m256 light_x = _mm256_set1_ps(light.x);
+    const __m256 light_y = _mm256_set1_ps(light.y);
+    const __m256 light_z = _mm256_set1_ps(light.z);
+    const __m256 light_w = _mm256_set1_ps(light.w);
+
+    for (usize ii = begin; ii < end; ii += LANES) {
+        __m256 to_light_x
+            = _mm256_sub_ps(light_x, _mm256_mul_ps(_mm256_loadu_ps(&this->face_px[ii]), light_w));
+        __m256 to_light_y
+            = _mm256_sub_ps(light_y, _mm256_mul_ps(_mm256_loadu_ps(&this->face_py[ii]), light_w));
+        __m256 to_light_z
+            = _mm256_sub_ps(light_z, _mm256_mul_ps(_mm256_loadu_ps(&this->face_pz[ii]), light_w));
+
+        u32 facing = FacingMask_AVX2(
+            &this->face_nx[ii],
+            &this->face_ny[ii],
+            &this->face_nz[ii],
+            to_light_x,
+            to_light_y,
+            to_light_z);
+
+        while (facing) {
+            u32 lane = __builtin_ctz(facing);
+            facing &= facing - 1;
+
+            faces->push_back((u32)(ii + lane));
+        }
+    }
+#else
+    for (usize ii = begin; ii < end; ii++) {
+        f32 to_light_x = light.x - this->face_px[ii] * light.w;
+        f32 to_light_y = light.y - this->face_py[ii] * light.w;
+        f32 to_light_z = light.z - this->face_pz[ii] * light.w;
+
+        bool facing = IsFacing(
+            this->face_nx[ii],
+            this->face_ny[ii],
+            this->face_nz[ii],
+            to_light_x,
+            to_light_y,
+            to_light_z);
+
+        if (facing) {
+            faces->push_back((u32)ii);
+        }
+    }
+#endif
+}
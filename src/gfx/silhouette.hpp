@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "common.hpp"
+#include "gfx/opengl.hpp"
+
+// Shadow volume edges and faces of a mesh, used to find silhouettes on the CPU
+// The SoA arrays are padded to a multiple of LANES with zeroed normals, padding never classifies as
+// light facing so it never produces output
+struct SilhouetteMesh {
+    static constexpr usize LANES = 8;
+    // set on edge records whose winding has to be reversed (face B is the light facing one)
+    static constexpr u32 EDGE_FLIP = 1u << 31;
+
+    // p is the start of the edge, which lies on both faces, face A is the face that owns the
+    // edge's winding and face B is the face across the edge (zero normal for boundary edges)
+    std::vector<f32> edge_px, edge_py, edge_pz;
+    std::vector<f32> edge_na_x, edge_na_y, edge_na_z;
+    std::vector<f32> edge_nb_x, edge_nb_y, edge_nb_z;
+
+    // p is any vertex of the face
+    std::vector<f32> face_px, face_py, face_pz;
+    std::vector<f32> face_nx, face_ny, face_nz;
+
+    usize edge_count = 0; // padded
+    usize face_count = 0; // padded
+
+    // NOTE: must match the layout in ShadowVolumeSilhouette_VS
+    SSBO ssbo_edges; // vec4 start, vec4 end
+    SSBO ssbo_faces; // vec4 v0, vec4 v1, vec4 v2
+
+    SilhouetteMesh() = default;
+    // adjacency_indices are in GL_TRIANGLES_ADJACENCY order
+    SilhouetteMesh(
+        const std::vector<glm::vec3>& positions,
+        const std::vector<GLuint>&    adjacency_indices);
+
+    // light is (pos, 1) for positional lights and (-dir, 0) for directional lights, in the mesh's
+    // local space, the direction towards the light from p is then light.xyz - p * light.w
+    // appends the silhouette edge records and light facing face indices in [begin, end) which must
+    // be multiples of LANES
+    void
+    ClassifyEdges(const glm::vec4& light, usize begin, usize end, std::vector<u32>* edges) const;
+    void
+    ClassifyFaces(const glm::vec4& light, usize begin, usize end, std::vector<u32>* faces) const;
+};
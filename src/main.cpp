@@ -17,10 +17,13 @@
 
 #include "common.hpp"
 #include "common/opengl.hpp"
+#include "gfx/capture.hpp"
 #include "gfx/opengl.hpp"
+#include "gfx/readback.hpp"
 #include "gfx/renderer.hpp"
 #include "math/random.hpp"
 #include "utils/profiling.hpp"
+#include "utils/settings.hpp"
 
 /// IMGUI
 #include "imgui.h"
@@ -182,6 +185,68 @@ static void Key_F_OnTransition(GLFWwindow* window, bool key_pressed)
     }
 }
 
+// cycles through the shadow volume implementations, compare them in the profiler
+static void Key_G_OnTransition(GLFWwindow* window, bool key_pressed)
+{
+    (void)window;
+    if (key_pressed) {
+        switch (settings.shadow_volume_mode) {
+            case ShadowVolumeMode::GeometryShader:
+                settings.shadow_volume_mode = ShadowVolumeMode::ComputeShader;
+                break;
+            case ShadowVolumeMode::ComputeShader:
+                settings.shadow_volume_mode = ShadowVolumeMode::CPU;
+                break;
+            case ShadowVolumeMode::CPU:
+                settings.shadow_volume_mode = ShadowVolumeMode::GeometryShader;
+                break;
+        }
+    }
+}
+
+// switches the sun between shadow volumes and cascaded shadow maps
+static void Key_C_OnTransition(GLFWwindow* window, bool key_pressed)
+{
+    (void)window;
+    if (key_pressed) {
+        sun_light.ShadowCascades(sun_light.ShadowCascades() > 0 ? 0 : 3);
+    }
+}
+
+bool g_point_shadow_maps = false;
+
+// switches placed point lights between shadow volumes and cached cube shadow maps
+static void Key_V_OnTransition(GLFWwindow* window, bool key_pressed)
+{
+    (void)window;
+    if (key_pressed) {
+        g_point_shadow_maps = !g_point_shadow_maps;
+        for (auto& light : point_lights) {
+            light.ShadowMapped(g_point_shadow_maps);
+        }
+    }
+}
+
+bool g_take_screenshot = false;
+bool g_toggle_sequence = false;
+
+static void Key_F12_OnTransition(GLFWwindow* window, bool key_pressed)
+{
+    (void)window;
+    if (key_pressed) {
+        g_take_screenshot = true;
+    }
+}
+
+// starts or stops dumping every frame
+static void Key_F11_OnTransition(GLFWwindow* window, bool key_pressed)
+{
+    (void)window;
+    if (key_pressed) {
+        g_toggle_sequence = true;
+    }
+}
+
 static void ProcessKeyboardInput(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     (void)scancode;
@@ -205,6 +270,11 @@ static void ProcessKeyboardInput(GLFWwindow* window, int key, int scancode, int
         [GLFW_KEY_RIGHT_SHIFT]   = Key_SHIFT_OnTransition,
         [GLFW_KEY_LEFT_SHIFT]    = Key_SHIFT_OnTransition,
         [GLFW_KEY_F]             = Key_F_OnTransition,
+        [GLFW_KEY_G]             = Key_G_OnTransition,
+        [GLFW_KEY_C]             = Key_C_OnTransition,
+        [GLFW_KEY_V]             = Key_V_OnTransition,
+        [GLFW_KEY_F11]           = Key_F11_OnTransition,
+        [GLFW_KEY_F12]           = Key_F12_OnTransition,
     };
 
     bool key_pressed;
@@ -295,11 +365,17 @@ static void ProcessMouseButtonInput(GLFWwindow* window, int button, int action,
         sun_light.dir = g_Camera.FacingDirection();
     }
 
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+    // left click places a shadow casting light, middle click places a cheaper unshadowed light
+    bool place_light = button == GLFW_MOUSE_BUTTON_LEFT || button == GLFW_MOUSE_BUTTON_MIDDLE;
+    if (place_light && action == GLFW_PRESS) {
         constexpr glm::vec3 light_color     = {1.0f, 0.7f, 0.1f};
         constexpr f32       light_intensity = 10.0f;
 
-        point_lights.push_back(PointLight(g_Camera.pos, light_color, light_intensity));
+        bool casts_shadows = button == GLFW_MOUSE_BUTTON_LEFT;
+
+        point_lights.push_back(
+            PointLight(g_Camera.pos, light_color, light_intensity, casts_shadows)
+                .ShadowMapped(g_point_shadow_maps));
         sprites.push_back(Sprite3D("assets/flare.png")
                               .Position(g_Camera.pos)
                               .Tint(light_color)
@@ -358,6 +434,7 @@ void RenderLoop(GLFWwindow* window)
 {
     constexpr glm::vec3 rgb_white = {1.0f, 1.0f, 1.0f};
 
+    // the renderer's programs compile in the background while the assets below are imported
     Renderer rt  = Renderer(RENDER_ENABLE_OPENGL_LOGGING).ClearColor(0, 0, 0).FOV(90);
     Skybox   sky = Skybox("assets/tex/sky0");
 
@@ -373,6 +450,7 @@ void RenderLoop(GLFWwindow* window)
     };
 
     AmbientLight ambient_light = AmbientLight(rgb_white, 0.05f);
+    FrameCapture capture       = FrameCapture();
 
     while (!glfwWindowShouldClose(window)) {
         PlayerCamera cam      = g_Camera;
@@ -464,6 +542,18 @@ void RenderLoop(GLFWwindow* window)
                     entry_cycles.hit_count);
             }
 
+            ImGui::Text("");
+            ImGui::Text("");
+            ImGui::Text(
+                "GL state calls: %" PRIu64 " issued, %" PRIu64 " elided",
+                GLState.issued_calls,
+                GLState.elided_calls);
+            ImGui::Text(
+                "Render resolution: %ux%u (%.1f ms GPU)",
+                rt.render_width,
+                rt.render_height,
+                rt.dynamic_resolution.gpu_ms);
+
             ImGui::End();
         }
 
@@ -497,9 +587,7 @@ void RenderLoop(GLFWwindow* window)
                 rt.RenderObjectLighting(ambient_light, objs);
                 rt.RenderObjectLighting(sun_dupe, objs);
 
-                for (const auto& light : point_lights) {
-                    rt.RenderObjectLighting(light, objs);
-                }
+                rt.RenderObjectLighting(point_lights, objs);
 
                 if (g_spotlight_on) {
                     rt.RenderObjectLighting(sp_dupe, objs);
@@ -518,6 +606,22 @@ void RenderLoop(GLFWwindow* window)
 
             rt.FinishRender(2.2f);
 
+            // before the UI is drawn over the frame
+            if (g_take_screenshot) {
+                capture.Screenshot(ImageFormat::PNG, (i32)g_res_w, (i32)g_res_h);
+                g_take_screenshot = false;
+            }
+
+            if (g_toggle_sequence) {
+                if (capture.IsRecording()) {
+                    capture.StopSequence();
+                } else {
+                    capture.StartSequence(ImageFormat::QOI);
+                }
+                g_toggle_sequence = false;
+            }
+            capture.CaptureFrame((i32)g_res_w, (i32)g_res_h);
+
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
             glfwSwapBuffers(window);
@@ -525,6 +629,9 @@ void RenderLoop(GLFWwindow* window)
 
         CollectProfilingData();
     }
+
+    // the captures still in flight are written out before their encoder threads stop
+    Readback.Flush();
 }
 
 int main()
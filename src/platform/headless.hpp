@@ -0,0 +1,26 @@
+#pragma once
+
+#include <EGL/egl.h>
+
+#include "common.hpp"
+#include "gfx/opengl.hpp"
+
+// OpenGL 4.5 context without a window or display server, through EGL's surfaceless platform,
+// along with an offscreen target for the renderer to present to in place of a backbuffer
+// Mesa's llvmpipe provides one on machines without a GPU (LIBGL_ALWAYS_SOFTWARE=1)
+struct HeadlessContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    TextureRT color;
+    FBO       fbo;
+    u32       width;
+    u32       height;
+
+    // makes the context current on the calling thread, aborts if one can't be created
+    HeadlessContext(u32 width, u32 height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&)            = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+};
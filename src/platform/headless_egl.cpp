@@ -0,0 +1,134 @@
+#include "headless.hpp"
+
+#include <string.h>
+
+#include <EGL/eglext.h>
+
+#include "common/opengl.hpp"
+
+// extensions is a space separated list, as returned by eglQueryString
+static bool HasExtension(const char* extensions, const char* name)
+{
+    if (extensions == nullptr) {
+        return false;
+    }
+
+    usize       len = strlen(name);
+    const char* ext = strstr(extensions, name);
+
+    // a match may only be the prefix of a longer name
+    while (ext != nullptr) {
+        bool is_start = ext == extensions || ext[-1] == ' ';
+        bool is_end   = ext[len] == '\0' || ext[len] == ' ';
+        if (is_start && is_end) {
+            return true;
+        }
+
+        ext = strstr(ext + len, name);
+    }
+
+    return false;
+}
+
+static EGLDisplay SurfacelessDisplay()
+{
+    // the platform is an extension, without it the default display may still allow surfaceless
+    // contexts through EGL_KHR_surfaceless_context
+    const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    auto get_platform_display
+        = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    bool has_surfaceless = HasExtension(client_extensions, "EGL_MESA_platform_surfaceless");
+    if (has_surfaceless && get_platform_display != nullptr) {
+        return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    LOG_WARNING("EGL_MESA_platform_surfaceless is unsupported, using the default display");
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+HeadlessContext::HeadlessContext(u32 width, u32 height)
+{
+    this->width  = width;
+    this->height = height;
+
+    this->display = SurfacelessDisplay();
+    if (this->display == EGL_NO_DISPLAY) {
+        ABORT("Failed to get an EGL display");
+    }
+
+    EGLint major, minor;
+    if (eglInitialize(this->display, &major, &minor) != EGL_TRUE) {
+        ABORT("Failed to initialize EGL (0x%x)", eglGetError());
+    }
+
+    const char* extensions = eglQueryString(this->display, EGL_EXTENSIONS);
+    if (!HasExtension(extensions, "EGL_KHR_surfaceless_context")) {
+        ABORT("EGL %d.%d doesn't support EGL_KHR_surfaceless_context", major, minor);
+    }
+
+    if (eglBindAPI(EGL_OPENGL_API) != EGL_TRUE) {
+        ABORT("EGL doesn't support desktop OpenGL (0x%x)", eglGetError());
+    }
+
+    // nothing is rendered to the config's surfaces, it only has to allow desktop OpenGL
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE,
+        EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE,
+        EGL_OPENGL_BIT,
+        EGL_NONE,
+    };
+
+    EGLConfig config;
+    EGLint    num_configs = 0;
+    if (eglChooseConfig(this->display, config_attribs, &config, 1, &num_configs) != EGL_TRUE
+        || num_configs == 0) {
+        ABORT("No EGL config supports desktop OpenGL (0x%x)", eglGetError());
+    }
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION,
+        4,
+        EGL_CONTEXT_MINOR_VERSION,
+        5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+
+    this->context = eglCreateContext(this->display, config, EGL_NO_CONTEXT, context_attribs);
+    if (this->context == EGL_NO_CONTEXT) {
+        ABORT("Failed to create an OpenGL 4.5 context (0x%x)", eglGetError());
+    }
+
+    if (eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context) != EGL_TRUE) {
+        ABORT("Failed to make the OpenGL context current (0x%x)", eglGetError());
+    }
+
+    // glewInit also loads GLX, which needs an X display, only the context's functions are needed
+    glewExperimental = GL_TRUE;
+    if (glewContextInit() != GLEW_OK) {
+        ABORT("Failed to initialize GLEW\n");
+    }
+
+    LOG_INFO("EGL %d.%d initialized, %s", major, minor, (const char*)glGetString(GL_RENDERER));
+
+    this->color.Reserve();
+    this->color.Setup(GL_RGBA8, (GLsizei)width, (GLsizei)height);
+
+    this->fbo.Reserve();
+    this->fbo.Attach(this->color, GL_COLOR_ATTACHMENT0);
+    this->fbo.CheckComplete();
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    this->fbo.Delete();
+    this->color.Delete();
+
+    eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(this->display, this->context);
+    eglTerminate(this->display);
+}
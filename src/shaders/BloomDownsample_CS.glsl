@@ -0,0 +1,152 @@
+/*
+#version 450 core
+*/
+
+// Builds the whole bloom mip chain in a single dispatch, in the style of AMD's single pass
+// downsampler. Every workgroup owns a 64x64 tile of the first mip: each invocation filters a 4x4
+// block of it from the source and reduces that in registers to one texel of the third mip, the
+// rest of the chain is reduced through shared memory. A tile covers a 2x2 block of the last mip,
+// so workgroups never wait on each other
+// Past the first mip, every texel is the average of the 2x2 texels it covers in the mip above
+
+// NOTE: must match Renderer_Bloom
+#define MIP_COUNT 6
+#define TILE_SIZE 64
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// every mip of the chain, the first is half the resolution of the source
+layout(r11f_g11f_b10f, binding = 0) uniform writeonly image2D g_mips[MIP_COUNT];
+
+// Remember to add bilinear minification filter for this texture!
+// Remember to use edge clamping for this texture!
+uniform sampler2D g_tex_input;
+uniform vec2      g_texel_size; // of the source
+// the chain covers the part of the source that was rendered to, which starts at the origin
+uniform vec2 g_uv_scale;
+uniform vec2 g_uv_max; // center of the last rendered texel
+
+// third mip of the tile, reduced in place a level at a time
+shared vec3 s_tile[16][16];
+
+float Luma(vec3 color)
+{
+    return dot(color, vec3(1.0 / 3.0, 1.0 / 3.0, 1.0 / 3.0));
+}
+
+vec3 SampleSource(vec2 uv)
+{
+    return textureLod(g_tex_input, min(uv, g_uv_max), 0.0).rgb;
+}
+
+float KarisAverage(vec3 color)
+{
+    return 1.0 / (1.0 + Luma(color));
+}
+
+// 13 tap downsample of the source with a Karis average against fireflies, as taken from Call Of
+// Duty method, presented at ACM Siggraph 2014
+vec3 DownsampleSource(vec2 uv)
+{
+    float x = g_texel_size.x;
+    float y = g_texel_size.y;
+
+    // Take 13 samples around current texel:
+    // a - b - c
+    // - j - k -
+    // d - e - f
+    // - l - m -
+    // g - h - i
+    // === ('e' is the current texel) ===
+    vec3 a = SampleSource(vec2(uv.x - 2 * x, uv.y + 2 * y));
+    vec3 b = SampleSource(vec2(uv.x, uv.y + 2 * y));
+    vec3 c = SampleSource(vec2(uv.x + 2 * x, uv.y + 2 * y));
+
+    vec3 d = SampleSource(vec2(uv.x - 2 * x, uv.y));
+    vec3 e = SampleSource(vec2(uv.x, uv.y));
+    vec3 f = SampleSource(vec2(uv.x + 2 * x, uv.y));
+
+    vec3 g = SampleSource(vec2(uv.x - 2 * x, uv.y - 2 * y));
+    vec3 h = SampleSource(vec2(uv.x, uv.y - 2 * y));
+    vec3 i = SampleSource(vec2(uv.x + 2 * x, uv.y - 2 * y));
+
+    vec3 j = SampleSource(vec2(uv.x - x, uv.y + y));
+    vec3 k = SampleSource(vec2(uv.x + x, uv.y + y));
+    vec3 l = SampleSource(vec2(uv.x - x, uv.y - y));
+    vec3 m = SampleSource(vec2(uv.x + x, uv.y - y));
+
+    vec3 s1 = 0.25 * (a + b + d + e);
+    vec3 s2 = 0.25 * (b + c + e + f);
+    vec3 s3 = 0.25 * (d + e + g + h);
+    vec3 s4 = 0.25 * (e + f + h + i);
+    vec3 s5 = 0.25 * (j + k + l + m);
+
+    float s1w = KarisAverage(s1);
+    float s2w = KarisAverage(s2);
+    float s3w = KarisAverage(s3);
+    float s4w = KarisAverage(s4);
+    float s5w = KarisAverage(s5);
+
+    vec3 karis_avg = s1w * s1 + s2w * s2 + s3w * s3 + s4w * s4 + s5w * s5;
+    karis_avg /= s1w + s2w + s3w + s4w + s5w;
+
+    return max(karis_avg, 0.0001);
+}
+
+void main()
+{
+    ivec2 tile  = ivec2(gl_WorkGroupID.xy);
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+
+    // first and second mip, texels outside of a mip are dropped by imageStore
+    vec3 sum_2 = vec3(0.0);
+    for (int qy = 0; qy < 2; qy++) {
+        for (int qx = 0; qx < 2; qx++) {
+            ivec2 texel_1 = tile * (TILE_SIZE >> 1) + local * 2 + ivec2(qx, qy);
+
+            vec3 sum_1 = vec3(0.0);
+            for (int py = 0; py < 2; py++) {
+                for (int px = 0; px < 2; px++) {
+                    ivec2 texel_0 = texel_1 * 2 + ivec2(px, py);
+                    vec3  color   = DownsampleSource(
+                        (vec2(texel_0) * 2.0 + 1.0) * g_texel_size * g_uv_scale);
+
+                    imageStore(g_mips[0], texel_0, vec4(color, 1.0));
+                    sum_1 += color;
+                }
+            }
+
+            imageStore(g_mips[1], texel_1, vec4(sum_1 * 0.25, 1.0));
+            sum_2 += sum_1 * 0.25;
+        }
+    }
+
+    // third mip, one texel per invocation
+    vec3 color = sum_2 * 0.25;
+    imageStore(g_mips[2], tile * (TILE_SIZE >> 2) + local, vec4(color, 1.0));
+    s_tile[local.y][local.x] = color;
+
+    // the rest of the chain, each level is reduced by a quarter of the invocations of the last
+    for (int mip = 3; mip < MIP_COUNT; mip++) {
+        int  size      = TILE_SIZE >> mip;
+        bool is_active = all(lessThan(local, ivec2(size)));
+
+        memoryBarrierShared();
+        barrier();
+
+        if (is_active) {
+            ivec2 src = local * 2;
+            vec3  sum = s_tile[src.y][src.x] + s_tile[src.y][src.x + 1];
+            sum += s_tile[src.y + 1][src.x] + s_tile[src.y + 1][src.x + 1];
+            color = sum * 0.25;
+        }
+
+        memoryBarrierShared();
+        barrier();
+
+        if (is_active) {
+            s_tile[local.y][local.x] = color;
+            imageStore(g_mips[mip], tile * size + local, vec4(color, 1.0));
+        }
+    }
+}
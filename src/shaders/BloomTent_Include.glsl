@@ -0,0 +1,33 @@
+// Upsampling filter of the bloom chain, as taken from Call Of Duty method, presented at ACM
+// Siggraph 2014. The radius is in texture coordinates, so it varies across mip resolutions
+vec3 UpsampleTent(sampler2D chain, vec2 uv, float mip, float radius)
+{
+    float x = radius;
+    float y = radius;
+
+    // Take 9 samples around current texel:
+    // a - b - c
+    // d - e - f
+    // g - h - i
+    // === ('e' is the current texel) ===
+    vec3 a = textureLod(chain, vec2(uv.x - x, uv.y + y), mip).rgb;
+    vec3 b = textureLod(chain, vec2(uv.x, uv.y + y), mip).rgb;
+    vec3 c = textureLod(chain, vec2(uv.x + x, uv.y + y), mip).rgb;
+
+    vec3 d = textureLod(chain, vec2(uv.x - x, uv.y), mip).rgb;
+    vec3 e = textureLod(chain, vec2(uv.x, uv.y), mip).rgb;
+    vec3 f = textureLod(chain, vec2(uv.x + x, uv.y), mip).rgb;
+
+    vec3 g = textureLod(chain, vec2(uv.x - x, uv.y - y), mip).rgb;
+    vec3 h = textureLod(chain, vec2(uv.x, uv.y - y), mip).rgb;
+    vec3 i = textureLod(chain, vec2(uv.x + x, uv.y - y), mip).rgb;
+
+    // Apply weighted distribution, by using a 3x3 tent filter:
+    //  1   | 1 2 1 |
+    // -- * | 2 4 2 |
+    // 16   | 1 2 1 |
+    vec3 color = e * 4.0;
+    color += (b + d + f + h) * 2.0;
+    color += (a + c + g + i);
+    return color * (1.0 / 16.0);
+}
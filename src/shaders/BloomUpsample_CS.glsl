@@ -0,0 +1,31 @@
+/*
+#version 450 core
+*/
+
+// Adds the upsampled g_src_mip of the bloom chain to the mip above it, which is bound as g_dst
+
+#include "BloomTent_Include.glsl"
+
+// NOTE: must match Renderer_Bloom::UPSAMPLE_GROUP_SIZE
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r11f_g11f_b10f, binding = 0) uniform image2D g_dst;
+
+uniform sampler2D g_tex_chain;
+uniform int       g_src_mip;
+uniform float     g_radius;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size  = imageSize(g_dst);
+    if (any(greaterThanEqual(texel, size))) {
+        return;
+    }
+
+    vec2 uv    = (vec2(texel) + 0.5) / vec2(size);
+    vec3 color = imageLoad(g_dst, texel).rgb;
+    color += UpsampleTent(g_tex_chain, uv, float(g_src_mip), g_radius);
+
+    imageStore(g_dst, texel, vec4(color, 1.0));
+}
@@ -0,0 +1,6 @@
+// NOTE: must match MultiDrawBatch::GPU_Draw
+struct DrawData {
+    mat4 mtx_world;
+    mat4 mtx_normal; // mat3 padded to a mat4
+    uint material_id;
+};
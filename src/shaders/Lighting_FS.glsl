@@ -1,63 +1,69 @@
 /*
 #version 450 core
 
-#define AMBIENT_LIGHT 0
-#define POINT_LIGHT   1
-#define SPOT_LIGHT    2
-#define SUN_LIGHT     3
+#define LIGHT_TYPE AMBIENT_LIGHT
+
+#define MATERIAL_BINDLESS 0
+#define MULTI_DRAW        0
+#define NORMAL_MAP        1
+#define SPECULAR_MAP      1
 */
 
+#if MATERIAL_BINDLESS
+#    extension GL_ARB_bindless_texture : require
+#endif
+
 #define PI 3.14159265
 
+// NOTE: must match MaterialTable::GPU_Material
 struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
-    sampler2D normal;
-    float     gloss;
-};
-
-struct PointLight {
-    vec3 pos;
-
-    vec3 color;
+    uvec2 diffuse; // bindless handle, or (texture array, layer)
+    uvec2 specular;
+    uvec2 normal;
+    float gloss;
 };
 
-struct SpotLight {
-    vec3  pos;
-    vec3  dir;          // must be pre-normalized
-    float inner_cutoff; // dot(dir, inner_dir)
-    float outer_cutoff; // dot(dit, outer_dir)
+#include "Lights_Include.glsl"
 
-    vec3 color;
-};
+// NOTE: must match SunLight::MAX_SHADOW_CASCADES
+#define MAX_SHADOW_CASCADES 4
 
-struct SunLight {
-    vec3 dir; // must be pre-normalized
+// how far the shadow map lookup is pushed out along the normal, in shadow map texels
+#define SHADOW_NORMAL_OFFSET 1.5
 
-    vec3 color;
-};
+// NOTE: must match MaterialTable
+#define MAX_TEXTURE_ARRAYS 8
 
-struct AmbientLight {
-    vec3 color;
-};
+// NOTE: must match Renderer_ClusteredLighting
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
 
 // in
 #if LIGHT_TYPE != AMBIENT_LIGHT
-in vec3 vo_light_dir;
-in vec3 vo_view_dir;
+layout(location = 0) in vec3 vo_view_dir;
+#endif
+#if LIGHT_TYPE == CLUSTERED_LIGHT
+layout(location = 1) in mat3 vo_mtx_tbn; // world -> tangent, takes locations 1-3
+#elif LIGHT_TYPE != AMBIENT_LIGHT
+layout(location = 1) in vec3 vo_light_dir;
+#endif
+layout(location = 4) in vec3 vo_vtx_pos;
+layout(location = 5) in vec3 vo_vtx_normal;
+layout(location = 6) in vec2 vo_vtx_texcoord;
+#if LIGHT_TYPE == SUN_LIGHT || LIGHT_TYPE == POINT_LIGHT
+layout(location = 7) in vec3 vo_world_normal;
+#endif
+#if MULTI_DRAW
+// NOTE: constant within a draw, so indexing the material table with it is dynamically uniform in
+// practice
+layout(location = 8) flat in uint vo_material_id;
 #endif
-in vec3 vo_vtx_pos;
-in vec3 vo_vtx_normal;
-in vec2 vo_vtx_texcoord;
 
 // out
-out vec4 fo_color;
+layout(location = 0) out vec4 fo_color;
 
 // uniform
-uniform mat3 g_mtx_normal; // normal -> world
-uniform mat4 g_mtx_world;  // obj    -> world
-uniform mat4 g_mtx_wvp;    // obj    -> screen
-
 layout(std140, binding = 0) uniform Shared
 {
     mat4 g_mtx_vp;
@@ -66,20 +72,66 @@ layout(std140, binding = 0) uniform Shared
     vec3 g_pos_view;
 };
 
-uniform Material g_material;
+// NOTE: must match MaterialTable
+layout(std430, binding = 4) readonly buffer Materials
+{
+    Material g_materials[];
+};
+
+#if !MULTI_DRAW
+uniform uint g_material_id;
+#endif
+
+#if !MATERIAL_BINDLESS
+uniform sampler2DArray g_material_arrays[MAX_TEXTURE_ARRAYS];
+#endif
 
 #if LIGHT_TYPE == SUN_LIGHT
 uniform SunLight g_light_source;
 
+// NOTE: must match CascadedShadowMap
+uniform sampler2DArrayShadow g_shadow_cascades;
+
+uniform uint g_cascade_count;                     // 0 if the light uses shadow volumes
+uniform mat4 g_mtx_cascades[MAX_SHADOW_CASCADES]; // world -> shadow map texture space
+uniform vec4 g_cascade_splits;                    // view space depth where each cascade ends
+uniform vec4 g_cascade_texel_sizes;               // world space size of a shadow map texel
+
 #elif LIGHT_TYPE == AMBIENT_LIGHT
 uniform AmbientLight g_light_source;
 
 #elif LIGHT_TYPE == POINT_LIGHT
 uniform PointLight g_light_source;
 
+// NOTE: must match CubeShadowMapCache
+uniform samplerCubeArrayShadow g_shadow_cube;
+
+uniform int   g_shadow_layer;       // -1 if the light uses shadow volumes
+uniform float g_shadow_radius;      // distances in the map are normalized by this
+uniform float g_shadow_texel_angle; // angular size of a shadow map texel (approximately)
+
 #elif LIGHT_TYPE == SPOT_LIGHT
 uniform SpotLight g_light_source;
 
+#elif LIGHT_TYPE == CLUSTERED_LIGHT
+layout(std430, binding = 1) readonly buffer ClusteredLights
+{
+    ClusteredLight g_cluster_lights[];
+};
+
+layout(std430, binding = 2) readonly buffer ClusterGrid
+{
+    uvec2 g_clusters[]; // (offset, count) into g_cluster_indices
+};
+
+layout(std430, binding = 3) readonly buffer ClusterIndices
+{
+    uint g_cluster_indices[];
+};
+
+uniform vec2 g_cluster_tile_size;    // size of a cluster in pixels
+uniform vec2 g_cluster_depth_params; // slice = log(depth) * x - y
+
 #endif
 
 // Phong lighting model
@@ -141,6 +193,17 @@ float ComputeLightFalloff(vec3 light_pos, vec3 frag_pos)
     return falloff;
 }
 
+// Inverse square falloff, windowed so that it reaches zero at the light's radius
+float ComputeWindowedLightFalloff(vec3 light_pos, float light_radius, vec3 frag_pos)
+{
+    float frag2light_dist2 = distance2(light_pos, frag_pos);
+
+    float window = 1.0 - pow(frag2light_dist2 / (light_radius * light_radius), 2.0);
+    window       = clamp(window, 0.0, 1.0);
+
+    return window * window / (1.0 + frag2light_dist2);
+}
+
 // Light source computation
 #if LIGHT_TYPE == AMBIENT_LIGHT
 vec3 ComputeLighting(
@@ -157,6 +220,23 @@ vec3 ComputeLighting(
 #endif
 
 #if LIGHT_TYPE == POINT_LIGHT
+// Fraction of the point light's light reaching the fragment, filtered by the bilinear depth
+// comparison done by the sampler
+float ComputePointShadow(vec3 frag_pos, vec3 frag_world_normal)
+{
+    if (g_shadow_layer < 0) {
+        return 1.0;
+    }
+
+    // texels get bigger with distance from the light, so does the normal offset
+    float frag_dist  = length(frag_pos - g_light_source.pos);
+    float offset     = frag_dist * g_shadow_texel_angle * SHADOW_NORMAL_OFFSET;
+    vec3  light2frag = frag_pos + frag_world_normal * offset - g_light_source.pos;
+    float ref_depth  = min(length(light2frag) / g_shadow_radius, 1.0);
+
+    return texture(g_shadow_cube, vec4(light2frag, float(g_shadow_layer)), ref_depth);
+}
+
 vec3 ComputeLighting(
     PointLight light,
     vec3       frag_diffuse,
@@ -170,6 +250,7 @@ vec3 ComputeLighting(
     vec3 frag2light_dir = vo_light_dir;
 
     float dist_falloff = ComputeLightFalloff(light.pos, frag_pos);
+    float shadow       = ComputePointShadow(frag_pos, vo_world_normal);
 
     // specular + diffuse light contribution
     vec3 diffuse_light  = ComputeDiffuseLight(light.color, frag_diffuse, frag_norm, frag2light_dir);
@@ -180,7 +261,7 @@ vec3 ComputeLighting(
         frag_norm,
         frag2light_dir,
         frag2view_dir);
-    vec3 total_light = dist_falloff * (diffuse_light + specular_light);
+    vec3 total_light = shadow * dist_falloff * (diffuse_light + specular_light);
 
     return total_light;
 }
@@ -225,6 +306,43 @@ vec3 ComputeLighting(
 #endif
 
 #if LIGHT_TYPE == SUN_LIGHT
+// Fraction of the sun's light reaching the fragment, a 3x3 kernel on top of the bilinear depth
+// comparison done by the sampler
+float ComputeSunShadow(vec3 frag_pos, vec3 frag_world_normal)
+{
+    if (g_cascade_count == 0) {
+        return 1.0;
+    }
+
+    float frag_depth = -(g_mtx_view * vec4(frag_pos, 1.0)).z;
+
+    uint cascade = 0;
+    while (cascade < g_cascade_count && frag_depth > g_cascade_splits[cascade]) {
+        cascade++;
+    }
+
+    // past the last cascade
+    if (cascade == g_cascade_count) {
+        return 1.0;
+    }
+
+    // offset along the normal scaled by the texel size avoids acne without peter panning
+    float offset     = g_cascade_texel_sizes[cascade] * SHADOW_NORMAL_OFFSET;
+    vec4  shadow_pos = g_mtx_cascades[cascade] * vec4(frag_pos + frag_world_normal * offset, 1.0);
+    float ref_depth  = min(shadow_pos.z, 1.0);
+
+    vec2  texel_size = 1.0 / vec2(textureSize(g_shadow_cascades, 0).xy);
+    float lit        = 0.0;
+    for (int yy = -1; yy <= 1; yy++) {
+        for (int xx = -1; xx <= 1; xx++) {
+            vec2 uv = shadow_pos.xy + vec2(xx, yy) * texel_size;
+            lit += texture(g_shadow_cascades, vec4(uv, float(cascade), ref_depth));
+        }
+    }
+
+    return lit / 9.0;
+}
+
 vec3 ComputeLighting(
     SunLight light,
     vec3     frag_diffuse,
@@ -245,23 +363,111 @@ vec3 ComputeLighting(
         frag_norm,
         frag2light_dir,
         frag2view_dir);
-    vec3 total_light = diffuse_light + specular_light;
+    float shadow      = ComputeSunShadow(frag_pos, vo_world_normal);
+    vec3  total_light = shadow * (diffuse_light + specular_light);
 
     return total_light;
 }
 #endif
 
+#if LIGHT_TYPE == CLUSTERED_LIGHT
+uint ComputeClusterIndex(vec3 frag_pos)
+{
+    float frag_depth = -(g_mtx_view * vec4(frag_pos, 1.0)).z;
+    float slice      = log(frag_depth) * g_cluster_depth_params.x - g_cluster_depth_params.y;
+
+    uvec3 cluster = uvec3(gl_FragCoord.xy / g_cluster_tile_size, max(slice, 0.0));
+    cluster       = min(cluster, uvec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+
+    return cluster.x + CLUSTER_X * (cluster.y + CLUSTER_Y * cluster.z);
+}
+
+vec3 ComputeClusteredLighting(
+    vec3  frag_diffuse,
+    vec3  frag_specular,
+    vec3  frag_norm,
+    float frag_gloss,
+    vec3  frag_pos,
+    vec3  view_pos)
+{
+    vec3  frag2view_dir = vo_view_dir;
+    uvec2 cluster       = g_clusters[ComputeClusterIndex(frag_pos)];
+
+    vec3 total_light = vec3(0.0);
+    for (uint ii = cluster.x; ii < cluster.x + cluster.y; ii++) {
+        ClusteredLight light = g_cluster_lights[g_cluster_indices[ii]];
+
+        vec3  light_pos    = light.pos_radius.xyz;
+        float light_radius = light.pos_radius.w;
+
+        if (distance2(light_pos, frag_pos) >= light_radius * light_radius) {
+            continue;
+        }
+
+        vec3  frag2light_dir = normalize(vo_mtx_tbn * (light_pos - frag_pos));
+        float dist_falloff   = ComputeWindowedLightFalloff(light_pos, light_radius, frag_pos);
+
+        vec3 diffuse_light
+            = ComputeDiffuseLight(light.color.rgb, frag_diffuse, frag_norm, frag2light_dir);
+        vec3 specular_light = ComputeSpecularLight(
+            light.color.rgb,
+            frag_specular,
+            frag_gloss,
+            frag_norm,
+            frag2light_dir,
+            frag2view_dir);
+        total_light += dist_falloff * (diffuse_light + specular_light);
+    }
+
+    return total_light;
+}
+#endif
+
+vec4 SampleMaterial(uvec2 texture_ref, vec2 texcoord)
+{
+#if MATERIAL_BINDLESS
+    return texture(sampler2D(texture_ref), texcoord);
+#else
+    return texture(g_material_arrays[texture_ref.x], vec3(texcoord, float(texture_ref.y)));
+#endif
+}
+
 // Main program
 void main()
 {
-    vec4  frag_diffuse  = texture(g_material.diffuse, vo_vtx_texcoord);
-    vec4  frag_specular = texture(g_material.specular, vo_vtx_texcoord);
-    vec3  frag_normal   = 2.0 * texture(g_material.normal, vo_vtx_texcoord).rgb - 1.0;
-    float frag_gloss    = g_material.gloss;
+#if MULTI_DRAW
+    Material material = g_materials[vo_material_id];
+#else
+    Material material = g_materials[g_material_id];
+#endif
+
+    vec4  frag_diffuse  = SampleMaterial(material.diffuse, vo_vtx_texcoord);
+    float frag_gloss    = material.gloss;
+
+    // variants that don't use a texture skip sampling it
+#if SPECULAR_MAP
+    vec4 frag_specular = SampleMaterial(material.specular, vo_vtx_texcoord);
+#else
+    vec4 frag_specular = vec4(0.0);
+#endif
+#if NORMAL_MAP
+    vec3 frag_normal = 2.0 * SampleMaterial(material.normal, vo_vtx_texcoord).rgb - 1.0;
+#else
+    vec3 frag_normal = vec3(0.0, 0.0, 1.0); // unperturbed, in tangent space
+#endif
 
     if (frag_diffuse.a < 0.5) {
         discard;
     } else {
+#if LIGHT_TYPE == CLUSTERED_LIGHT
+        vec3 light_color = ComputeClusteredLighting(
+            frag_diffuse.rgb,
+            frag_specular.rgb,
+            frag_normal,
+            frag_gloss,
+            vo_vtx_pos,
+            g_pos_view);
+#else
         vec3 light_color = ComputeLighting(
             g_light_source,
             frag_diffuse.rgb,
@@ -270,6 +476,7 @@ void main()
             frag_gloss,
             vo_vtx_pos,
             g_pos_view);
+#endif
 
         fo_color = vec4(light_color, 1.0);
     }
@@ -1,36 +1,18 @@
 /*
 #version 450 core
 
-#define AMBIENT_LIGHT 0
-#define POINT_LIGHT   1
-#define SPOT_LIGHT    2
-#define SUN_LIGHT     3
-*/
-
-struct PointLight {
-    vec3 pos;
-
-    vec3 color;
-};
+#define LIGHT_TYPE AMBIENT_LIGHT
 
-struct SpotLight {
-    vec3  pos;
-    vec3  dir;          // must be pre-normalized
-    float inner_cutoff; // dot(dir, inner_dir)
-    float outer_cutoff; // dot(dit, outer_dir)
-
-    vec3 color;
-};
-
-struct SunLight {
-    vec3 dir; // must be pre-normalized
+#define MULTI_DRAW      0
+#define OBJECT_UNIFORMS 0
+*/
 
-    vec3 color;
-};
+#if MULTI_DRAW
+#    extension GL_ARB_shader_draw_parameters : require
+#endif
 
-struct AmbientLight {
-    vec3 color;
-};
+#include "DrawData_Include.glsl"
+#include "Lights_Include.glsl"
 
 // in
 layout(location = 0) in vec3 vi_vtx_pos;
@@ -40,13 +22,24 @@ layout(location = 3) in vec3 vi_vtx_bitangent;
 layout(location = 4) in vec2 vi_vtx_texcoord;
 
 // out
+// NOTE: locations must match Lighting_FS
 #if LIGHT_TYPE != AMBIENT_LIGHT
-out vec3 vo_light_dir;
-out vec3 vo_view_dir;
+layout(location = 0) out vec3 vo_view_dir;
+#endif
+#if LIGHT_TYPE == CLUSTERED_LIGHT
+layout(location = 1) out mat3 vo_mtx_tbn; // world -> tangent, takes locations 1-3
+#elif LIGHT_TYPE != AMBIENT_LIGHT
+layout(location = 1) out vec3 vo_light_dir;
+#endif
+layout(location = 4) out vec3 vo_vtx_pos;
+layout(location = 5) out vec3 vo_vtx_normal;
+layout(location = 6) out vec2 vo_vtx_texcoord;
+#if LIGHT_TYPE == SUN_LIGHT || LIGHT_TYPE == POINT_LIGHT
+layout(location = 7) out vec3 vo_world_normal; // for the shadow map normal offset
+#endif
+#if MULTI_DRAW
+layout(location = 8) flat out uint vo_material_id;
 #endif
-out vec3 vo_vtx_pos;
-out vec3 vo_vtx_normal;
-out vec2 vo_vtx_texcoord;
 
 // uniform
 layout(std140, binding = 0) uniform Shared
@@ -57,9 +50,25 @@ layout(std140, binding = 0) uniform Shared
     vec3 g_pos_view;
 };
 
+#if MULTI_DRAW
+// NOTE: must match MultiDrawBatch
+layout(std430, binding = 5) readonly buffer Draws
+{
+    DrawData g_draws[];
+};
+#elif OBJECT_UNIFORMS
+// NOTE: must match ObjectUniformRing
+layout(std140, binding = 1) uniform Object
+{
+    mat4 g_mtx_world;  // obj    -> world
+    mat4 g_mtx_wvp;    // obj    -> screen
+    mat3 g_mtx_normal; // normal -> world
+};
+#else
 uniform mat3 g_mtx_normal; // normal -> world
 uniform mat4 g_mtx_world;  // obj    -> world
 uniform mat4 g_mtx_wvp;    // obj    -> screen
+#endif
 
 #if LIGHT_TYPE == SUN_LIGHT
 uniform SunLight g_light_source;
@@ -75,36 +84,67 @@ uniform SpotLight g_light_source;
 
 #endif
 
+// transforms of the current draw, also forwards its material to the fragment shader
+void LoadDraw(out mat4 mtx_world, out mat3 mtx_normal, out mat4 mtx_wvp)
+{
+#if MULTI_DRAW
+    DrawData draw = g_draws[gl_DrawIDARB];
+
+    mtx_world      = draw.mtx_world;
+    mtx_normal     = mat3(draw.mtx_normal);
+    mtx_wvp        = g_mtx_vp * draw.mtx_world;
+    vo_material_id = draw.material_id;
+#else
+    mtx_world  = g_mtx_world;
+    mtx_normal = g_mtx_normal;
+    mtx_wvp    = g_mtx_wvp;
+#endif
+}
+
 #if LIGHT_TYPE != AMBIENT_LIGHT
 void main()
 {
-    vec3 tangent   = normalize(g_mtx_normal * vi_vtx_tangent);
-    vec3 bitangent = normalize(g_mtx_normal * vi_vtx_bitangent);
-    vec3 normal    = normalize(g_mtx_normal * vi_vtx_normal);
+    mat4 mtx_world, mtx_wvp;
+    mat3 mtx_normal;
+    LoadDraw(mtx_world, mtx_normal, mtx_wvp);
+
+    vec3 tangent   = normalize(mtx_normal * vi_vtx_tangent);
+    vec3 bitangent = normalize(mtx_normal * vi_vtx_bitangent);
+    vec3 normal    = normalize(mtx_normal * vi_vtx_normal);
     mat3 mtx_tbn   = transpose(mat3(tangent, bitangent, normal));
 
-    vec3 vtx_pos    = vec3(g_mtx_world * vec4(vi_vtx_pos, 1.0));
+    vec3 vtx_pos    = vec3(mtx_world * vec4(vi_vtx_pos, 1.0));
     vo_vtx_pos      = vtx_pos;
     vo_vtx_normal   = normalize(mtx_tbn * normal);
     vo_vtx_texcoord = vi_vtx_texcoord;
     vo_view_dir     = normalize(mtx_tbn * (g_pos_view - vtx_pos));
 
 #    if LIGHT_TYPE == SUN_LIGHT
-    vo_light_dir = normalize(mtx_tbn * -g_light_source.dir);
+    vo_light_dir    = normalize(mtx_tbn * -g_light_source.dir);
+    vo_world_normal = normal;
+#    elif LIGHT_TYPE == CLUSTERED_LIGHT
+    vo_mtx_tbn = mtx_tbn;
 #    else
     vo_light_dir = normalize(mtx_tbn * (g_light_source.pos - vtx_pos));
 #    endif
+#    if LIGHT_TYPE == POINT_LIGHT
+    vo_world_normal = normal;
+#    endif
 
-    gl_Position = g_mtx_wvp * vec4(vi_vtx_pos, 1.0);
+    gl_Position = mtx_wvp * vec4(vi_vtx_pos, 1.0);
 }
 #else
 
 void main()
 {
-    vo_vtx_pos      = vec3(g_mtx_world * vec4(vi_vtx_pos, 1.0));
-    vo_vtx_normal   = g_mtx_normal * vi_vtx_normal;
+    mat4 mtx_world, mtx_wvp;
+    mat3 mtx_normal;
+    LoadDraw(mtx_world, mtx_normal, mtx_wvp);
+
+    vo_vtx_pos      = vec3(mtx_world * vec4(vi_vtx_pos, 1.0));
+    vo_vtx_normal   = mtx_normal * vi_vtx_normal;
     vo_vtx_texcoord = vi_vtx_texcoord;
 
-    gl_Position = g_mtx_wvp * vec4(vi_vtx_pos, 1.0);
+    gl_Position = mtx_wvp * vec4(vi_vtx_pos, 1.0);
 }
 #endif
@@ -0,0 +1,39 @@
+// Light types and the layouts of the light sources, shared by every shader built per light type
+
+// NOTE: must match LightType
+#define AMBIENT_LIGHT   0
+#define POINT_LIGHT     1
+#define SPOT_LIGHT      2
+#define SUN_LIGHT       3
+#define CLUSTERED_LIGHT 4
+
+struct PointLight {
+    vec3 pos;
+
+    vec3 color;
+};
+
+struct SpotLight {
+    vec3  pos;
+    vec3  dir;          // must be pre-normalized
+    float inner_cutoff; // dot(dir, inner_dir)
+    float outer_cutoff; // dot(dit, outer_dir)
+
+    vec3 color;
+};
+
+struct SunLight {
+    vec3 dir; // must be pre-normalized
+
+    vec3 color;
+};
+
+struct AmbientLight {
+    vec3 color;
+};
+
+// NOTE: must match Renderer_ClusteredLighting::GPU_Light
+struct ClusteredLight {
+    vec4 pos_radius;
+    vec4 color;
+};
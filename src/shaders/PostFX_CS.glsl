@@ -0,0 +1,194 @@
+/*
+#version 450 core
+
+#define BLOOM      1
+#define SHARPEN    1
+#define TONEMAPPER TONEMAP_ACES_APPROX
+*/
+
+// Every post processing step in one pass: bloom composite, tonemapping, sharpening and gamma
+// correction. Each workgroup composites and tonemaps its tile plus a one texel apron into shared
+// memory, which the sharpening filter then reads its neighborhoods from
+
+#include "BloomTent_Include.glsl"
+
+// NOTE: must match Renderer_PostFX
+#define TONEMAP_REINHARD    0
+#define TONEMAP_ACES_APPROX 1
+#define TONEMAP_CLAMP       2
+
+#define GROUP_SIZE 16
+#define APRON_SIZE (GROUP_SIZE + 2)
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout(rgba8, binding = 0) uniform writeonly image2D g_output;
+
+uniform sampler2D g_tex_hdr;
+uniform vec2      g_texel_size; // of the output
+uniform float     g_gamma;
+
+// the part of the source that was rendered to, which starts at the origin, is upscaled to the
+// whole output
+uniform vec2 g_uv_scale;
+uniform vec2 g_uv_max; // center of the last rendered texel
+
+#if BLOOM
+uniform sampler2D g_tex_bloom; // the mip chain
+uniform float     g_bloom_strength;
+uniform float     g_bloom_radius;
+#endif
+
+#if SHARPEN
+uniform float g_sharpen_strength;
+
+// tonemapped colors of the tile and its apron
+shared vec3 s_tile[APRON_SIZE][APRON_SIZE];
+#endif
+
+vec3 Tonemap_Reinhard(vec3 hdr)
+{
+    return hdr / (hdr + vec3(1.0));
+}
+
+vec3 Tonemap_AcesApprox(vec3 hdr)
+{
+    const vec3 a = vec3(2.51);
+    const vec3 b = vec3(0.03);
+    const vec3 c = vec3(2.43);
+    const vec3 d = vec3(0.59);
+    const vec3 e = vec3(0.14);
+
+    vec3 numer = hdr * (a * hdr + b);
+    vec3 denom = hdr * (c * hdr + d) + e;
+    return clamp(numer / denom, 0.0, 1.0);
+}
+
+vec3 Tonemap_Clamp(vec3 hdr)
+{
+    return clamp(hdr, 0, 1);
+}
+
+vec3 Tonemap(vec3 hdr)
+{
+#if TONEMAPPER == TONEMAP_REINHARD
+    return Tonemap_Reinhard(hdr);
+#elif TONEMAPPER == TONEMAP_ACES_APPROX
+    return Tonemap_AcesApprox(hdr);
+#else
+    return Tonemap_Clamp(hdr);
+#endif
+}
+
+// the bloom composite finishes the upsample chain, the first mip is mixed in along with the
+// upsampled second mip without either being written back
+vec3 Composite(ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), imageSize(g_output) - 1);
+
+    // bilinear upscale, at full scale this lands on the texel centers
+    vec2 uv  = (vec2(texel) + 0.5) * g_texel_size;
+    vec3 hdr = textureLod(g_tex_hdr, min(uv * g_uv_scale, g_uv_max), 0.0).rgb;
+
+#if BLOOM
+    vec3 bloom = textureLod(g_tex_bloom, uv, 0.0).rgb
+                 + UpsampleTent(g_tex_bloom, uv, 1.0, g_bloom_radius);
+    hdr        = mix(hdr, bloom, vec3(g_bloom_strength));
+#endif
+
+    return clamp(Tonemap(hdr), 0.0, 1.0);
+}
+
+vec3 Min5(vec3 a, vec3 b, vec3 c, vec3 d, vec3 e)
+{
+    vec3 ab = min(a, b);
+    vec3 cd = min(c, d);
+    return min(min(ab, cd), e);
+}
+
+vec3 Max5(vec3 a, vec3 b, vec3 c, vec3 d, vec3 e)
+{
+    vec3 ab = max(a, b);
+    vec3 cd = max(c, d);
+    return max(max(ab, cd), e);
+}
+
+#if SHARPEN
+vec3 SampleTile(ivec2 local, int x_offset, int y_offset)
+{
+    ivec2 pos = local + 1 + ivec2(x_offset, y_offset);
+    return s_tile[pos.y][pos.x];
+}
+
+// this is based on Acerola's implementation:
+// https://github.com/GarrettGunnell/AcerolaFX/blob/main/Shaders/Includes/AcerolaFX_Sharpness.fxh
+vec3 ContrastAdaptiveSharpening(float strength, ivec2 local)
+{
+    float sharpness = -(1.0 / mix(10.0, 7.0, clamp(strength, 0.0, 1.0)));
+
+    /*
+     g h i
+     d e f
+     a b c
+    */
+
+    vec3 a = SampleTile(local, -1, -1);
+    vec3 b = SampleTile(local, 0, -1);
+    vec3 c = SampleTile(local, 1, -1);
+    vec3 d = SampleTile(local, -1, 0);
+    vec3 e = SampleTile(local, 0, 0);
+    vec3 f = SampleTile(local, 1, 0);
+    vec3 g = SampleTile(local, -1, 1);
+    vec3 h = SampleTile(local, 0, 1);
+    vec3 i = SampleTile(local, 1, 1);
+
+    vec3 min1    = Min5(d, e, f, b, h);
+    vec3 min2    = Min5(min1, a, c, g, i);
+    vec3 min_rgb = min1 + min2;
+
+    vec3 max1    = Max5(d, e, f, b, h);
+    vec3 max2    = Max5(max1, a, c, g, i);
+    vec3 max_rgb = max1 + max2;
+
+    vec3 inv_max_rgb = 1.0 / max_rgb;
+    vec3 amp         = min(min_rgb, 2.0 - max_rgb) * inv_max_rgb;
+    amp              = sqrt(clamp(amp, 0, 1));
+
+    vec3 w     = amp * sharpness;
+    vec3 inv_w = 1.0 / (1.0 + 4.0 * w);
+
+    vec3 total = w * (b + d + f + h) + e;
+    return clamp(total * inv_w, 0, 1);
+}
+#endif
+
+vec3 GammaCorrect(vec3 sdr, float gamma)
+{
+    return pow(sdr, vec3(1.0 / gamma));
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+
+#if SHARPEN
+    // the apron is loaded by the first invocations a second time round
+    ivec2 origin = ivec2(gl_WorkGroupID.xy) * GROUP_SIZE - 1;
+    for (int ii = int(gl_LocalInvocationIndex); ii < APRON_SIZE * APRON_SIZE;
+         ii += GROUP_SIZE * GROUP_SIZE) {
+        ivec2 pos            = ivec2(ii % APRON_SIZE, ii / APRON_SIZE);
+        s_tile[pos.y][pos.x] = Composite(origin + pos);
+    }
+
+    memoryBarrierShared();
+    barrier();
+
+    vec3 sdr = ContrastAdaptiveSharpening(g_sharpen_strength, local);
+#else
+    vec3 sdr = Composite(texel);
+#endif
+
+    // stores past the edge of the image are dropped
+    imageStore(g_output, texel, vec4(GammaCorrect(sdr, g_gamma), 1.0));
+}
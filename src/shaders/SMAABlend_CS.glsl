@@ -0,0 +1,57 @@
+/*
+#version 450 core
+*/
+
+// Last pass of SMAA: neighborhood blending. Each texel gathers the weights of the four edges around
+// it, its own bottom and left ones and the ones of the texels above and to the right, and blends
+// with the neighbors along whichever direction has the larger weight
+
+// NOTE: must match Renderer_SMAA
+#define GROUP_SIZE 8
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout(rgba8, binding = 0) uniform writeonly image2D g_output;
+
+uniform sampler2D g_tex_input;
+uniform sampler2D g_tex_weights;
+
+vec4 Weights(ivec2 texel)
+{
+    ivec2 size = textureSize(g_tex_weights, 0);
+    if (any(greaterThanEqual(texel, size))) {
+        return vec4(0.0);
+    }
+
+    return texelFetch(g_tex_weights, texel, 0);
+}
+
+vec3 Color(ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), textureSize(g_tex_input, 0) - 1);
+    return texelFetch(g_tex_input, texel, 0).rgb;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+    vec4  weights    = Weights(texel);
+    float from_below = weights.r;
+    float from_left  = weights.b;
+    float from_above = Weights(texel + ivec2(0, 1)).g;
+    float from_right = Weights(texel + ivec2(1, 0)).a;
+
+    vec3 color = Color(texel);
+
+    if (max(from_below, from_above) >= max(from_left, from_right)) {
+        color = color * (1.0 - from_below - from_above) + Color(texel + ivec2(0, -1)) * from_below
+                + Color(texel + ivec2(0, 1)) * from_above;
+    } else {
+        color = color * (1.0 - from_left - from_right) + Color(texel + ivec2(-1, 0)) * from_left
+                + Color(texel + ivec2(1, 0)) * from_right;
+    }
+
+    // stores past the edge of the image are dropped
+    imageStore(g_output, texel, vec4(color, 1.0));
+}
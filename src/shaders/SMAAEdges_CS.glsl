@@ -0,0 +1,56 @@
+/*
+#version 450 core
+*/
+
+// First pass of SMAA: luma edge detection with local contrast adaptation. Every texel stores the
+// edge between it and its left neighbor in r and the one between it and the neighbor below in g
+
+// NOTE: must match Renderer_SMAA
+#define GROUP_SIZE 8
+
+#define THRESHOLD                 0.1
+#define LOCAL_CONTRAST_ADAPTATION 2.0
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout(rg8, binding = 0) uniform writeonly image2D g_edges;
+
+uniform sampler2D g_tex_input; // gamma corrected
+
+float Luma(ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), textureSize(g_tex_input, 0) - 1);
+    return dot(texelFetch(g_tex_input, texel, 0).rgb, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+    float luma  = Luma(texel);
+    float left  = Luma(texel + ivec2(-1, 0));
+    float below = Luma(texel + ivec2(0, -1));
+
+    vec2 delta = abs(luma - vec2(left, below));
+    vec2 edges = step(THRESHOLD, delta);
+
+    if (edges.x + edges.y == 0.0) {
+        imageStore(g_edges, texel, vec4(0.0));
+        return;
+    }
+
+    // an edge next to a much stronger one is dropped, the stronger one is the one that's visible
+    float right       = Luma(texel + ivec2(1, 0));
+    float above       = Luma(texel + ivec2(0, 1));
+    float left_left   = Luma(texel + ivec2(-2, 0));
+    float below_below = Luma(texel + ivec2(0, -2));
+
+    vec2 max_delta = max(delta, abs(luma - vec2(right, above)));
+    max_delta      = max(max_delta, abs(vec2(left, below) - vec2(left_left, below_below)));
+
+    float final_delta = max(max_delta.x, max_delta.y);
+    edges *= step(final_delta, LOCAL_CONTRAST_ADAPTATION * delta);
+
+    // stores past the edge of the image are dropped
+    imageStore(g_edges, texel, vec4(edges, 0.0, 0.0));
+}
@@ -0,0 +1,133 @@
+/*
+#version 450 core
+*/
+
+// Second pass of SMAA: blend weights. Each edge is followed both ways to its ends, where the
+// crossing edges give the pattern the silhouette is revectorized into, and the area between that
+// silhouette and the edge over the texel is looked up from the precomputed area texture
+// Horizontal edges are at the bottom of a texel and go to r and g, vertical ones are at its left
+// and go to b and a. The first of each is how much the texel takes from its neighbor across the
+// edge, the second how much the neighbor takes from it
+
+// NOTE: must match Renderer_SMAA
+#define GROUP_SIZE   8
+#define MAX_DISTANCE 16
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout(rgba8, binding = 0) uniform writeonly image2D g_weights;
+
+uniform sampler2D g_tex_edges;
+uniform sampler2D g_tex_area;
+
+vec2 Edges(ivec2 texel)
+{
+    ivec2 size = textureSize(g_tex_edges, 0);
+    if (any(lessThan(texel, ivec2(0))) || any(greaterThanEqual(texel, size))) {
+        return vec2(0.0);
+    }
+
+    return texelFetch(g_tex_edges, texel, 0).rg;
+}
+
+// patterns are 0 for a crossing edge on the far side, 1 for none or both and 2 for the near side
+int Pattern(float near_side, float far_side)
+{
+    return int(near_side - far_side) + 1;
+}
+
+vec2 Area(int pattern_start, int pattern_end, int dist_start, int dist_end)
+{
+    ivec2 texel = ivec2(pattern_start, pattern_end) * MAX_DISTANCE + ivec2(dist_start, dist_end);
+    return texelFetch(g_tex_area, texel, 0).rg;
+}
+
+// the edge between the texel and the one below, the near side is the texel's row
+vec2 HorizontalWeights(ivec2 texel)
+{
+    int left = 0;
+    while (left < MAX_DISTANCE - 1) {
+        ivec2 end = texel - ivec2(left, 0);
+
+        // a crossing edge ends the line
+        bool is_crossed = Edges(end).r + Edges(end + ivec2(0, -1)).r > 0.0;
+        if (is_crossed || Edges(end + ivec2(-1, 0)).g == 0.0) {
+            break;
+        }
+
+        left++;
+    }
+
+    int right = 0;
+    while (right < MAX_DISTANCE - 1) {
+        ivec2 next = texel + ivec2(right + 1, 0);
+
+        bool is_crossed = Edges(next).r + Edges(next + ivec2(0, -1)).r > 0.0;
+        if (is_crossed || Edges(next).g == 0.0) {
+            break;
+        }
+
+        right++;
+    }
+
+    // the crossing edges at the ends are left of the first texel and of the one past the last
+    ivec2 start = texel - ivec2(left, 0);
+    ivec2 end   = texel + ivec2(right + 1, 0);
+
+    int pattern_start = Pattern(Edges(start).r, Edges(start + ivec2(0, -1)).r);
+    int pattern_end   = Pattern(Edges(end).r, Edges(end + ivec2(0, -1)).r);
+
+    return Area(pattern_start, pattern_end, left, right);
+}
+
+// the edge between the texel and the one to its left, the near side is the texel's column
+vec2 VerticalWeights(ivec2 texel)
+{
+    int down = 0;
+    while (down < MAX_DISTANCE - 1) {
+        ivec2 end = texel - ivec2(0, down);
+
+        bool is_crossed = Edges(end).g + Edges(end + ivec2(-1, 0)).g > 0.0;
+        if (is_crossed || Edges(end + ivec2(0, -1)).r == 0.0) {
+            break;
+        }
+
+        down++;
+    }
+
+    int up = 0;
+    while (up < MAX_DISTANCE - 1) {
+        ivec2 next = texel + ivec2(0, up + 1);
+
+        bool is_crossed = Edges(next).g + Edges(next + ivec2(-1, 0)).g > 0.0;
+        if (is_crossed || Edges(next).r == 0.0) {
+            break;
+        }
+
+        up++;
+    }
+
+    ivec2 start = texel - ivec2(0, down);
+    ivec2 end   = texel + ivec2(0, up + 1);
+
+    int pattern_start = Pattern(Edges(start).g, Edges(start + ivec2(-1, 0)).g);
+    int pattern_end   = Pattern(Edges(end).g, Edges(end + ivec2(-1, 0)).g);
+
+    return Area(pattern_start, pattern_end, down, up);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    vec2  edges = Edges(texel);
+
+    vec4 weights = vec4(0.0);
+    if (edges.g > 0.0) {
+        weights.rg = HorizontalWeights(texel);
+    }
+    if (edges.r > 0.0) {
+        weights.ba = VerticalWeights(texel);
+    }
+
+    imageStore(g_weights, texel, weights);
+}
@@ -0,0 +1,16 @@
+#version 450 core
+
+// Stores the distance to the light normalized by the light's radius instead of the projected depth
+// so all faces share the same metric, see ComputePointShadow in Lighting_FS
+
+// in
+layout(location = 0) in vec3 vo_vtx_pos;
+
+// uniform
+uniform vec3  g_light_pos;
+uniform float g_light_radius;
+
+void main()
+{
+    gl_FragDepth = length(vo_vtx_pos - g_light_pos) / g_light_radius;
+}
@@ -0,0 +1,45 @@
+/*
+#version 450 core
+
+#define MULTI_DRAW 0
+*/
+
+#if MULTI_DRAW
+#    extension GL_ARB_shader_draw_parameters : require
+#endif
+
+// Renders one face of a point light's cube shadow map, see CubeShadowMapCache
+
+#include "DrawData_Include.glsl"
+
+// in
+layout(location = 0) in vec3 vi_vtx_pos;
+
+// out
+layout(location = 0) out vec3 vo_vtx_pos;
+
+// uniform
+#if MULTI_DRAW
+// NOTE: must match MultiDrawBatch
+layout(std430, binding = 5) readonly buffer Draws
+{
+    DrawData g_draws[];
+};
+#else
+uniform mat4 g_mtx_world; // obj   -> world
+#endif
+uniform mat4 g_mtx_vp;    // world -> face clip space
+
+void main()
+{
+#if MULTI_DRAW
+    mat4 mtx_world = g_draws[gl_DrawIDARB].mtx_world;
+#else
+    mat4 mtx_world = g_mtx_world;
+#endif
+
+    vec4 vtx_pos = mtx_world * vec4(vi_vtx_pos, 1.0);
+    vo_vtx_pos   = vtx_pos.xyz;
+
+    gl_Position = g_mtx_vp * vtx_pos;
+}
@@ -0,0 +1,39 @@
+/*
+#version 450 core
+
+#define MULTI_DRAW 0
+*/
+
+#if MULTI_DRAW
+#    extension GL_ARB_shader_draw_parameters : require
+#endif
+
+// Depth only pass for shadow maps, see CascadedShadowMap
+
+#include "DrawData_Include.glsl"
+
+// in
+layout(location = 0) in vec3 vi_vtx_pos;
+
+// uniform
+#if MULTI_DRAW
+// NOTE: must match MultiDrawBatch
+layout(std430, binding = 5) readonly buffer Draws
+{
+    DrawData g_draws[];
+};
+#else
+uniform mat4 g_mtx_world; // obj   -> world
+#endif
+uniform mat4 g_mtx_vp;    // world -> light clip space
+
+void main()
+{
+#if MULTI_DRAW
+    mat4 mtx_world = g_draws[gl_DrawIDARB].mtx_world;
+#else
+    mat4 mtx_world = g_mtx_world;
+#endif
+
+    gl_Position = g_mtx_vp * mtx_world * vec4(vi_vtx_pos, 1.0);
+}
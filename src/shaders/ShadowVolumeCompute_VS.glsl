@@ -0,0 +1,22 @@
+#version 450 core
+
+// Draws the volume built by ShadowVolume_CS, the vertices are pulled straight from the buffer
+
+layout(std430, binding = 2) readonly buffer Volume
+{
+    vec4 g_volume[]; // world space, w = 0 for vertices projected to infinity
+};
+
+// uniform
+layout(std140, binding = 0) uniform Shared
+{
+    mat4 g_mtx_vp;
+    mat4 g_mtx_view;
+    mat4 g_mtx_proj;
+    vec3 g_pos_view;
+};
+
+void main()
+{
+    gl_Position = g_mtx_vp * g_volume[gl_VertexID];
+}
@@ -38,9 +38,9 @@ struct Vertices {
 layout(triangles_adjacency) in; // six vertices in
 layout(triangle_strip, max_vertices = 18) out;
 
-in vec3 vo_vtx_pos[]; // an array of 6 vertices (triangle with adjacency)
-in vec3 vo_vtx_normal[];
-in vec2 vo_vtx_texcoord[];
+layout(location = 0) in vec3 vo_vtx_pos[]; // an array of 6 vertices (triangle with adjacency)
+layout(location = 1) in vec3 vo_vtx_normal[];
+layout(location = 2) in vec2 vo_vtx_texcoord[];
 
 uniform mat3 g_mtx_normal; // normal -> world
 uniform mat4 g_mtx_world;  // obj    -> world
@@ -0,0 +1,80 @@
+#version 450 core
+
+// Extrudes the silhouettes found on the CPU (see SilhouetteMesh), every record expands to 6
+// vertices, a quad for silhouette edges or the front and back caps for light facing faces
+
+#define EPSILON 0.001
+
+// NOTE: must match SilhouetteMesh::EDGE_FLIP
+#define EDGE_FLIP 0x80000000u
+
+// NOTE: must match the layout of SilhouetteMesh::ssbo_edges and SilhouetteMesh::ssbo_faces
+layout(std430, binding = 0) readonly buffer Edges
+{
+    vec4 g_edges[]; // start, end
+};
+
+layout(std430, binding = 1) readonly buffer Faces
+{
+    vec4 g_faces[]; // v0, v1, v2
+};
+
+layout(std430, binding = 2) readonly buffer Records
+{
+    uint g_records[];
+};
+
+// uniform
+layout(std140, binding = 0) uniform Shared
+{
+    mat4 g_mtx_vp;
+    mat4 g_mtx_view;
+    mat4 g_mtx_proj;
+    vec3 g_pos_view;
+};
+
+uniform mat4 g_mtx_world; // obj -> world
+uniform vec4 g_light;     // (pos, 1) for positional lights, (-dir, 0) for directional lights
+uniform uint g_record_offset;
+uniform bool g_is_cap;
+
+// same winding as the triangle strips emitted by the geometry shader
+const uint SIDE_ENDPOINT[6] = uint[](0, 0, 1, 1, 0, 1);
+const bool SIDE_IS_FAR[6]   = bool[](false, true, false, false, true, true);
+
+// front cap followed by the back cap
+const uint CAP_VERTEX[6] = uint[](0, 1, 2, 0, 2, 1);
+const bool CAP_IS_FAR[6] = bool[](false, false, false, true, true, true);
+
+void main()
+{
+    uint record = g_records[g_record_offset + gl_VertexID / 6];
+    uint corner = gl_VertexID % 6;
+
+    vec4 vtx_local;
+    bool is_far;
+    if (g_is_cap) {
+        vtx_local = g_faces[3 * record + CAP_VERTEX[corner]];
+        is_far    = CAP_IS_FAR[corner];
+    } else {
+        uint edge     = record & ~EDGE_FLIP;
+        uint endpoint = SIDE_ENDPOINT[corner];
+        if ((record & EDGE_FLIP) != 0) {
+            endpoint = 1 - endpoint;
+        }
+
+        vtx_local = g_edges[2 * edge + endpoint];
+        is_far    = SIDE_IS_FAR[corner];
+    }
+
+    // directional lights extrude every vertex to the same point, so for the sun the second
+    // triangle of each quad and the back cap are degenerate and get culled by the rasterizer
+    vec3 vtx       = vec3(g_mtx_world * vtx_local);
+    vec3 light_dir = normalize(vtx * g_light.w - g_light.xyz);
+
+    if (is_far) {
+        gl_Position = g_mtx_vp * vec4(light_dir, 0.0);
+    } else {
+        gl_Position = g_mtx_vp * vec4(vtx + light_dir * EPSILON, 1.0);
+    }
+}
@@ -0,0 +1,218 @@
+/*
+#version 450 core
+
+#define LIGHT_TYPE AMBIENT_LIGHT
+*/
+
+// Compute equivalent of ShadowVolume_GS, each invocation handles one triangle with adjacency and
+// appends its silhouette quads and caps (z-fail only) to the volume buffer as a triangle list
+
+#define EPSILON 0.001
+
+// NOTE: must match ShadowVolumeCompute
+#define WORKGROUP_SIZE 64
+
+// NOTE: must match the layout of Vertex
+#define VERTEX_STRIDE 14
+
+#include "Lights_Include.glsl"
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+layout(std430, binding = 0) readonly buffer Vertices
+{
+    float g_vertices[];
+};
+
+layout(std430, binding = 1) readonly buffer Indices
+{
+    uint g_indices[]; // six indices per triangle (triangle with adjacency)
+};
+
+layout(std430, binding = 2) writeonly buffer Volume
+{
+    vec4 g_volume[]; // world space, w = 0 for vertices projected to infinity
+};
+
+// NOTE: must match ShadowVolumeCompute::DrawArraysIndirectCommand
+layout(std430, binding = 3) buffer Command
+{
+    uint g_volume_count;
+    uint g_instance_count;
+    uint g_first;
+    uint g_base_instance;
+};
+
+uniform mat4 g_mtx_world; // obj -> world
+uniform uint g_triangle_count;
+uniform bool g_emit_caps;
+
+#if LIGHT_TYPE == SUN_LIGHT
+uniform SunLight g_light_source;
+
+#elif LIGHT_TYPE == POINT_LIGHT
+uniform PointLight g_light_source;
+
+#elif LIGHT_TYPE == SPOT_LIGHT
+uniform SpotLight g_light_source;
+
+#endif
+
+vec3 LoadVertex(uint index)
+{
+    uint base = g_indices[index] * VERTEX_STRIDE;
+    vec3 pos  = vec3(g_vertices[base + 0], g_vertices[base + 1], g_vertices[base + 2]);
+    return vec3(g_mtx_world * vec4(pos, 1.0));
+}
+
+// vector pointing from the vertex towards the light
+vec3 ToLight(vec3 vtx)
+{
+#if LIGHT_TYPE == SUN_LIGHT
+    return -g_light_source.dir;
+#else
+    return g_light_source.pos - vtx;
+#endif
+}
+
+// the vertex just a tiny bit below the original surface
+vec4 Near(vec3 vtx)
+{
+#if LIGHT_TYPE == SUN_LIGHT
+    return vec4(vtx + g_light_source.dir * EPSILON, 1.0);
+#else
+    return vec4(vtx + normalize(vtx - g_light_source.pos) * EPSILON, 1.0);
+#endif
+}
+
+// the vertex projected to infinity
+vec4 Far(vec3 vtx)
+{
+#if LIGHT_TYPE == SUN_LIGHT
+    return vec4(g_light_source.dir, 0.0);
+#else
+    return vec4(normalize(vtx - g_light_source.pos), 0.0);
+#endif
+}
+
+bool FacesLight(vec3 v0, vec3 v1, vec3 v2)
+{
+    return dot(cross(v1 - v0, v2 - v0), ToLight(v0)) > 0.0;
+}
+
+void EmitSide(inout uint cursor, vec3 v_start, vec3 v_end)
+{
+#if LIGHT_TYPE == SUN_LIGHT
+    // every vertex projects to the same point at infinity, so one triangle is enough
+    g_volume[cursor++] = Near(v_start);
+    g_volume[cursor++] = Far(v_start);
+    g_volume[cursor++] = Near(v_end);
+#else
+    // same winding as the triangle strip emitted by the geometry shader
+    g_volume[cursor++] = Near(v_start);
+    g_volume[cursor++] = Far(v_start);
+    g_volume[cursor++] = Near(v_end);
+
+    g_volume[cursor++] = Near(v_end);
+    g_volume[cursor++] = Far(v_start);
+    g_volume[cursor++] = Far(v_end);
+#endif
+}
+
+#if LIGHT_TYPE == SUN_LIGHT
+#    define SIDE_VERTICES 3
+#    define CAP_VERTICES  3 // no back cap, it would collapse to a point
+#else
+#    define SIDE_VERTICES 6
+#    define CAP_VERTICES  6
+#endif
+
+void main()
+{
+    uint tri = gl_GlobalInvocationID.x;
+    if (tri >= g_triangle_count) {
+        return;
+    }
+
+    vec3 v0 = LoadVertex(6 * tri + 0);
+    vec3 v1 = LoadVertex(6 * tri + 1);
+    vec3 v2 = LoadVertex(6 * tri + 2);
+    vec3 v3 = LoadVertex(6 * tri + 3);
+    vec3 v4 = LoadVertex(6 * tri + 4);
+    vec3 v5 = LoadVertex(6 * tri + 5);
+
+    // Handle only light facing triangles
+    if (!FacesLight(v0, v2, v4)) {
+        return;
+    }
+
+    // an edge is on the silhouette if the triangle across it faces away from the light
+    bool emit_side0 = !FacesLight(v0, v1, v2);
+    bool emit_side1 = !FacesLight(v2, v3, v4);
+    bool emit_side2 = !FacesLight(v0, v4, v5);
+
+#if LIGHT_TYPE == SPOT_LIGHT
+    // Handle only faces where the face is at least partially within the outer cone, see
+    // ShadowVolume_GS for why the cone isn't expanded
+    float expanded_outer_cutoff = 0.0;
+
+    bool is_outside_v0 = dot(normalize(v0 - g_light_source.pos), g_light_source.dir)
+                         < expanded_outer_cutoff;
+    bool is_outside_v1 = dot(normalize(v1 - g_light_source.pos), g_light_source.dir)
+                         < expanded_outer_cutoff;
+    bool is_outside_v2 = dot(normalize(v2 - g_light_source.pos), g_light_source.dir)
+                         < expanded_outer_cutoff;
+    bool is_outside_v3 = dot(normalize(v3 - g_light_source.pos), g_light_source.dir)
+                         < expanded_outer_cutoff;
+    bool is_outside_v4 = dot(normalize(v4 - g_light_source.pos), g_light_source.dir)
+                         < expanded_outer_cutoff;
+    bool is_outside_v5 = dot(normalize(v5 - g_light_source.pos), g_light_source.dir)
+                         < expanded_outer_cutoff;
+
+    if (is_outside_v0 && is_outside_v1 && is_outside_v2 && is_outside_v3 && is_outside_v4
+        && is_outside_v5) {
+        return;
+    }
+
+    emit_side0 = emit_side0 && (!is_outside_v0 || !is_outside_v2);
+    emit_side1 = emit_side1 && (!is_outside_v2 || !is_outside_v4);
+    emit_side2 = emit_side2 && (!is_outside_v4 || !is_outside_v0);
+#endif
+
+    // reserve all the space this triangle needs with a single atomic
+    uint side_count = uint(emit_side0) + uint(emit_side1) + uint(emit_side2);
+    uint cap_count  = g_emit_caps ? CAP_VERTICES : 0;
+    if (side_count == 0 && cap_count == 0) {
+        return;
+    }
+
+    uint cursor = atomicAdd(g_volume_count, side_count * SIDE_VERTICES + cap_count);
+
+    if (emit_side0) {
+        EmitSide(cursor, v0, v2);
+    }
+
+    if (emit_side1) {
+        EmitSide(cursor, v2, v4);
+    }
+
+    if (emit_side2) {
+        EmitSide(cursor, v4, v0);
+    }
+
+    if (!g_emit_caps) {
+        return;
+    }
+
+    // render the front cap
+    g_volume[cursor++] = Near(v0);
+    g_volume[cursor++] = Near(v2);
+    g_volume[cursor++] = Near(v4);
+
+#if LIGHT_TYPE != SUN_LIGHT
+    // render the back cap
+    g_volume[cursor++] = Far(v0);
+    g_volume[cursor++] = Far(v4);
+    g_volume[cursor++] = Far(v2);
+#endif
+}
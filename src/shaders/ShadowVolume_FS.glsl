@@ -1,6 +1,6 @@
 #version 330 core
 
-out vec4 fo_color;
+layout(location = 0) out vec4 fo_color;
 
 void main()
 {
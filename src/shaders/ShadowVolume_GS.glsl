@@ -1,38 +1,12 @@
 /*
 #version 450 core
 
-#define AMBIENT_LIGHT 0
-#define POINT_LIGHT   1
-#define SPOT_LIGHT    2
-#define SUN_LIGHT     3
+#define LIGHT_TYPE AMBIENT_LIGHT
 */
 
 #define EPSILON 0.001
 
-struct PointLight {
-    vec3 pos;
-
-    vec3 color;
-};
-
-struct SpotLight {
-    vec3  pos;
-    vec3  dir;          // must be pre-normalized
-    float inner_cutoff; // dot(dir, inner_dir)
-    float outer_cutoff; // dot(dit, outer_dir)
-
-    vec3 color;
-};
-
-struct SunLight {
-    vec3 dir; // must be pre-normalized
-
-    vec3 color;
-};
-
-struct AmbientLight {
-    vec3 color;
-};
+#include "Lights_Include.glsl"
 
 struct Edges {
     vec3 e1, e2, e3, e4, e5, e6;
@@ -50,9 +24,9 @@ layout(triangle_strip, max_vertices = 12) out; // 12 out for sun, 3*3 + 3
 layout(triangle_strip, max_vertices = 18) out; // 18 out for the rest, 4*3 + 3 + 3
 #endif
 
-in vec3 vo_vtx_pos[]; // an array of 6 vertices (triangle with adjacency)
-in vec3 vo_vtx_normal[];
-in vec2 vo_vtx_texcoord[];
+layout(location = 0) in vec3 vo_vtx_pos[]; // an array of 6 vertices (triangle with adjacency)
+layout(location = 1) in vec3 vo_vtx_normal[];
+layout(location = 2) in vec2 vo_vtx_texcoord[];
 
 layout(std140, binding = 0) uniform Shared
 {
@@ -66,6 +40,9 @@ uniform mat3 g_mtx_normal; // normal -> world
 uniform mat4 g_mtx_world;  // obj    -> world
 uniform mat4 g_mtx_wvp;    // obj    -> screen
 
+// caps are only needed for depth fail (z-fail) volumes, see ShadowCasters
+uniform bool g_emit_caps;
+
 #if LIGHT_TYPE == SUN_LIGHT
 uniform SunLight g_light_source;
 
@@ -141,6 +118,10 @@ void EmitVolume(PointLight light, Vertices verts, Edges edges, mat4 mtx_vp)
         EmitQuad(light, vtx_start, vtx_end, mtx_vp);
     }
 
+    if (!g_emit_caps) {
+        return;
+    }
+
     // render the front cap
     light_dir   = normalize(verts.v0 - light.pos);
     gl_Position = mtx_vp * vec4((verts.v0 + light_dir * EPSILON), 1.0);
@@ -222,6 +203,10 @@ void EmitVolume(SunLight light, Vertices verts, Edges edges, mat4 mtx_vp)
         EmitTri(light, vtx_start, vtx_end, mtx_vp);
     }
 
+    if (!g_emit_caps) {
+        return;
+    }
+
     // render the front cap
     light_dir   = light.dir;
     gl_Position = mtx_vp * vec4((verts.v0 + light_dir * EPSILON), 1.0);
@@ -324,6 +309,10 @@ void EmitVolume(SpotLight light, Vertices verts, Edges edges, mat4 mtx_vp)
         EmitQuad(light, vtx_start, vtx_end, mtx_vp);
     }
 
+    if (!g_emit_caps) {
+        return;
+    }
+
     // render the front cap
     light_dir   = normalize(verts.v0 - light.pos);
     gl_Position = mtx_vp * vec4((verts.v0 + light_dir * EPSILON), 1.0);
@@ -8,9 +8,10 @@ layout(location = 3) in vec3 vi_vtx_bitangent;
 layout(location = 4) in vec2 vi_vtx_texcoord;
 
 // out
-out vec3 vo_vtx_pos;
-out vec3 vo_vtx_normal;
-out vec2 vo_vtx_texcoord;
+// NOTE: locations must match ShadowVolume_GS
+layout(location = 0) out vec3 vo_vtx_pos;
+layout(location = 1) out vec3 vo_vtx_normal;
+layout(location = 2) out vec2 vo_vtx_texcoord;
 
 // uniform
 layout(std140, binding = 0) uniform Shared
@@ -1,7 +1,7 @@
 #version 450 core
-out vec4 fo_color;
+layout(location = 0) out vec4 fo_color;
 
-in vec3 vo_vtx_texcoord;
+layout(location = 0) in vec3 vo_vtx_texcoord;
 
 uniform samplerCube g_skybox;
 
@@ -1,7 +1,7 @@
 #version 450 core
 layout(location = 0) in vec3 vi_vtx_pos;
 
-out vec3 vo_vtx_texcoord;
+layout(location = 0) out vec3 vo_vtx_texcoord;
 
 layout(std140, binding = 0) uniform Shared
 {
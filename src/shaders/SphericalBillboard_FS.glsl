@@ -1,7 +1,7 @@
 #version 450 core
-out vec4 fo_color;
+layout(location = 0) out vec4 fo_color;
 
-in vec2 vo_vtx_texcoord;
+layout(location = 0) in vec2 vo_vtx_texcoord;
 
 uniform sampler2D g_sprite;
 uniform float     g_intensity;
@@ -6,7 +6,7 @@ layout(location = 1) in vec3 vi_vtx_normal;
 layout(location = 2) in vec2 vi_vtx_texcoord;
 
 // out
-out vec2 vo_vtx_texcoord;
+layout(location = 0) out vec2 vo_vtx_texcoord;
 
 // uniform
 uniform mat4 g_mtx_wv; // obj  -> view
@@ -0,0 +1,41 @@
+/*
+#version 450 core
+*/
+
+// Motion vectors of the camera: every texel's position is rebuilt from its depth and projected
+// with both this frame's and the last frame's view projection
+// NOTE: the scene is treated as static, moving objects would need last frame's transforms as well
+
+// NOTE: must match Renderer_TAA
+#define GROUP_SIZE 8
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+// in texture coordinates, from the last frame's position to this frame's
+layout(rg16f, binding = 0) uniform writeonly image2D g_motion;
+
+uniform sampler2D g_tex_depth;
+uniform vec2      g_render_size; // in texels, the corner of the targets that was rendered to
+uniform mat4      g_mtx_inv_vp;  // of this frame, jittered like the depth was
+uniform mat4      g_mtx_vp;      // of this frame, without the jitter
+uniform mat4      g_mtx_prev_vp; // of the last frame, without the jitter
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, ivec2(g_render_size)))) {
+        return;
+    }
+
+    float depth = texelFetch(g_tex_depth, texel, 0).r;
+    vec2  uv    = (vec2(texel) + 0.5) / g_render_size;
+
+    vec4 world = g_mtx_inv_vp * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    world /= world.w;
+
+    vec4 cur  = g_mtx_vp * world;
+    vec4 prev = g_mtx_prev_vp * world;
+
+    vec2 motion = (cur.xy / cur.w - prev.xy / prev.w) * 0.5;
+    imageStore(g_motion, texel, vec4(motion, 0.0, 0.0));
+}
@@ -0,0 +1,106 @@
+/*
+#version 450 core
+*/
+
+// Temporal anti-aliasing: every jittered frame is blended into a history that's reprojected with
+// the motion vectors and clamped to the neighborhood of the current frame, which rejects history
+// that's no longer visible. The history is at the output resolution, so frames rendered below it
+// are upscaled as they're accumulated
+// Colors are blended in a tonemapped space so a few bright texels can't dominate the result
+
+// NOTE: must match Renderer_TAA
+#define GROUP_SIZE 8
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout(rgba16f, binding = 0) uniform writeonly image2D g_output;
+
+uniform sampler2D g_tex_color;   // this frame, in the corner of the texture that was rendered to
+uniform sampler2D g_tex_depth;   // of this frame
+uniform sampler2D g_tex_motion;  // of this frame
+uniform sampler2D g_tex_history; // the last frame's output
+
+uniform vec2  g_render_size;    // in texels, the corner of the textures that was rendered to
+uniform vec2  g_source_size;    // of the textures of this frame
+uniform vec2  g_output_size;
+uniform vec2  g_jitter;         // offset of this frame's projection, in rendered texels
+uniform float g_history_weight; // 0 when there's no history
+
+vec3 Tonemap(vec3 hdr)
+{
+    return hdr / (1.0 + max(hdr.r, max(hdr.g, hdr.b)));
+}
+
+vec3 InverseTonemap(vec3 sdr)
+{
+    return sdr / max(1.0 - max(sdr.r, max(sdr.g, sdr.b)), 1.0 / 65504.0);
+}
+
+vec3 RGBToYCoCg(vec3 rgb)
+{
+    return vec3(
+        0.25 * rgb.r + 0.5 * rgb.g + 0.25 * rgb.b,
+        0.5 * rgb.r - 0.5 * rgb.b,
+        -0.25 * rgb.r + 0.5 * rgb.g - 0.25 * rgb.b);
+}
+
+vec3 YCoCgToRGB(vec3 ycocg)
+{
+    return vec3(
+        ycocg.x + ycocg.y - ycocg.z,
+        ycocg.x + ycocg.z,
+        ycocg.x - ycocg.y - ycocg.z);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, ivec2(g_output_size)))) {
+        return;
+    }
+
+    vec2  uv     = (vec2(texel) + 0.5) / g_output_size;
+    vec2  pos    = uv * g_render_size;
+    ivec2 last   = ivec2(g_render_size) - 1;
+    ivec2 center = clamp(ivec2(pos), ivec2(0), last);
+
+    // bounds of the neighborhood, and the closest surface in it, whose motion is used so the edges
+    // of foreground objects are reprojected along with them
+    vec3  color_min     = vec3(1e9);
+    vec3  color_max     = vec3(-1e9);
+    float closest_depth = 1.0;
+    ivec2 closest       = center;
+
+    for (int yy = -1; yy <= 1; yy++) {
+        for (int xx = -1; xx <= 1; xx++) {
+            ivec2 neighbor = clamp(center + ivec2(xx, yy), ivec2(0), last);
+
+            vec3 color = RGBToYCoCg(Tonemap(texelFetch(g_tex_color, neighbor, 0).rgb));
+            color_min  = min(color_min, color);
+            color_max  = max(color_max, color);
+
+            float depth = texelFetch(g_tex_depth, neighbor, 0).r;
+            if (depth < closest_depth) {
+                closest_depth = depth;
+                closest       = neighbor;
+            }
+        }
+    }
+
+    // the jitter moved what was rendered, sampling against it recovers the unjittered frame
+    vec2 color_uv = min((pos + g_jitter) / g_source_size, (g_render_size - 0.5) / g_source_size);
+    vec3 current  = Tonemap(textureLod(g_tex_color, color_uv, 0.0).rgb);
+    vec3 result   = current;
+
+    vec2 history_uv = uv - texelFetch(g_tex_motion, closest, 0).rg;
+    bool is_onscreen
+        = all(greaterThanEqual(history_uv, vec2(0.0))) && all(lessThanEqual(history_uv, vec2(1.0)));
+
+    if (g_history_weight > 0.0 && is_onscreen) {
+        vec3 history = RGBToYCoCg(Tonemap(textureLod(g_tex_history, history_uv, 0.0).rgb));
+        history      = YCoCgToRGB(clamp(history, color_min, color_max));
+        result       = mix(current, history, g_history_weight);
+    }
+
+    imageStore(g_output, texel, vec4(InverseTonemap(result), 1.0));
+}
@@ -1,6 +1,50 @@
+enum class ShadowVolumeMode {
+    GeometryShader, // silhouettes found and extruded by a geometry shader
+    ComputeShader,  // silhouettes found and extruded by a compute shader, drawn indirectly
+    CPU,            // silhouettes found on the CPU, extruded by a vertex shader
+};
+
 struct Settings {
+    // with 1 sample the scene is drawn to a single sample target that isn't resolved
+    // NOTE: read once at startup, the scene target is allocated for one or the other
     int msaa_samples = 4;
     int af_samples   = 16;
+    // run SMAA 1x on the output after tonemapping, meant to replace MSAA with msaa_samples = 1
+    bool smaa = false;
+
+    ShadowVolumeMode shadow_volume_mode = ShadowVolumeMode::ComputeShader;
+    // keep compute shadow volumes around while the light and shadow casters are static
+    bool cache_shadow_volumes = true;
+    // use ARB_bindless_texture handles for materials when supported, otherwise texture arrays
+    // NOTE: read once at startup, the lighting shaders are compiled for one or the other
+    bool bindless_textures = true;
+    // draw each pass with one glMultiDrawElementsIndirect when ARB_shader_draw_parameters is
+    // supported, otherwise one draw per model
+    // NOTE: read once at startup, the shaders are compiled for one or the other
+    bool multi_draw_indirect = true;
+    // without multi draw indirect, give each object's matrices a range of a uniform buffer ring
+    // that's written once per pass instead of setting them as uniforms before every draw
+    // NOTE: read once at startup, the shaders are compiled for one or the other
+    bool object_uniform_ring = false;
+    // store linked programs with glGetProgramBinary and load them on the next launch instead of
+    // compiling their shaders, binaries are invalidated by source or driver changes
+    bool program_binary_cache = true;
+    // specialize shaders from the SPIR-V modules embedded for every ShaderFeatures variant, or
+    // built by `make spirv` for the rest, when ARB_gl_spirv is supported, programs with a stage
+    // that has no module are compiled from source
+    bool spirv_shaders = true;
+    // write the preprocessed source of every shader variant to RENDER_SHADER_CACHE_DIR, which is
+    // what `make spirv` compiles, only needed for shaders outside the embedded variants
+    bool export_shader_sources = false;
+    // render the scene without MSAA, with a jittered projection accumulated over frames by a TAA
+    // pass that also upscales frames rendered below the full resolution
+    // NOTE: read once at startup, the scene target is allocated for one or the other
+    bool temporal_aa = false;
+    // scale the resolution the scene is rendered at between min_render_scale and 1 to keep the
+    // GPU time of a frame within frame_budget_ms, the post pass upscales the result
+    bool  dynamic_resolution = false;
+    float frame_budget_ms    = 16.0f;
+    float min_render_scale   = 0.5f;
 };
 
 extern Settings settings;
@@ -0,0 +1,97 @@
+#include "threads.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(usize num_workers)
+{
+    for (usize ii = 0; ii < num_workers; ii++) {
+        this->workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(this->mutex);
+        this->is_stopping = true;
+    }
+    this->cv_start.notify_all();
+
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    u64 generation_seen = 0;
+
+    while (true) {
+        std::unique_lock lock(this->mutex);
+        this->cv_start.wait(lock, [&]() {
+            return this->is_stopping || this->task_generation != generation_seen;
+        });
+
+        if (this->is_stopping) {
+            return;
+        }
+
+        generation_seen = this->task_generation;
+        lock.unlock();
+
+        this->task();
+
+        lock.lock();
+        this->workers_busy -= 1;
+        if (this->workers_busy == 0) {
+            this->cv_finish.notify_one();
+        }
+    }
+}
+
+void ThreadPool::Run(const std::function<void()>& new_task)
+{
+    {
+        std::lock_guard lock(this->mutex);
+        this->task         = new_task;
+        this->workers_busy = this->workers.size();
+        this->task_generation += 1;
+    }
+    this->cv_start.notify_all();
+
+    this->task();
+
+    std::unique_lock lock(this->mutex);
+    this->cv_finish.wait(lock, [&]() { return this->workers_busy == 0; });
+}
+
+void ThreadPool::ParallelFor(usize count, usize grain, const std::function<void(usize, usize)>& fn)
+{
+    ASSERT(grain > 0);
+
+    usize num_chunks = (count + grain - 1) / grain;
+
+    // not worth waking the workers for
+    if (num_chunks <= 1 || this->workers.empty()) {
+        if (count > 0) {
+            fn(0, count);
+        }
+        return;
+    }
+
+    std::atomic<usize> next_chunk = 0;
+
+    this->Run([&]() {
+        for (usize chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+            usize begin = chunk * grain;
+            fn(begin, std::min(begin + grain, count));
+        }
+    });
+}
+
+ThreadPool& WorkerThreads()
+{
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
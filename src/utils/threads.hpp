@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+// Fixed set of worker threads for data parallel work, the calling thread takes part in the work
+// TODO: only supports one task at a time, which is fine while it's only used from the render thread
+struct ThreadPool {
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable cv_start;
+    std::condition_variable cv_finish;
+    std::function<void()>   task;
+    u64                     task_generation = 0;
+    usize                   workers_busy    = 0;
+    bool                    is_stopping     = false;
+
+    ThreadPool(usize num_workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // runs task on every worker and the calling thread, returns once they're all done
+    void Run(const std::function<void()>& new_task);
+
+    // calls fn(begin, end) for each chunk of [0, count), chunks are at most grain long and start
+    // at multiples of grain
+    void ParallelFor(usize count, usize grain, const std::function<void(usize, usize)>& fn);
+
+    void WorkerLoop();
+};
+
+// lazily started pool with a worker per hardware thread (minus the calling thread)
+ThreadPool& WorkerThreads();